@@ -123,7 +123,7 @@ export
     # numeric types
     Bool, FloatingPoint, Float32, Float64, Number, Integer, Int, Int8, Int16,
     Int32, Int64, Int128, Ptr, Real, Signed, Uint, Uint8, Uint16, Uint32,
-    Uint64, Uint128, Unsigned,
+    Uint64, Uint128, Unsigned, Vec,
     # string types
     Char, ASCIIString, ByteString, DirectIndexString, String, UTF8String,
     # errors
@@ -189,6 +189,10 @@ bitstype 64  Uint64  <: Unsigned
 bitstype 128 Int128  <: Signed
 bitstype 128 Uint128 <: Unsigned
 
+# supertype of fixed-size SIMD vectors of N elements of bits type T;
+# see simd.jl
+abstract Vec{N,T}
+
 if is(Int,Int64)
     typealias Uint Uint64
 else
@@ -214,6 +214,9 @@ function process_options(args::Array{Any,1})
             i+=1
             machines = split(readall(args[i]), '\n', false)
             addprocs_ssh(machines)
+        elseif args[i]=="--compile-report"
+            i+=1
+            report_compile_at_exit(args[i])
         elseif args[i]=="-v" || args[i]=="--version"
             println("julia version ", VERSION)
             exit(0)
@@ -275,7 +278,6 @@ function init_load_path()
 end
 
 function init_sched()
-    global const Workqueue = WorkItem[]
     global const Waiting = Dict()
 end
 
@@ -289,7 +291,7 @@ function init_head_sched()
     push!(PGRP.locs,("",0))
     PGRP.np = 1
     # make scheduler aware of current (root) task
-    unshift!(Workqueue, roottask_wi)
+    ccall(:jl_enq_work, Void, (Any, Int32), roottask_wi, 0)
     yield()
 end
 
@@ -319,6 +321,9 @@ function _start()
         init_sched()
         if !any(a->(a=="--worker"), ARGS)
             init_head_sched()
+            if has(ENV, "JULIA_COMPILE_REPORT")
+                report_compile_at_exit(ENV["JULIA_COMPILE_REPORT"])
+            end
         end
 
         init_load_path()
@@ -362,6 +367,8 @@ const atexit_hooks = {}
 atexit(f::Function) = (unshift!(atexit_hooks, f); nothing)
 
 function _atexit()
+    # messages still waiting to be sent to workers (see queue_send)
+    flush_send_queue()
     for f in atexit_hooks
         try
             f()
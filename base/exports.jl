@@ -125,6 +125,24 @@ export
     QuickSort,
     MergeSort,
     TimSort,
+    Float32x4,
+    Float32x8,
+    Float64x2,
+    Float64x4,
+    Int8x16,
+    Uint8x16,
+    Int8x32,
+    Uint8x32,
+    Int16x8,
+    Uint16x8,
+    Int32x4,
+    Uint32x4,
+    Int32x8,
+    Uint32x8,
+    Int64x2,
+    Uint64x2,
+    Int64x4,
+    Uint64x4,
 
 # Ccall types
     Cchar,
@@ -325,6 +343,7 @@ export
     float64,
     float64_valued,
     floor,
+    fma,
     frexp,
     gamma,
     gcd,
@@ -373,6 +392,7 @@ export
     maxintfloat,
     mod,
     mod1,
+    muladd,
     modf,
     nan,
     nextfloat,
@@ -643,6 +663,13 @@ export
     ror,
     trues,
 
+# simd vectors
+    bitmask,
+    setelt,
+    vbroadcast,
+    vload,
+    vstore,
+
 # dequeues
     append!,
     prepend!,
@@ -933,6 +960,7 @@ export
     finfer,
 
 # loading source files
+    cache_module,
     evalfile,
     include,
     include_string,
@@ -954,6 +982,8 @@ export
     atexit,
     ntuple,
     peakflops,
+    compile_stats,
+    compile_report,
     tty_cols,
     tty_rows,
 
@@ -1034,6 +1064,11 @@ export
     take,
     wait,
 
+# threads
+    nthreads,
+    spawnthread,
+    threadid,
+
 # distributed arrays
     distribute,
     dfill,
@@ -1161,12 +1196,17 @@ export
     @spawnat,
     @everywhere,
     @parallel,
+    @threads,
+    @spawnthread,
     @gensym,
     @eval,
+    @fastmath,
+    @inbounds,
     @task,
     @thunk,
     @vectorize_1arg,
     @vectorize_2arg,
     @show,
     @printf,
+    @vshuffle,
     @sprintf
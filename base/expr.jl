@@ -66,3 +66,26 @@ macroexpand(x) = ccall(:jl_macroexpand, Any, (Any,), x)
 macro eval(x)
     :($(esc(:eval))($(Expr(:quote,x))))
 end
+
+# floating-point intrinsics in ex, including those inlined from calls like
+# x+y, may be reassociated and assume no NaN, Inf or signed zeros. calls
+# that are not inlined keep IEEE semantics.
+macro fastmath(ex)
+    quote
+        $(Expr(:fastmath, true))
+        local val = $(esc(ex))
+        $(Expr(:fastmath, false))
+        val
+    end
+end
+
+# array, tuple and vector indexing in ex is not bounds checked. indexing
+# with an out-of-bounds index then has undefined behavior.
+macro inbounds(ex)
+    quote
+        $(Expr(:inbounds, true))
+        local val = $(esc(ex))
+        $(Expr(:inbounds, false))
+        val
+    end
+end
@@ -21,6 +21,19 @@ copysign(x::Float32, y::Real) = copysign(x, float32(y))
 copysign(x::Float64, y::Real) = copysign(x, float64(y))
 @vectorize_2arg Real copysign
 
+fma(x::Float64, y::Float64, z::Float64) =
+    box(Float64,fma_float(unbox(Float64,x),unbox(Float64,y),unbox(Float64,z)))
+fma(x::Float32, y::Float32, z::Float32) =
+    box(Float32,fma_float(unbox(Float32,x),unbox(Float32,y),unbox(Float32,z)))
+typealias FMAReal Union(Integer,Float32,Float64)
+fma(x::FMAReal, y::FMAReal, z::FMAReal) = fma(promote(float(x),float(y),float(z))...)
+
+muladd(x::Float64, y::Float64, z::Float64) =
+    box(Float64,muladd_float(unbox(Float64,x),unbox(Float64,y),unbox(Float64,z)))
+muladd(x::Float32, y::Float32, z::Float32) =
+    box(Float32,muladd_float(unbox(Float32,x),unbox(Float32,y),unbox(Float32,z)))
+muladd(x::Number, y::Number, z::Number) = x*y+z
+
 signbit(x::Float64) = signbit(reinterpret(Int64,x))
 signbit(x::Float32) = signbit(reinterpret(Int32,x))
 
@@ -36,6 +36,7 @@ package_list = (ByteString=>Float64)[]
 require(fname::String) = require(bytestring(fname))
 require(f::String, fs::String...) = (require(f); for x in fs require(x); end)
 function require(name::ByteString)
+    global cache_record
     if myid() == 1
         @sync begin
             for p = 2:nprocs()
@@ -44,8 +45,18 @@ function require(name::ByteString)
         end
     end
     path = find_in_node1_path(name)
+    if !is(cache_record, nothing)
+        push!(cache_record[2], name)
+    end
     if !has(package_list,path)
-        reload_path(path)
+        # the files of dependencies are not part of a cached package
+        rec = cache_record
+        cache_record = nothing
+        try
+            load_cached(path) || reload_path(path)
+        finally
+            cache_record = rec
+        end
     end
 end
 
@@ -85,6 +96,9 @@ source_path() = source_path("")
 function include_from_node1(path)
     prev = source_path(nothing)
     path = (prev == nothing) ? abspath(path) : joinpath(dirname(prev),path)
+    if !is(cache_record, nothing)
+        push!(cache_record[1], path)
+    end
     tls = task_local_storage()
     tls[:SOURCE_PATH] = path
     try
@@ -123,6 +137,78 @@ function reload_path(path)
     nothing
 end
 
+# precompiled modules
+
+# cache_module(name) loads a package from source and saves the module it
+# defines, which must have the name of its file, to Pkg.dir(".cache").
+# require then restores the module from there in sessions started from
+# the same system image, as long as none of the files it was loaded from
+# have changed; the packages it required are loaded first. a module whose
+# globals hold pointers or other state of the session that saved it can't
+# be cached.
+
+# while a package is being cached: the files it includes, and the
+# packages it requires
+cache_record = nothing
+
+module_cache_file(path) =
+    Pkg.dir(".cache", string(splitext(basename(path))[1], ".ji"))
+
+function cache_module(name::String)
+    path = find_in_path(name)
+    rec = ({}, {})
+    global cache_record
+    cache_record = rec
+    try
+        reload_path(path)
+    finally
+        cache_record = nothing
+    end
+    mname = symbol(splitext(basename(path))[1])
+    m = isdefined(Main, mname) ? eval(Main, mname) : nothing
+    if !isa(m, Module)
+        error("cache_module: $path does not define module $mname")
+    end
+    data = ccall(:jl_save_module, Any, (Any,), m)::Array{Uint8,1}
+    files = [ (f, mtime(f)) for f in unique(rec[1]) ]
+    cache = module_cache_file(path)
+    mkpath(dirname(cache))
+    open(cache, "w") do io
+        serialize(io, (files, unique(rec[2])))
+        write(io, length(data))
+        write(io, data)
+    end
+    m
+end
+
+function load_cached(path)
+    cache = module_cache_file(path)
+    isfile(cache) || return false
+    io = open(cache)
+    try
+        files, deps = deserialize(io)
+        for (f, t) in files
+            if !isfile(f) || mtime(f) != t
+                return false
+            end
+        end
+        for d in deps
+            require(d)
+        end
+        data = read(io, Uint8, read(io, Int))
+        if is(ccall(:jl_restore_module, Any, (Any,), data), nothing)
+            return false
+        end
+    catch err
+        warn("could not restore $path from its cache: $err")
+        return false
+    finally
+        close(io)
+    end
+    package_list[path] = time()
+    true
+end
+
 function evalfile(path::String)
     s = readall(path)
     v = nothing
@@ -86,21 +86,39 @@ function send_msg_now(s::IO, kind, args...)
     send_msg_unknown(s, kind, args)
 end
 
+# whether the connections this process makes compress their messages
+wire_compress = false
+
 type Worker
     host::ByteString
     port::Uint16
     socket::TcpSocket
     sendbuf::IOBuffer
+    senddirect::Array{Any,1}  # arrays to send from their own memory; see serialize_msg
     del_msgs::Array{Any,1}
     add_msgs::Array{Any,1}
     id::Int
     gcflag::Bool
+    compress::Bool  # whether messages to it are compressed
+    sendqueued::Bool  # whether it is in send_queue
+    sending  # the last write of sendbuf not waited for, see send_soon
+    sender  # the task in the middle of a message to it, see send_msg_
+    sendwait::Array{WaitTask,1}
+    sendlater::IOBuffer  # messages of the Scheduler to send after it
     
     Worker(host::String, port::Integer, sock::TcpSocket, id::Int) =
-        new(bytestring(host), uint16(port), sock, IOBuffer(), {}, {}, id, false)
+        new(bytestring(host), uint16(port), sock, IOBuffer(), {}, {}, {}, id, false,
+            false, false, nothing, nothing, WaitTask[], IOBuffer())
+end
+# we connected to the worker, so we say first whether our messages to it are
+# compressed, and it compresses its messages to us the same way. this is on
+# with JULIA_WIRE_COMPRESS=1, and workers follow the process that added them.
+function Worker(host::String, port::Integer, sock::TcpSocket)
+    w = Worker(host, port, sock, 0)
+    w.compress = wire_compress || get(ENV, "JULIA_WIRE_COMPRESS", "") == "1"
+    write(sock, uint8(w.compress))
+    w
 end
-Worker(host::String, port::Integer, sock::TcpSocket) =
-    Worker(host, port, sock, 0)
 Worker(host::String, port::Integer) =
     Worker(host, port, connect(host,uint16(port)))
 Worker(host::String, port::Integer, tunneluser::String) = 
@@ -131,25 +149,247 @@ function flush_gc_msgs(w::Worker)
     end
 end
 
-#TODO: Move to different Thread
-function enq_send_req(sock::TcpSocket,buf,now::Bool)
+# start writing what buf and direct hold (see serialize_msg), and empty
+# them. returns the write request. everything is written from the arrays
+# themselves, so those in direct must not change until it is done.
+function send_buffered(sock::TcpSocket, buf, direct)
     arr=takebuf_array(buf)
-    write(sock,arr)
+    # one write of the pieces of arr with the arrays in between
+    bufs = {}
+    ranges = Int[]
+    p = 0
+    for i = 1:2:length(direct)
+        offs, a = direct[i], direct[i+1]
+        push!(bufs, arr); push!(ranges, p); push!(ranges, offs-p)
+        push!(bufs, a);   push!(ranges, 0); push!(ranges, sizeof(a))
+        p = offs
+    end
+    push!(bufs, arr); push!(ranges, p); push!(ranges, length(arr)-p)
+    empty!(direct)
+    write_arrays(sock, bufs, ranges)
+end
+
+#TODO: Move to different Thread
+function enq_send_req(sock::TcpSocket,buf,direct,now::Bool)
+    wait_write(send_buffered(sock, buf, direct))
     #TODO implement "now"
 end
 
+# a message being serialized to a socket. the bytes collect in buf, but are
+# written out whenever SEND_CHUNK of them have built up, so that a large
+# value is never held in memory whole and its first bytes go out while the
+# rest is being serialized. once more than SEND_QUEUED bytes are still
+# being written, the sender waits for the oldest writes, so a slow peer
+# holds it back instead of the message piling up in the write queue. the
+# Scheduler can't wait; it only leaves its writes to finish on their own.
+const SEND_CHUNK = 1<<20
+const SEND_QUEUED = 4*SEND_CHUNK
+# arrays of references at least this long are written an element at a time
+const SEND_SPLIT = 64
+
+type SendStream <: IO
+    sock::TcpSocket
+    buf::IOBuffer
+    direct    # see serialize_msg
+    compress::Bool  # send the bytes as compressed frames (see lz_frame)
+    pending::Array{Any,1}  # write requests to wait for
+    sizes::Array{Int,1}    # and the bytes each of them writes
+end
+SendStream(sock::TcpSocket, buf::IOBuffer, direct, compress::Bool) =
+    SendStream(sock, buf, direct, compress, {}, Int[])
+SendStream(sock::TcpSocket, buf::IOBuffer, direct) =
+    SendStream(sock, buf, direct, false)
+
+function flush_chunk(s::SendStream, force::Bool)
+    d = is(s.direct,nothing) ? {} : s.direct
+    if position(s.buf) >= SEND_CHUNK ||
+       (force && (position(s.buf) > 0 || !isempty(d)))
+        if s.compress
+            f = lz_frame(takebuf_array(s.buf))
+            n = length(f)
+            req = write_arrays(s.sock, {f}, [0, n])
+        else
+            n = position(s.buf)
+            for i = 2:2:length(d)
+                n += sizeof(d[i])
+            end
+            req = send_buffered(s.sock, s.buf, d)
+        end
+        if !is(current_task(),Scheduler)
+            push!(s.pending, req)
+            push!(s.sizes, n)
+            wait_queued(s, SEND_QUEUED)
+        end
+    end
+end
+flush_chunk(s::SendStream) = flush_chunk(s, false)
+
+# bytes of the writes of s that are still in progress
+function outstanding(s::SendStream)
+    n = 0
+    for i = 1:length(s.pending)
+        if !s.pending[i].done
+            n += s.sizes[i]
+        end
+    end
+    n
+end
+
+# wait for the oldest writes of s until at most max bytes are in progress
+function wait_queued(s::SendStream, max::Int)
+    while !isempty(s.pending) && (s.pending[1].done || outstanding(s) > max)
+        wait_write(shift!(s.pending))
+        shift!(s.sizes)
+    end
+end
+
+write(s::SendStream, x::Uint8) = (write(s.buf, x); flush_chunk(s); 1)
+function write{T}(s::SendStream, a::Array{T})
+    if isbits(T) && sizeof(a) >= SEND_CHUNK && !is(s.direct,nothing)
+        # from the array itself, like serialize_msg does
+        push!(s.direct, position(s.buf))
+        push!(s.direct, a)
+        flush_chunk(s, true)
+        return sizeof(a)
+    end
+    n = write(s.buf, a)
+    flush_chunk(s)
+    n
+end
+
+function serialize_msg(s::SendStream, x, direct)
+    if isa(x,Tuple) && length(x) > 0
+        write_tuple_header(s, length(x))
+        for i = 1:length(x)
+            serialize_msg(s, x[i], direct)
+        end
+    elseif isa(x,Array) && !isbits(eltype(x)) && length(x) >= SEND_SPLIT
+        write_array_header(s, x)
+        for i = 1:length(x)
+            if isdefined(x, i)
+                serialize_msg(s, x[i], direct)
+            else
+                writetag(s, UndefRefTag)
+            end
+        end
+    elseif !serialize_wire(s.buf, x, direct)
+        serialize(s, x)
+    end
+    flush_chunk(s)
+end
+
+# send what is left of the message and wait for all of it to be written
+function finish_msg(s::SendStream)
+    flush_chunk(s, true)
+    wait_queued(s, 0)
+end
+
+# a task can wait for its writes in the middle of a message, so it has the
+# connection to itself until the message is done. other tasks wait for it,
+# and messages of the Scheduler, which can't wait, are kept in sendlater
+# and sent after it.
+send_busy(w::Worker, args...) = !is(w.sender,nothing) && !is(w.sender,current_task())
+
+function release_send(w::Worker)
+    w.sender = nothing
+    if position(w.sendlater) > 0
+        write(w.sendbuf, takebuf_array(w.sendlater))
+        send_soon(w)
+    end
+    tasknotify(w.sendwait, w)
+end
+
 function send_msg_(w::Worker, kind, args, now::Bool)
     #println("Sending msg $kind")
-    buf = w.sendbuf
-    serialize(buf, kind)
-    for arg in args
-        serialize(buf, arg)
+    sched = is(current_task(),Scheduler)
+    if sched && !is(w.sender,nothing)
+        serialize_msg(w.sendlater, kind)
+        for arg in args
+            serialize_msg(w.sendlater, arg)
+        end
+        return
+    end
+    locked = !sched && !is(w.sender,current_task())
+    if locked
+        wait(w, :sendwait, send_busy)
+        w.sender = current_task()
+    end
+    try
+        # large arrays are written from their own memory, which is only
+        # safe if this task can wait for the write to finish. compressed,
+        # they are copied anyway.
+        direct = sched || w.compress ? nothing : w.senddirect
+        s = SendStream(w.socket, w.sendbuf, direct, w.compress)
+        serialize_msg(s, kind, direct)
+        for arg in args
+            serialize_msg(s, arg, direct)
+        end
+
+        if !now && w.gcflag
+            flush_gc_msgs(w)
+        end
+        if now || !isempty(w.senddirect) || !isempty(s.pending)
+            finish_msg(s)
+        else
+            send_soon(w)
+        end
+    finally
+        if locked
+            release_send(w)
+        end
     end
+end
+
+# a message that doesn't have to go out now is written at once if no
+# earlier write to its worker is still in progress. otherwise it stays in
+# the send buffer until the next turn of the event loop, and the messages
+# that arrived meanwhile are then written together: a burst of small
+# messages costs a few writes, not one each, and a lone message is never
+# held back. messages with arrays written from their own memory go out at
+# once, since the sender waits for those writes, and the buffer is written
+# whenever it reaches SEND_CHUNK bytes.
+const send_queue = {}
 
-    if !now && w.gcflag
-        flush_gc_msgs(w)
+# start writing the send buffer of w, without waiting for the write
+function start_send(w::Worker)
+    if w.compress
+        f = lz_frame(takebuf_array(w.sendbuf))
+        w.sending = write_arrays(w.socket, {f}, [0, length(f)])
     else
-        enq_send_req(w.socket,buf,now)
+        w.sending = send_buffered(w.socket, w.sendbuf, {})
+    end
+end
+
+function send_soon(w::Worker)
+    if position(w.sendbuf) == 0
+        return
+    end
+    if is(w.sending,nothing) || w.sending.done
+        start_send(w)
+    else
+        queue_send(w)
+    end
+end
+
+function queue_send(w::Worker)
+    if !w.sendqueued
+        w.sendqueued = true
+        push!(send_queue, w)
+        queueAsync(send_cb::SingleAsyncWork)
+    end
+end
+
+function flush_send_queue()
+    while !isempty(send_queue)
+        w = shift!(send_queue)
+        w.sendqueued = false
+        # a task in the middle of a message sends the buffer when it is done
+        if is(w.sender,nothing) && position(w.sendbuf) > 0
+            start_send(w)
+            if !is(current_task(),Scheduler)
+                wait_write(w.sending)
+            end
+        end
     end
 end
 
@@ -194,7 +434,7 @@ function add_workers(PGRP::ProcessGroup, w::Array{Any,1})
         push!(PGRP.workers, w[i])
         w[i].id = PGRP.np+i
         send_msg_now(w[i], w[i].id, newlocs)
-        create_message_handler_loop(w[i].socket)
+        create_message_handler_loop(w[i].socket, w[i].compress)
     end
     PGRP.locs = newlocs
     PGRP.np += n
@@ -217,7 +457,8 @@ function worker_id_from_socket(s)
     for i=1:nprocs()
         w = worker_from_id(i)
         if isa(w,Worker)
-            if is(s, w.socket) || is(s, w.sendbuf)
+            if is(s, w.socket) || is(s, w.sendbuf) || is(s, w.sendlater) ||
+               (isa(s,SendStream) && is(s.sock, w.socket))
                 return i
             end
         end
@@ -615,19 +856,33 @@ type WaitFor
     rr
 end
 
-global work_cb, fgcm_cb
+global work_cb, fgcm_cb, send_cb
 
+# the run queues live in the runtime (src/sched.c). enq_work queues wi
+# behind everything else; enq_io_work is for tasks woken by I/O, which are
+# run ahead of queued compute work.
 function enq_work(wi::WorkItem)
-    unshift!(Workqueue, wi)
+    ccall(:jl_enq_work, Void, (Any, Int32), wi, 0)
     queueAsync(work_cb::SingleAsyncWork)
 end
 
 enq_work(f::Function) = enq_work(WorkItem(f))
 enq_work(t::Task) = enq_work(WorkItem(t))
 
+function enq_io_work(wi::WorkItem)
+    ccall(:jl_enq_io_work, Void, (Any,), wi)
+    queueAsync(work_cb::SingleAsyncWork)
+end
+
+work_queued() = ccall(:jl_work_length, Csize_t, ()) != 0
+
 function perform_work()
-    job = pop!(Workqueue)
-    perform_work(job)
+    job = ccall(:jl_deq_work, Any, ())
+    if isa(job,Task)
+        # queued from C
+        job = WorkItem(job)
+    end
+    perform_work(job::WorkItem)
 end
 
 function perform_work(job::WorkItem)
@@ -767,30 +1022,38 @@ function accept_handler(server::TcpSocket, status::Int32)
         error("An error occured during the creation of the server")
     end
     client =  accept(server)
-    create_message_handler_loop(client)
+    create_message_handler_loop(client, nothing)
 end
 
 type DisconnectException <: Exception end
 
-function create_message_handler_loop(sock::AsyncStream) #returns immediately
+# compress says whether the other side compresses its messages, or is
+# nothing if it tells us first, because it connected to us
+function create_message_handler_loop(sock::AsyncStream, compress) #returns immediately
     enq_work(@task begin
-        global PGRP
+        global PGRP, wire_compress
         #println("message_handler_loop")
         start_reading(sock)
         wait_connected(sock)
+        if is(compress,nothing)
+            compress = read(sock, Uint8) != 0
+        end
+        src = compress ? InflateStream(sock) : sock
         if PGRP.np == 0
             # first connection; get process group info from client
-            PGRP.myid = deserialize(sock)
-            PGRP.locs = locs = deserialize(sock)
+            wire_compress = compress
+            PGRP.myid = deserialize_msg(src)
+            PGRP.locs = locs = deserialize_msg(src)
             #print("\nLocation: ",locs,"\nId:",PGRP.myid,"\n")
             # joining existing process group
             PGRP.np = length(PGRP.locs)
             PGRP.workers = w = cell(PGRP.np)
             w[1] = Worker("", 0, sock, 1)
+            w[1].compress = compress
             for i = 2:(PGRP.myid-1)
                 w[i] = Worker(locs[i][1], locs[i][2])
                 w[i].id = i
-                create_message_handler_loop(w[i].socket)
+                create_message_handler_loop(w[i].socket, w[i].compress)
                 send_msg_now(w[i], :identify_socket, PGRP.myid)
             end
             w[PGRP.myid] = LocalProcess()
@@ -801,13 +1064,13 @@ function create_message_handler_loop(sock::AsyncStream) #returns immediately
         #println("loop")
         while true
             #try
-                msg = deserialize(sock)
+                msg = deserialize_msg(src)
                 #println("got msg: ",msg)
             # handle message
             if is(msg, :call) || is(msg, :call_fetch) || is(msg, :call_wait)
-                id = deserialize(sock)
-                f = deserialize(sock)
-                args = deserialize(sock)
+                id = deserialize_msg(src)
+                f = deserialize_msg(src)
+                args = deserialize_msg(src)
                 #print("$(myid()) got call $id\n")
                 wi = schedule_call(id, f, args)
                 if is(msg, :call_fetch)
@@ -816,24 +1079,25 @@ function create_message_handler_loop(sock::AsyncStream) #returns immediately
                     wi.notify = (sock, :wait, id, wi.notify)
                 end
             elseif is(msg, :do)
-                f = deserialize(sock)
-                args = deserialize(sock)
+                f = deserialize_msg(src)
+                args = deserialize_msg(src)
                 #print("got args: $args\n")
                 let func=f, ar=args
                     enq_work(WorkItem(()->apply(func, ar)))
                 end
             elseif is(msg, :result)
                 # used to deliver result of wait or fetch
-                mkind = deserialize(sock)
-                oid = deserialize(sock)
-                val = deserialize(sock)
+                mkind = deserialize_msg(src)
+                oid = deserialize_msg(src)
+                val = deserialize_msg(src)
                 deliver_result((), mkind, oid, val)
             elseif is(msg, :identify_socket)
-                otherid = deserialize(sock)
+                otherid = deserialize_msg(src)
                 identify_socket(otherid, sock)
+                PGRP.workers[otherid].compress = compress
             else
                 # the synchronization messages
-                oid = deserialize(sock)::(Int,Int)
+                oid = deserialize_msg(src)::(Int,Int)
                 wi = lookup_ref(oid)
                 if wi.done
                     deliver_result(sock, msg, oid, work_result(wi))
@@ -964,8 +1228,12 @@ function ssh_tunnel(user, host, port)
     localp
 end
 
+# workers compile at the JIT optimization level of the process that
+# starts them
+worker_opt_flag() = "-O$(ccall(:jl_opt_level, Int32, ()))"
+
 function worker_ssh_cmd(host)
-    `ssh -n $host "bash -l -c \"cd $JULIA_HOME && ./julia-release-basic --worker\""`
+    `ssh -n $host "bash -l -c \"cd $JULIA_HOME && ./julia-release-basic $(worker_opt_flag()) --worker\""`
 end
 
 #function worker_ssh_cmd(host, key)
@@ -994,7 +1262,7 @@ end
 #    add_workers(PGRP, start_remote_workers(machines, map(x->worker_ssh_cmd(x[1],x[2]), cmdargs)))
 #end
 
-worker_local_cmd() = `$JULIA_HOME/julia-release-basic --bind-to $bind_addr --worker`
+worker_local_cmd() = `$JULIA_HOME/julia-release-basic $(worker_opt_flag()) --bind-to $bind_addr --worker`
 
 addprocs_local(np::Integer) =
     add_workers(PGRP, start_remote_workers({ "localhost" for i=1:np },
@@ -1005,7 +1273,7 @@ function start_sge_workers(n)
     home = JULIA_HOME
     sgedir = joinpath(pwd(),"SGE")
     run(`mkdir -p $sgedir`)
-    qsub_cmd = `echo $home/julia-release-basic --worker` | `qsub -N JULIA -terse -cwd -j y -o $sgedir -t 1:$n`
+    qsub_cmd = `echo $home/julia-release-basic $(worker_opt_flag()) --worker` | `qsub -N JULIA -terse -cwd -j y -o $sgedir -t 1:$n`
     out,_ = readsfrom(qsub_cmd)
     if !success(qsub_cmd)
         error("batch queue not available (could not run qsub)")
@@ -1147,7 +1415,8 @@ function spawnlocal(thunk)
     wi = WorkItem(thunk)
     (PGRP::ProcessGroup).refs[rid] = wi
     add!(wi.clientset, rid[1])
-    push!(Workqueue, wi)   # add to the *front* of the queue, work first
+    # add to the *front* of the queue, work first
+    ccall(:jl_enq_work, Void, (Any, Int32), wi, 1)
     queueAsync(work_cb::SingleAsyncWork)
     yield()
     rr
@@ -1361,12 +1630,12 @@ function yield(args...)
 end
 
 function _jl_work_cb(args...)
-    if !isempty(Workqueue)
+    if work_queued()
         perform_work()
     else
         queueAsync(fgcm_cb::SingleAsyncWork)
     end
-    if !isempty(Workqueue)
+    if work_queued()
         # really this should just make process_event be non-blocking
         queueAsync(work_cb::SingleAsyncWork)
     end
@@ -1375,6 +1644,7 @@ end
 function event_loop(isclient)
     global work_cb = SingleAsyncWork(eventloop(), _jl_work_cb)
     global fgcm_cb = SingleAsyncWork(eventloop(), (args...)->flush_gc_msgs());
+    global send_cb = SingleAsyncWork(eventloop(), (args...)->flush_send_queue());
     queueAsync(work_cb::SingleAsyncWork)
     iserr, lasterr, bt = false, nothing, {}
     while true
@@ -170,6 +170,7 @@ function _uv_hook_return_spawn(proc::Process, exit_status::Int32, term_signal::I
     if isa(proc.exitcb, Function) proc.exitcb(proc, exit_status, term_signal) end
     ccall(:jl_close_uv,Void,(Ptr{Void},),proc.handle)
     tasknotify(proc.exitnotify, proc)
+    nothing
 end
 
 function _uv_hook_close(proc::Process)
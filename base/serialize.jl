@@ -9,8 +9,9 @@ abstract UndefRefTag
 const ser_version = 1 # do not make changes without bumping the version #!
 const ser_tag = ObjectIdDict()
 const deser_tag = ObjectIdDict()
+const wire_tags = cell(255)  # wire_tags[i] == deser_tag[i], for src/wire.c
 let i = 2
-    global ser_tag, deser_tag
+    global ser_tag, deser_tag, wire_tags
     for t = {Symbol, Int8, Uint8, Int16, Uint16, Int32, Uint32,
              Int64, Uint64, Int128, Uint128, Float32, Float64, Char, Ptr,
              DataType, UnionType, Function,
@@ -38,6 +39,7 @@ let i = 2
              28, 29, 30, 31, 32}
         ser_tag[t] = int32(i)
         deser_tag[int32(i)] = t
+        wire_tags[i] = t
         i += 1
     end
 end
@@ -61,8 +63,7 @@ serialize(s, ::Ptr) = error("cannot serialize a pointer")
 
 serialize(s, ::()) = write_as_tag(s, ())
 
-function serialize(s, t::Tuple)
-    l = length(t)
+function write_tuple_header(s, l)
     if l <= 255
         writetag(s, Tuple)
         write(s, uint8(l))
@@ -70,6 +71,11 @@ function serialize(s, t::Tuple)
         writetag(s, LongTuple)
         write(s, int32(l))
     end
+end
+
+function serialize(s, t::Tuple)
+    l = length(t)
+    write_tuple_header(s, l)
     for i = 1:l
         serialize(s, t[i])
     end
@@ -79,14 +85,15 @@ function serialize(s, x::Symbol)
     if has(ser_tag, x)
         return write_as_tag(s, x)
     end
-    name = string(x)
+    # the length in bytes, as deserialize reads it
+    name = string(x).data
     ln = length(name)
     if ln <= 255
         writetag(s, Symbol)
         write(s, uint8(ln))
     else
         writetag(s, LongSymbol)
-        write(s, int32(length(name)))
+        write(s, int32(ln))
     end
     write(s, name)
 end
@@ -111,11 +118,15 @@ function serialize_array_data(s, a)
     end
 end
 
-function serialize(s, a::Array)
+function write_array_header(s, a::Array)
     writetag(s, Array)
-    elty = eltype(a)
-    serialize(s, elty)
+    serialize(s, eltype(a))
     serialize(s, size(a))
+end
+
+function serialize(s, a::Array)
+    write_array_header(s, a)
+    elty = eltype(a)
     if isbits(elty)
         serialize_array_data(s, a)
     else
@@ -353,27 +364,31 @@ function deserialize(s, ::Type{LambdaStaticData})
     end
 end
 
+function deserialize_array_data(s, elty, dims)
+    n = prod(dims)::Int
+    if elty === Bool && n>0
+        A = Array(Bool, dims)
+        i = 1
+        while i <= n
+            b = read(s, Uint8)
+            v = bool(b>>7)
+            count = b&0x7f
+            nxt = i+count
+            while i < nxt
+                A[i] = v; i+=1
+            end
+        end
+        return A
+    else
+        return read(s, elty, dims)
+    end
+end
+
 function deserialize(s, ::Type{Array})
     elty = deserialize(s)
     dims = deserialize(s)::Dims
     if isbits(elty)
-        n = prod(dims)::Int
-        if elty === Bool && n>0
-            A = Array(Bool, dims)
-            i = 1
-            while i <= n
-                b = read(s, Uint8)
-                v = bool(b>>7)
-                count = b&0x7f
-                nxt = i+count
-                while i < nxt
-                    A[i] = v; i+=1
-                end
-            end
-            return A
-        else
-            return read(s, elty, dims)
-        end
+        return deserialize_array_data(s, elty, dims)
     end
     A = Array(elty, dims)
     for i = 1:length(A)
@@ -458,3 +473,168 @@ function deserialize(s, t::DataType)
         return x
     end
 end
+
+## messages ##
+
+# serialize_msg and deserialize_msg use the C serializer in src/wire.c when
+# it can handle the value, which covers most message arguments, and
+# serialize and deserialize otherwise. the bytes are the same either way.
+
+# with a direct list, the data of large bits arrays is left out of s, and
+# the offset in s where it belongs and the array are pushed onto the list,
+# for the caller to write from the array itself
+function serialize_msg(s::IOBuffer, x, direct)
+    if !serialize_wire(s, x, direct)
+        serialize(s, x)
+    end
+end
+
+# write x to s with the C serializer, if it can. returns whether it did.
+function serialize_wire(s::IOBuffer, x, direct)
+    if s.writable && s.maxsize == typemax(Int)
+        p = s.append ? s.size : s.ptr-1
+        n = is(direct,nothing) ? 0 : length(direct)
+        q = int(ccall(:jl_serialize_wire, Uint, (Any, Uint, Any, Any, Any),
+                      s.data, p, x, ser_tag.ht, direct))
+        if q != 0
+            s.size = max(s.size, q)
+            if !s.append; s.ptr = q+1; end
+            return true
+        end
+        if !is(direct,nothing)
+            resize!(direct, n)
+        end
+    end
+    false
+end
+serialize_msg(s::IOBuffer, x) = serialize_msg(s, x, nothing)
+serialize_msg(s, x) = serialize(s, x)
+
+# the value at the read position of b if it is all there and the C
+# deserializer can read it, otherwise wire_tags
+function deserialize_buffered(b::IOBuffer)
+    if !b.readable
+        return wire_tags
+    end
+    pos = Uint[b.ptr-1]
+    x = ccall(:jl_deserialize_wire, Any, (Any, Ptr{Uint}, Uint, Any),
+              b.data, pos, b.size, wire_tags)
+    if !is(x, wire_tags)
+        b.ptr = int(pos[1])+1
+    end
+    x
+end
+
+function deserialize_msg(s::IOBuffer)
+    x = deserialize_buffered(s)
+    is(x, wire_tags) ? deserialize(s) : x
+end
+
+## compressed messages ##
+
+# a frame of compressed data (with lz_compress in src/support/lz.c) is the
+# length of the data, the length it was compressed to, or 0 if it is stored
+# as is, and then the data
+
+function lz_frame(a::Vector{Uint8})
+    n = length(a)
+    f = Array(Uint8, 8+int(ccall(:lz_bound, Uint, (Uint,), n)))
+    c = int(ccall(:lz_compress, Uint, (Ptr{Uint8}, Uint, Ptr{Uint8}, Uint),
+                  a, n, pointer(f,9), length(f)-8))
+    if c == 0
+        f[9:8+n] = a
+    end
+    f[1:8] = reinterpret(Uint8, Int32[n, c])
+    resize!(f, 8+(c == 0 ? n : c))
+end
+
+function read_lz_frame(s::IO)
+    n = int(read(s, Int32))
+    c = int(read(s, Int32))
+    if c == 0
+        return read(s, Array(Uint8, n))
+    end
+    data = read(s, Array(Uint8, c))
+    a = Array(Uint8, n)
+    if ccall(:lz_decompress, Int32, (Ptr{Uint8}, Uint, Ptr{Uint8}, Uint),
+             data, c, a, n) != 0
+        error("corrupt compressed message")
+    end
+    a
+end
+
+# the messages of a connection whose other side compresses them, read a
+# frame at a time into buf
+type InflateStream <: IO
+    sock::AsyncStream
+    buf::IOBuffer
+end
+InflateStream(sock::AsyncStream) = InflateStream(sock, PipeBuffer())
+
+function wait_readnb(s::InflateStream, nb::Int)
+    while nb_available(s.buf) < nb
+        write(s.buf, read_lz_frame(s.sock))
+    end
+end
+
+read(s::InflateStream, ::Type{Uint8}) = (wait_readnb(s, 1); read(s.buf, Uint8))
+function read{T}(s::InflateStream, a::Array{T})
+    if !isbits(T)
+        error("Read from Buffer only supports bits types or arrays of bits types")
+    end
+    wait_readnb(s, length(a)*sizeof(T))
+    read(s.buf, a)
+end
+
+msg_buffer(s::AsyncStream) = s.buffer
+msg_buffer(s::InflateStream) = s.buf
+
+# a value that has not all arrived yet is read as it comes in. the elements
+# of a tuple or of an array of references are read one at a time, so that
+# each can still go through the C deserializer once it is buffered.
+function deserialize_msg(s::Union(AsyncStream,InflateStream))
+    x = deserialize_buffered(msg_buffer(s))
+    if !is(x, wire_tags)
+        return x
+    end
+    tag = peek_byte(s)
+    if tag == ser_tag[Tuple] || tag == ser_tag[LongTuple]
+        read(s, Uint8)
+        len = tag == ser_tag[Tuple] ? int32(read(s, Uint8)) : read(s, Int32)
+        return ntuple(len, i->deserialize_msg(s))
+    elseif tag == ser_tag[Array]
+        read(s, Uint8)
+        elty = deserialize(s)
+        dims = deserialize(s)::Dims
+        if isbits(elty)
+            return deserialize_array_data(s, elty, dims)
+        end
+        A = Array(elty, dims)
+        for i = 1:length(A)
+            if peek_byte(s) == ser_tag[UndefRefTag]
+                read(s, Uint8)
+            else
+                A[i] = deserialize_msg(s)
+            end
+        end
+        return A
+    end
+    deserialize(s)
+end
+
+# the next byte of s, left unread
+function peek_byte(s::AsyncStream)
+    start_reading(s)
+    wait_readnb(s, 1)
+    if nb_available(s.buffer) == 0
+        throw(EOFError())
+    end
+    s.buffer.data[s.buffer.ptr]
+end
+
+function peek_byte(s::InflateStream)
+    wait_readnb(s, 1)
+    s.buf.data[s.buf.ptr]
+end
+
+deserialize_msg(s) = deserialize(s)
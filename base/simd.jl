@@ -0,0 +1,163 @@
+## fixed-size SIMD vectors ##
+
+# Each concrete type is a bits type declared as a subtype of Vec{N,T};
+# codegen represents it as an LLVM <N x T> vector, so the arithmetic
+# intrinsics below compile to single vector instructions.
+
+bitstype 128 Float32x4 <: Vec{4,Float32}
+bitstype 256 Float32x8 <: Vec{8,Float32}
+bitstype 128 Float64x2 <: Vec{2,Float64}
+bitstype 256 Float64x4 <: Vec{4,Float64}
+
+bitstype 128 Int8x16   <: Vec{16,Int8}
+bitstype 128 Uint8x16  <: Vec{16,Uint8}
+bitstype 256 Int8x32   <: Vec{32,Int8}
+bitstype 256 Uint8x32  <: Vec{32,Uint8}
+bitstype 128 Int16x8   <: Vec{8,Int16}
+bitstype 128 Uint16x8  <: Vec{8,Uint16}
+bitstype 128 Int32x4   <: Vec{4,Int32}
+bitstype 128 Uint32x4  <: Vec{4,Uint32}
+bitstype 256 Int32x8   <: Vec{8,Int32}
+bitstype 256 Uint32x8  <: Vec{8,Uint32}
+bitstype 128 Int64x2   <: Vec{2,Int64}
+bitstype 128 Uint64x2  <: Vec{2,Uint64}
+bitstype 256 Int64x4   <: Vec{4,Int64}
+bitstype 256 Uint64x4  <: Vec{4,Uint64}
+
+typealias FloatVec Union(Float32x4,Float32x8,Float64x2,Float64x4)
+typealias IntVec   Union(Int8x16,Uint8x16,Int8x32,Uint8x32,Int16x8,Uint16x8,
+                         Int32x4,Uint32x4,Int32x8,Uint32x8,
+                         Int64x2,Uint64x2,Int64x4,Uint64x4)
+
+length{N,T}(::Vec{N,T}) = N
+length{N,T}(::Type{Vec{N,T}}) = N
+length{V<:Vec}(::Type{V}) = length(super(V))
+eltype{N,T}(::Vec{N,T}) = T
+eltype{N,T}(::Type{Vec{N,T}}) = T
+eltype{V<:Vec}(::Type{V}) = eltype(super(V))
+
+# element comparisons give a signed integer vector of the same shape with
+# every bit of an element set where the comparison holds
+for (V, M) in ((Float32x4,Int32x4), (Float32x8,Int32x8),
+               (Float64x2,Int64x2), (Float64x4,Int64x4),
+               (Int8x16,Int8x16), (Uint8x16,Int8x16),
+               (Int8x32,Int8x32), (Uint8x32,Int8x32),
+               (Int16x8,Int16x8), (Uint16x8,Int16x8),
+               (Int32x4,Int32x4), (Uint32x4,Int32x4),
+               (Int32x8,Int32x8), (Uint32x8,Int32x8),
+               (Int64x2,Int64x2), (Uint64x2,Int64x2),
+               (Int64x4,Int64x4), (Uint64x4,Int64x4))
+    T = eltype(V)
+    @eval begin
+        getindex(v::$V, i::Int) = box($T, vecelt(unbox($V,v), unbox(Int,i)))
+        setelt(v::$V, x, i::Int) =
+            box($V, vecsetelt(unbox($V,v), unbox($T,convert($T,x)), unbox(Int,i)))
+        vbroadcast(::Type{$V}, x) = box($V, vecsplat($V, unbox($T,convert($T,x))))
+        zero(::Type{$V}) = vbroadcast($V, 0)
+        bitmask(v::$V) = box(Uint64, vecbitmask(unbox($V,v)))
+    end
+    if V <: FloatVec
+        @eval begin
+            -(x::$V) = box($V, neg_float(unbox($V,x)))
+            +(x::$V, y::$V) = box($V, add_float(unbox($V,x), unbox($V,y)))
+            -(x::$V, y::$V) = box($V, sub_float(unbox($V,x), unbox($V,y)))
+            *(x::$V, y::$V) = box($V, mul_float(unbox($V,x), unbox($V,y)))
+            /(x::$V, y::$V) = box($V, div_float(unbox($V,x), unbox($V,y)))
+            fma(x::$V, y::$V, z::$V) =
+                box($V, fma_float(unbox($V,x), unbox($V,y), unbox($V,z)))
+            muladd(x::$V, y::$V, z::$V) =
+                box($V, muladd_float(unbox($V,x), unbox($V,y), unbox($V,z)))
+
+            .==(x::$V, y::$V) = box($M, eq_float(unbox($V,x), unbox($V,y)))
+            .!=(x::$V, y::$V) = box($M, ne_float(unbox($V,x), unbox($V,y)))
+            .< (x::$V, y::$V) = box($M, lt_float(unbox($V,x), unbox($V,y)))
+            .<=(x::$V, y::$V) = box($M, le_float(unbox($V,x), unbox($V,y)))
+        end
+    else
+        lt, le, shr = T <: Signed ? (:slt_int, :sle_int, :ashr_int) :
+                                    (:ult_int, :ule_int, :lshr_int)
+        xor = symbol("\$")
+        @eval begin
+            -(x::$V) = box($V, neg_int(unbox($V,x)))
+            ~(x::$V) = box($V, not_int(unbox($V,x)))
+            +(x::$V, y::$V) = box($V, add_int(unbox($V,x), unbox($V,y)))
+            -(x::$V, y::$V) = box($V, sub_int(unbox($V,x), unbox($V,y)))
+            *(x::$V, y::$V) = box($V, mul_int(unbox($V,x), unbox($V,y)))
+            (&)(x::$V, y::$V) = box($V, and_int(unbox($V,x), unbox($V,y)))
+            |(x::$V, y::$V) = box($V, or_int(unbox($V,x), unbox($V,y)))
+            $xor(x::$V, y::$V) = box($V, xor_int(unbox($V,x), unbox($V,y)))
+            <<(x::$V, y::Int32) = box($V, shl_int(unbox($V,x), unbox(Int32,y)))
+            >>(x::$V, y::Int32) = box($V, $shr(unbox($V,x), unbox(Int32,y)))
+            >>>(x::$V, y::Int32) = box($V, lshr_int(unbox($V,x), unbox(Int32,y)))
+
+            .==(x::$V, y::$V) = box($M, eq_int(unbox($V,x), unbox($V,y)))
+            .!=(x::$V, y::$V) = box($M, ne_int(unbox($V,x), unbox($V,y)))
+            .< (x::$V, y::$V) = box($M, $lt(unbox($V,x), unbox($V,y)))
+            .<=(x::$V, y::$V) = box($M, $le(unbox($V,x), unbox($V,y)))
+        end
+    end
+end
+
+# element type conversions are not vector operations; reinterpret between
+# vectors of the same size instead
+function reinterpret{V<:Vec,W<:Vec}(::Type{V}, x::W)
+    if sizeof(V) != sizeof(W)
+        error("reinterpret: vector sizes must match")
+    end
+    box(V, unbox(W,x))
+end
+
+function sum(v::Vec)
+    s = v[1]
+    for i = 2:length(v)
+        s += v[i]
+    end
+    s
+end
+
+any(v::IntVec) = bitmask(v) != 0
+all(v::IntVec) = bitmask(v) == (uint64(1)<<length(v))-1
+
+isequal(x::Vec, y::Vec) = typeof(x)==typeof(y) && all(x .== y)
+
+# load the N elements of a starting at a[i] into a vector, and the reverse
+function vload{V<:Vec}(::Type{V}, a::Array, i::Integer)
+    n = length(V)
+    if eltype(a) !== eltype(V)
+        error("vload: element type mismatch")
+    end
+    if i < 1 || i+n-1 > length(a)
+        throw(BoundsError())
+    end
+    pointerref(convert(Ptr{V}, pointer(a, int(i))), 1)
+end
+vload{V<:Vec}(::Type{V}, a::Array) = vload(V, a, 1)
+
+function vstore(v::Vec, a::Array, i::Integer)
+    n = length(v)
+    if eltype(a) !== eltype(v)
+        error("vstore: element type mismatch")
+    end
+    if i < 1 || i+n-1 > length(a)
+        throw(BoundsError())
+    end
+    pointerset(convert(Ptr{typeof(v)}, pointer(a, int(i))), v, 1)
+    a
+end
+vstore(v::Vec, a::Array) = vstore(v, a, 1)
+
+# @vshuffle V x y (i1, i2, ...) picks element ik of the concatenation
+# [x; y] as element k of the result. V and the mask must be constants.
+macro vshuffle(V, x, y, mask)
+    V = esc(V)
+    :(box($V, vecshuffle(unbox($V,$(esc(x))), unbox($V,$(esc(y))), $(esc(mask)))))
+end
+
+function show(io::IO, v::Vec)
+    print(io, typeof(v), "(")
+    for i = 1:length(v)
+        i > 1 && print(io, ", ")
+        show(io, v[i])
+    end
+    print(io, ")")
+end
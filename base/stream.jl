@@ -100,7 +100,7 @@ function tasknotify(waittasks::Vector{WaitTask}, args...)
         if (isa(f, Function) ? f(wt.localdata, args...) : f) === false
             work = wt.job
             work.argument = args
-            enq_work(work)
+            enq_io_work(work)
         else
             push!(newwts,wt)
         end
@@ -154,6 +154,7 @@ function _uv_hook_connectcb(sock::AsyncStream, status::Int32)
         sock.ccb(sock, status)
     end
     tasknotify(sock.connectnotify, sock, status)
+    nothing
 end
 #from `listen`
 function _uv_hook_connectioncb(sock::AsyncStream, status::Int32)
@@ -161,6 +162,7 @@ function _uv_hook_connectioncb(sock::AsyncStream, status::Int32)
         sock.ccb(sock,status)
     end
     tasknotify(sock.connectnotify, sock, status)
+    nothing
 end
 
 ## BUFFER ##
@@ -171,6 +173,10 @@ function alloc_request(buffer::IOBuffer, recommended_size::Int32)
     return (pointer(buffer.data, ptr), length(buffer.data)-ptr+1)
 end
 function _uv_hook_alloc_buf(stream::AsyncStream, recommended_size::Int32)
+    if has(direct_reads, stream)
+        (a,nb) = direct_reads[stream]
+        return (convert(Ptr{Void},pointer(a))+nb, int32(min(sizeof(a)-nb, typemax(Int32))))
+    end
     (buf,size) = alloc_request(stream.buffer, recommended_size)
     assert(size>0) # because libuv requires this (TODO: possibly stop reading too if it fails)
     (buf,int32(size))
@@ -209,11 +215,48 @@ function _uv_hook_readcb(stream::AsyncStream, nread::Int, base::Ptr{Void}, len::
         close(stream)
         tasknotify(stream.readnotify, stream)
         #EOF
+    elseif has(direct_reads, stream)
+        # _uv_hook_alloc_buf gave the array for this read
+        (a,nb) = direct_reads[stream]
+        nb += nread
+        if nb == sizeof(a)
+            delete!(direct_reads, stream)
+        else
+            direct_reads[stream] = (a,nb)
+        end
+        tasknotify(stream.readnotify, stream)
     else
         notify_filled(stream.buffer, nread, base, len)
         notify_filled(stream, nread)
         tasknotify(stream.readnotify, stream)
     end
+    nothing
+end
+
+## reading straight into arrays ##
+
+# streams reading into an array instead of their buffer, with the array and
+# the number of bytes of it filled so far
+const direct_reads = ObjectIdDict()
+
+# smallest read worth doing this way
+const DIRECT_READ_MIN = 65536
+
+wait_direct_filter(s::AsyncStream, args...) = s.open && has(direct_reads, s)
+
+function read_direct(s::AsyncStream, a::Array)
+    buf = s.buffer
+    nb = nb_available(buf)
+    ccall(:memcpy, Void, (Ptr{Void}, Ptr{Void}, Int), a, pointer(buf.data,buf.ptr), nb)
+    buf.ptr += nb
+    direct_reads[s] = (a,nb)
+    start_reading(s)
+    wait(s, :readnotify, wait_direct_filter)
+    if has(direct_reads, s)
+        delete!(direct_reads, s)
+        throw(EOFError())
+    end
+    a
 end
 ##########################################
 # Async Workers
@@ -266,7 +309,7 @@ end
 _uv_hook_close(uv::AsyncWork) = (uv.handle = 0; nothing)
 
 # This serves as a common callback for all async classes
-_uv_hook_asynccb(async::AsyncWork, status::Int32) = async.cb(status)
+_uv_hook_asynccb(async::AsyncWork, status::Int32) = (async.cb(status); nothing)
 
 function start_timer(timer::TimeoutAsyncWork,timeout::Int64,repeat::Int64)
     ccall(:jl_timer_start,Int32,(Ptr{Void},Int64,Int64),timer.handle,timeout,repeat)
@@ -379,6 +422,9 @@ function read{T}(this::AsyncStream, a::Array{T})
         buf = this.buffer
         assert(buf.seekable == false)
         assert(buf.maxsize >= nb)
+        if nb - nb_available(buf) >= DIRECT_READ_MIN
+            return read_direct(this, a)
+        end
         wait_readnb(this,nb)
         read(this.buffer, a)
         return a
@@ -441,6 +487,41 @@ write(s::AsyncStream, p::Ptr, nb::Integer) =
 _write(s::AsyncStream, p::Ptr{Void}, nb::Integer) = 
     ccall(:jl_write, Int,(Ptr{Void}, Ptr{Void}, Uint),handle(s),p,uint(nb))
 
+## writing straight from arrays ##
+
+type WriteRequest
+    bufs::Vector{Any}
+    done::Bool
+    status::Int32
+    notify::Vector{WaitTask}
+    WriteRequest(bufs) = new(bufs, false, 0, WaitTask[])
+end
+
+function _uv_hook_writecb(req::WriteRequest, status::Int32)
+    req.done = true
+    req.status = status
+    tasknotify(req.notify, req, status)
+    nothing
+end
+
+wait_write_filter(req::WriteRequest, args...) = !req.done
+
+# write bytes ranges[2i-1]+1 to ranges[2i-1]+ranges[2i] of each array bufs[i]
+# with one vectored write that reads them in place. the arrays must not be
+# changed until it is done; wait_write(req) waits for that.
+function write_arrays(s::AsyncStream, bufs::Vector{Any}, ranges::Vector{Int})
+    req = WriteRequest(bufs)
+    err = ccall(:jl_write_arrays, Int32, (Ptr{Void}, Any, Any, Ptr{Int}),
+                handle(s), req, bufs, ranges)
+    uv_error("write", err != 0)
+    req
+end
+
+function wait_write(req::WriteRequest)
+    wait(req, :notify, wait_write_filter)
+    uv_error("write", req.status != 0)
+end
+
 ## Libuv error handling
 _uv_lasterror(loop::Ptr{Void}) = ccall(:jl_last_errno,Int32,(Ptr{Void},),loop)
 _uv_lasterror() = _uv_lasterror(eventloop())
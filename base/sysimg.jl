@@ -64,6 +64,7 @@ include("float.jl")
 include("reduce.jl")
 include("complex.jl")
 include("rational.jl")
+include("simd.jl")
 
 # core data structures (used by type inference)
 include("abstractarray.jl")
@@ -103,6 +104,7 @@ include("iterator.jl")
 include("task.jl")
 include("serialize.jl")
 include("multi.jl")
+include("threading.jl")
 
 # system & environment
 include("osutils.jl")
@@ -185,7 +187,6 @@ precompile(next, (Dict{Any,Any}, Int))
 precompile(start, (Dict{Any,Any},))
 precompile(perform_work, ())
 precompile(isempty, (Array{Any,1},))
-precompile(isempty, (Array{WorkItem,1},))
 precompile(getindex, (Dict{Any,Any}, Int32))
 precompile(event_loop, (Bool,))
 precompile(_start, ())
@@ -215,9 +216,8 @@ precompile(ht_keyindex, (Dict{Any,Any}, Int32))
 precompile(perform_work, (WorkItem,))
 precompile(notify_done, (WorkItem,))
 precompile(work_result, (WorkItem,))
-precompile(unshift!, (Array{WorkItem,1}, WorkItem))
 precompile(enq_work, (WorkItem,))
-precompile(pop!, (Array{WorkItem,1},))
+precompile(enq_io_work, (WorkItem,))
 precompile(string, (Int,))
 precompile(parse_int, (Type{Int}, ASCIIString, Int))
 precompile(repeat, (ASCIIString, Int))
@@ -0,0 +1,82 @@
+## shared-memory threads ##
+
+# the number of threads @threads runs on: JULIA_NUM_THREADS, or the number
+# of cores. always 1 unless julia was built with USE_THREADS=1.
+nthreads() = int(ccall(:jl_nthreads, Int32, ()))
+
+threadid() = int(ccall(:jl_threadid, Int16, ())) + 1
+
+# call f(tid) once on every thread and wait for all of them. an error
+# thrown on any thread is rethrown here once all have finished.
+threading_run(f::Function) = ccall(:jl_threading_run, Void, (Any,), f)
+
+# thread tid runs the tid-th of nthreads() contiguous chunks of the range
+function make_threads_body(var, range, body)
+    quote
+        let r = $(esc(range))
+            function (tid::Int)
+                len, extra = divrem(length(r), nthreads())
+                lo = (tid-1)*len + min(tid-1, extra) + 1
+                hi = lo + len - (tid <= extra ? 0 : 1)
+                for i = lo:hi
+                    $(esc(var)) = r[i]
+                    $(esc(body))
+                end
+            end
+        end
+    end
+end
+
+macro threads(loop)
+    if !isa(loop,Expr) || !is(loop.head,:for)
+        error("malformed @threads loop")
+    end
+    var = loop.args[1].args[1]
+    r = loop.args[1].args[2]
+    body = loop.args[2]
+    :(threading_run($(make_threads_body(var, r, body))))
+end
+
+## fork-join inside threaded code ##
+
+# spawnthread(f) queues f on the calling thread's deque, where threads that
+# are done with their own share of a threaded region can steal it. every
+# spawned task must be fetched; fetch runs queued work while it waits.
+type ThreadTask
+    done::Bool
+    result
+    exception
+
+    ThreadTask() = new(false, nothing, nothing)
+end
+
+function spawnthread(f::Function)
+    t = ThreadTask()
+    ccall(:jl_threading_spawn, Void, (Any,), ()->begin
+        try
+            t.result = f()
+        catch err
+            t.exception = err
+        end
+        t.done = true
+    end)
+    t
+end
+
+function fetch(t::ThreadTask)
+    # tasks can't be switched here, so there is no condition to wait on:
+    # run other spawned work, and give up the CPU when there is none
+    while !t.done
+        if ccall(:jl_threading_help, Int32, ()) == 0
+            ccall(:sched_yield, Int32, ())
+        end
+    end
+    if !is(t.exception,nothing)
+        throw(t.exception)
+    end
+    t.result
+end
+
+macro spawnthread(expr)
+    :(spawnthread(()->$(esc(expr))))
+end
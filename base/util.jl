@@ -69,6 +69,39 @@ end
 
 peakflops() = peakflops(2000)
 
+# JIT cost of every method compiled so far, one tuple per method:
+# (name, file, line, emit time, optimize time, native codegen time,
+#  LLVM instructions emitted, after optimization, native code bytes)
+compile_stats() = ccall(:jl_compile_stats, Any, ())
+
+function compile_report(io::IO, n::Integer)
+    stats = sortby!(compile_stats(), s->-(s[4]+s[5]+s[6]))
+    tot = zeros(6)
+    for s in stats
+        for k = 1:6
+            tot[k] += s[k+3]
+        end
+    end
+    @printf(io, "%d methods compiled in %.3f s (emit %.3f s, optimize %.3f s, native %.3f s)\n",
+            length(stats), tot[1]+tot[2]+tot[3], tot[1], tot[2], tot[3])
+    @printf(io, "%d LLVM instructions emitted, %d after optimization, %d bytes of native code\n",
+            int(tot[4]), int(tot[5]), int(tot[6]))
+    println(io, "   total ms    emit     opt  native  instrs   bytes  method")
+    for i = 1:min(n, length(stats))
+        s = stats[i]
+        @printf(io, "%11.3f %7.3f %7.3f %7.3f %7d %7d  %s at %s:%d\n",
+                1000(s[4]+s[5]+s[6]), 1000s[4], 1000s[5], 1000s[6],
+                s[8], s[9], s[1], s[2], s[3])
+    end
+end
+compile_report(io::IO) = compile_report(io, 50)
+compile_report(n::Integer) = compile_report(OUTPUT_STREAM, n)
+compile_report() = compile_report(OUTPUT_STREAM)
+
+# write the report for all methods to file when julia exits
+report_compile_at_exit(file::String) =
+    atexit(()->open(io->compile_report(io, typemax(Int)), file, "w"))
+
 # source files, editing, function reflection
 
 function functionloc(f::Function, types)
@@ -365,6 +398,7 @@ end
 
 free_memory() = ccall(:uv_get_free_memory, Uint64, ())
 total_memory() = ccall(:uv_get_total_memory, Uint64, ())
+resident_memory() = ccall(:jl_resident_memory, Csize_t, ())
 
 
 # `methodswith` -- shows a list of methods using the type given
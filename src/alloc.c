@@ -50,6 +50,7 @@ jl_datatype_t *jl_typeerror_type;
 jl_datatype_t *jl_methoderror_type;
 jl_datatype_t *jl_loaderror_type;
 jl_datatype_t *jl_pointer_type;
+jl_typename_t *jl_vec_typename=NULL;
 jl_datatype_t *jl_voidpointer_type;
 jl_value_t *jl_an_empty_cell=NULL;
 jl_value_t *jl_stackovf_exception;
@@ -77,7 +78,8 @@ jl_sym_t *null_sym;    jl_sym_t *body_sym;
 jl_sym_t *macro_sym;   jl_sym_t *method_sym;
 jl_sym_t *enter_sym;   jl_sym_t *leave_sym;
 jl_sym_t *exc_sym;     jl_sym_t *error_sym;
-jl_sym_t *static_typeof_sym;
+jl_sym_t *static_typeof_sym; jl_sym_t *fastmath_sym;
+jl_sym_t *inbounds_sym;
 jl_sym_t *new_sym;     jl_sym_t *using_sym;
 jl_sym_t *const_sym;   jl_sym_t *thunk_sym;
 jl_sym_t *anonymous_sym;  jl_sym_t *underscore_sym;
@@ -406,9 +408,15 @@ jl_sym_t *jl_symbol(const char *str)
 {
     jl_sym_t **pnode;
 
+#ifdef JULIA_THREADS
+    if (jl_threads_running) jl_mutex_lock(&jl_codegen_lock);
+#endif
     pnode = symtab_lookup(&symtab, str);
     if (*pnode == NULL)
         *pnode = mk_symbol(str);
+#ifdef JULIA_THREADS
+    if (jl_threads_running) pthread_mutex_unlock(&jl_codegen_lock);
+#endif
     return *pnode;
 }
 
@@ -427,30 +435,29 @@ DLLEXPORT jl_sym_t *jl_symbol_n(const char *str, int32_t len)
 
 DLLEXPORT jl_sym_t *jl_get_root_symbol() { return symtab; }
 
-static uint32_t gs_ctr = 0;  // TODO: per-thread
+// gensym numbers must be unique across threads
+static volatile uint32_t gs_ctr = 0;
 uint32_t jl_get_gs_ctr(void) { return gs_ctr; }
 void jl_set_gs_ctr(uint32_t ctr) { gs_ctr = ctr; }
 
 DLLEXPORT jl_sym_t *jl_gensym(void)
 {
-    static char name[16];
+    char name[16];
     char *n;
-    n = uint2str(&name[2], sizeof(name)-2, gs_ctr, 10);
+    n = uint2str(&name[2], sizeof(name)-2, __sync_fetch_and_add(&gs_ctr, 1), 10);
     *(--n) = '#'; *(--n) = '#';
-    gs_ctr++;
     return jl_symbol(n);
 }
 
 DLLEXPORT jl_sym_t *jl_tagged_gensym(const char* str, int32_t len)
 {
-    static char gs_name[14];
+    char gs_name[14];
     char name[sizeof(gs_name)+len+3];
     char *n;
     name[0] = '#'; name[1] = '#'; name[2+len] = '#';
     memcpy(name+2, str, len);
-    n = uint2str(gs_name, sizeof(gs_name), gs_ctr, 10);
+    n = uint2str(gs_name, sizeof(gs_name), __sync_fetch_and_add(&gs_ctr, 1), 10);
     memcpy(name+3+len, n, sizeof(gs_name)-(n-gs_name));
-    gs_ctr++;
     return jl_symbol(name);
 }
 
@@ -532,6 +539,10 @@ jl_datatype_t *jl_new_uninitialized_datatype(size_t nfields)
                       (nfields-1)*sizeof(jl_fielddesc_t)));
 }
 
+// the limits of the bit fields of jl_fielddesc_t
+#define JL_FIELD_MAX_OFFSET 0xffff
+#define JL_FIELD_MAX_SIZE   0x7fff
+
 void jl_compute_field_offsets(jl_datatype_t *st)
 {
     size_t sz = 0, alignm = 0;
@@ -545,6 +556,14 @@ void jl_compute_field_offsets(jl_datatype_t *st)
             al = fsz;   // alignment == size for bits types
             st->fields[i].isptr = 0;
         }
+        else if (jl_isbits(ty) && jl_is_leaf_type(ty) && jl_datatype_size(ty) > 0 &&
+                 jl_datatype_size(ty) <= JL_FIELD_MAX_SIZE) {
+            // immutable struct of bits fields: stored inline, unless it is
+            // too big for a field descriptor
+            fsz = jl_datatype_size(ty);
+            al = ((jl_datatype_t*)ty)->alignment;
+            st->fields[i].isptr = 0;
+        }
         else {
             fsz = sizeof(void*);
             al = fsz;
@@ -554,6 +573,9 @@ void jl_compute_field_offsets(jl_datatype_t *st)
         sz = LLT_ALIGN(sz, al);
         if (al > alignm)
             alignm = al;
+        if (sz > JL_FIELD_MAX_OFFSET || fsz > JL_FIELD_MAX_SIZE)
+            jl_errorf("type %s has too much data in its fields",
+                      st->name->name->name);
         st->fields[i].offset = sz;
         st->fields[i].size = fsz;
         sz += fsz;
@@ -116,6 +116,35 @@ static int bits_equal(void *a, void *b, int sz)
     }
 }
 
+// fields of structs of type dt at a and b. structs stored inline are
+// compared field by field, so that their padding doesn't matter.
+static int fields_egal(jl_datatype_t *dt, char *a, char *b)
+{
+    size_t nf = jl_tuple_len(dt->names);
+    for (size_t f=0; f < nf; f++) {
+        size_t offs = dt->fields[f].offset;
+        char *ao = a + offs;
+        char *bo = b + offs;
+        int eq;
+        if (dt->fields[f].isptr) {
+            jl_value_t *af = *(jl_value_t**)ao;
+            jl_value_t *bf = *(jl_value_t**)bo;
+            if (af == bf) eq = 1;
+            else if (af==NULL || bf==NULL) eq = 0;
+            else eq = jl_egal(af, bf);
+        }
+        else {
+            jl_datatype_t *ft = (jl_datatype_t*)jl_tupleref(dt->types, f);
+            if (jl_tuple_len(ft->names) > 0)
+                eq = fields_egal(ft, ao, bo);
+            else
+                eq = bits_equal(ao, bo, dt->fields[f].size);
+        }
+        if (!eq) return 0;
+    }
+    return 1;
+}
+
 int jl_egal(jl_value_t *a, jl_value_t *b)
 {
     if (a == b)
@@ -141,24 +170,7 @@ int jl_egal(jl_value_t *a, jl_value_t *b)
     if (nf == 0) {
         return bits_equal(jl_data_ptr(a), jl_data_ptr(b), sz);
     }
-    for (size_t f=0; f < nf; f++) {
-        size_t offs = dt->fields[f].offset;
-        char *ao = (char*)jl_data_ptr(a) + offs;
-        char *bo = (char*)jl_data_ptr(b) + offs;
-        int eq;
-        if (dt->fields[f].isptr) {
-            jl_value_t *af = *(jl_value_t**)ao;
-            jl_value_t *bf = *(jl_value_t**)bo;
-            if (af == bf) eq = 1;
-            else if (af==NULL || bf==NULL) eq = 0;
-            else eq = jl_egal(af, bf);
-        }
-        else {
-            eq = bits_equal(ao, bo, dt->fields[f].size);
-        }
-        if (!eq) return 0;
-    }
-    return 1;
+    return fields_egal(dt, (char*)jl_data_ptr(a), (char*)jl_data_ptr(b));
 }
 
 JL_CALLABLE(jl_f_is)
@@ -716,11 +728,8 @@ DLLEXPORT void jl_show_any(jl_value_t *str, jl_value_t *v)
 extern int jl_in_inference;
 int jl_eval_with_compiler_p(jl_expr_t *expr, int compileloops);
 
-JL_CALLABLE(jl_trampoline)
+static void trampoline_compile(jl_function_t *f)
 {
-    assert(jl_is_func(F));
-    jl_function_t *f = (jl_function_t*)F;
-    assert(f->linfo != NULL);
     // to run inference on all thunks. slows down loading files.
     if (f->linfo->inferred == 0) {
         if (!jl_in_inference) {
@@ -735,6 +744,22 @@ JL_CALLABLE(jl_trampoline)
     jl_compile(f);
     assert(f->fptr == &jl_trampoline);
     jl_generate_fptr(f);
+}
+
+JL_CALLABLE(jl_trampoline)
+{
+    assert(jl_is_func(F));
+    jl_function_t *f = (jl_function_t*)F;
+    assert(f->linfo != NULL);
+#ifdef JULIA_THREADS
+    if (jl_threads_running) {
+        // another thread may have compiled f while we waited for the lock
+        JL_LOCKED(jl_codegen_lock,
+                  if (f->fptr == &jl_trampoline) trampoline_compile(f));
+        return jl_apply(f, args, nargs);
+    }
+#endif
+    trampoline_compile(f);
     return jl_apply(f, args, nargs);
 }
 
@@ -881,6 +906,29 @@ static uptrint_t bits_hash(void *b, size_t sz)
     }
 }
 
+// mix the fields of a struct of type dt at v into h, like fields_egal
+static uptrint_t fields_hash(jl_datatype_t *dt, char *v, uptrint_t h)
+{
+    size_t nf = jl_tuple_len(dt->names);
+    for (size_t f=0; f < nf; f++) {
+        char *vo = v + dt->fields[f].offset;
+        uptrint_t u;
+        if (dt->fields[f].isptr) {
+            jl_value_t *f = *(jl_value_t**)vo;
+            u = f==NULL ? 0 : jl_object_id(f);
+        }
+        else {
+            jl_datatype_t *ft = (jl_datatype_t*)jl_tupleref(dt->types, f);
+            if (jl_tuple_len(ft->names) > 0)
+                u = fields_hash(ft, vo, 0);
+            else
+                u = bits_hash(vo, dt->fields[f].size);
+        }
+        h = bitmix(h, u);
+    }
+    return h;
+}
+
 DLLEXPORT uptrint_t jl_object_id(jl_value_t *v)
 {
     if (jl_is_symbol(v))
@@ -904,20 +952,7 @@ DLLEXPORT uptrint_t jl_object_id(jl_value_t *v)
     if (nf == 0) {
         return bits_hash(jl_data_ptr(v), sz) ^ h;
     }
-    for (size_t f=0; f < nf; f++) {
-        size_t offs = dt->fields[f].offset;
-        char *vo = (char*)jl_data_ptr(v) + offs;
-        uptrint_t u;
-        if (dt->fields[f].isptr) {
-            jl_value_t *f = *(jl_value_t**)vo;
-            u = f==NULL ? 0 : jl_object_id(f);
-        }
-        else {
-            u = bits_hash(vo, dt->fields[f].size);
-        }
-        h = bitmix(h, u);
-    }
-    return h;
+    return fields_hash(dt, (char*)jl_data_ptr(v), h);
 }
 
 // init -----------------------------------------------------------------------
@@ -61,8 +61,15 @@ int add_library_mapping(char *lib, void *hnd)
         return -1;
 }
 
+// addresses of symbols already looked up, by (library, name)
+static std::map<std::pair<std::string,std::string>, void*> symMap;
+
 static void *add_library_sym(char *name, char *lib)
 {
+    std::pair<std::string,std::string> key(lib == NULL ? "" : lib, name);
+    std::map<std::pair<std::string,std::string>, void*>::iterator it = symMap.find(key);
+    if (it != symMap.end())
+        return it->second;
     void *hnd;
     if (lib == NULL) {
         hnd = jl_dl_handle;
@@ -91,6 +98,8 @@ static void *add_library_sym(char *name, char *lib)
         }
         sys::DynamicLibrary::AddSymbol(name, sval);
     }
+    if (sval != NULL)
+        symMap[key] = sval;
     return sval;
 }
 
@@ -98,49 +107,58 @@ static void *add_library_sym(char *name, char *lib)
 
 static Function *value_to_pointer_func;
 
-// TODO: per-thread
-static char *temp_arg_area;
-static const uint32_t arg_area_sz = 4196;
-static uint32_t arg_area_loc;
-#define N_TEMP_ARG_BLOCKS 1024
-static void *temp_arg_blocks[N_TEMP_ARG_BLOCKS];
-static uint32_t arg_block_n = 0;
+/*
+  each thread has a bump arena for temporary argument space (e.g. the
+  pointer array built when passing an array of strings as Ptr{Ptr{Uint8}}).
+  it is a list of chunks, each twice the size of the one before. a ccall
+  saves the position before converting its arguments and restores it after
+  the call. chunks are kept once allocated, so restoring is O(1) and calls
+  in steady state don't allocate.
+*/
+#define N_TEMP_ARG_CHUNKS 32
+static const size_t first_arg_chunk_sz = 4096;
+static JL_THREAD char *arg_chunks[N_TEMP_ARG_CHUNKS];
+static JL_THREAD size_t arg_chunk_sz[N_TEMP_ARG_CHUNKS];
+static JL_THREAD uint32_t arg_chunk;     // chunk in use
+static JL_THREAD uint32_t arg_area_loc;  // offset of free space in it
 static Function *save_arg_area_loc_func;
 static Function *restore_arg_area_loc_func;
 
 static uint64_t save_arg_area_loc()
 {
-    return (((uint64_t)arg_block_n)<<32) | ((uint64_t)arg_area_loc);
+    return (((uint64_t)arg_chunk)<<32) | ((uint64_t)arg_area_loc);
 }
 
 static void restore_arg_area_loc(uint64_t l)
 {
+    arg_chunk = l>>32;
     arg_area_loc = l&0xffffffff;
-    uint32_t ab = l>>32;
-    while (arg_block_n > ab) {
-        arg_block_n--;
-        free(temp_arg_blocks[arg_block_n]);
-    }
 }
 
 static void *alloc_temp_arg_space(uint32_t sz)
 {
-    void *p;
-    if (arg_area_loc+sz > arg_area_sz) {
-#ifdef JL_GC_MARKSWEEP
-        if (arg_block_n >= N_TEMP_ARG_BLOCKS)
+    size_t loc = LLT_ALIGN(arg_area_loc, 16);
+    if (arg_chunks[arg_chunk] == NULL || loc+sz > arg_chunk_sz[arg_chunk]) {
+        // move on to the next chunk, making it big enough
+        uint32_t c = arg_chunks[arg_chunk] == NULL ? arg_chunk : arg_chunk+1;
+        if (c >= N_TEMP_ARG_CHUNKS)
             jl_error("internal compiler error: out of temporary argument space in ccall");
-        p = malloc(sz);
-        temp_arg_blocks[arg_block_n++] = p;
-#else
-#error "fixme"
-#endif
-    }
-    else {
-        p = &temp_arg_area[arg_area_loc];
-        arg_area_loc += sz;
-    }
-    return p;
+        if (arg_chunk_sz[c] < sz) {
+            size_t csz = c == 0 ? first_arg_chunk_sz : 2*arg_chunk_sz[c-1];
+            while (csz < sz)
+                csz *= 2;
+            free(arg_chunks[c]);
+            arg_chunk_sz[c] = 0;
+            arg_chunks[c] = (char*)malloc(csz);
+            if (arg_chunks[c] == NULL)
+                jl_throw(jl_memory_exception);
+            arg_chunk_sz[c] = csz;
+        }
+        arg_chunk = c;
+        loc = 0;
+    }
+    arg_area_loc = loc+sz;
+    return arg_chunks[arg_chunk]+loc;
 }
 
 static void *alloc_temp_arg_copy(void *obj, uint32_t sz)
@@ -212,9 +230,142 @@ extern "C" void *jl_value_to_pointer(jl_value_t *jt, jl_value_t *v, int argn,
     return (jl_value_t*)jl_null;
 }
 
+// a slot for an argument passed by address. it goes in the entry block, so
+// that a ccall in a loop doesn't grow the stack.
+static Value *emit_arg_slot(Type *vt, jl_codectx_t *ctx)
+{
+    BasicBlock &entry = ctx->f->getEntryBlock();
+    if (entry.empty())
+        return new AllocaInst(vt, "", &entry);
+    return new AllocaInst(vt, "", &*entry.begin());
+}
+
+// --- passing structs by value ---
+
+/*
+  on x86-64 (other than windows) a struct argument or return value follows
+  the SysV ABI: a struct larger than 16 bytes is passed in memory (a byval
+  copy, or a hidden sret pointer for a return value), and a smaller one as
+  its eightbytes, each in an SSE register if all its fields are floating
+  point and in an integer register otherwise. an argument that doesn't fit
+  in the registers left is passed in memory. elsewhere, and for structs with
+  fields this doesn't handle, the struct is passed as an LLVM aggregate.
+*/
+#if defined(__x86_64__) && !defined(__WIN32__)
+#define JL_SYSV_ABI
+#endif
+
+typedef struct {
+    bool memory;     // passed by hidden pointer
+    Type *cty;       // otherwise what it is passed as
+    int nint, nsse;  // and the registers that takes
+} jl_struct_abi_t;
+
+enum { ABI_NONE, ABI_INTEGER, ABI_SSE };
+
+#ifdef JL_SYSV_ABI
+// merge the classes of the fields of st, found at offset base, into the
+// eightbytes they occupy. structs stored inline are classified by their
+// own fields.
+static bool classify_fields(jl_datatype_t *st, size_t base, int cls[2], bool dbl[2])
+{
+    for(size_t i=0; i < jl_tuple_len(st->types); i++) {
+        jl_value_t *ft = jl_tupleref(st->types, i);
+        size_t off = base + st->fields[i].offset;
+        int c = ABI_INTEGER;
+        if (!st->fields[i].isptr) {
+            if (ft == (jl_value_t*)jl_float32_type || ft == (jl_value_t*)jl_float64_type) {
+                c = ABI_SSE;
+            }
+            else if (jl_is_vec_type(ft)) {
+                return false;
+            }
+            else if (!jl_is_bitstype(ft)) {
+                if (!classify_fields((jl_datatype_t*)ft, off, cls, dbl))
+                    return false;
+                continue;
+            }
+        }
+        for(size_t b = off/8; b <= (off + st->fields[i].size - 1)/8; b++) {
+            if (cls[b] == ABI_NONE || cls[b] == c)
+                cls[b] = c;
+            else
+                cls[b] = ABI_INTEGER;
+            if (ft == (jl_value_t*)jl_float64_type)
+                dbl[b] = true;
+        }
+    }
+    return true;
+}
+#endif
+
+// returns false if jt isn't a struct passed by the rules above
+static bool struct_abi(jl_value_t *jt, jl_struct_abi_t *abi)
+{
+#ifdef JL_SYSV_ABI
+    if (!jl_is_structtype(jt) || jl_is_array_type(jt) || !jl_is_leaf_type(jt))
+        return false;
+    jl_datatype_t *st = (jl_datatype_t*)jt;
+    size_t size = st->size;
+    if (size == 0 || jl_tuple_len(st->types) == 0)
+        return false;
+    abi->memory = false;
+    abi->cty = NULL;
+    abi->nint = abi->nsse = 0;
+    if (size > 16) {
+        abi->memory = true;
+        return true;
+    }
+    int cls[2] = { ABI_NONE, ABI_NONE };
+    bool dbl[2] = { false, false };
+    if (!classify_fields(st, 0, cls, dbl))
+        return false;
+    std::vector<Type*> parts;
+    for(size_t b=0; b*8 < size; b++) {
+        size_t nb = size - b*8 < 8 ? size - b*8 : 8;
+        if (cls[b] == ABI_SSE) {
+            abi->nsse++;
+            if (nb == 4)
+                parts.push_back(T_float32);
+            else if (dbl[b])
+                parts.push_back(T_float64);
+            else
+                parts.push_back(VectorType::get(T_float32, 2));
+        }
+        else {
+            abi->nint++;
+            parts.push_back(Type::getIntNTy(getGlobalContext(), nb*8));
+        }
+    }
+    abi->cty = parts.size() == 1 ? parts[0] : StructType::get(getGlobalContext(), parts);
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef LLVM32
+typedef Attributes::AttrVal jl_attr_kind;
+#define JL_ATTR(a) Attributes::a
+#else
+typedef Attribute::AttrConst jl_attr_kind;
+#define JL_ATTR(a) Attribute::a
+#endif
+
+static void add_attr(std::vector<AttributeWithIndex> &attrs, unsigned idx, jl_attr_kind av)
+{
+#ifdef LLVM32
+    attrs.push_back(AttributeWithIndex::get(getGlobalContext(), idx,
+                                            ArrayRef<Attributes::AttrVal>(&av, 1)));
+#else
+    attrs.push_back(AttributeWithIndex::get(idx, av));
+#endif
+}
+
+// sets usedTemp if the conversion needs temporary argument space at run time
 static Value *julia_to_native(Type *ty, jl_value_t *jt, Value *jv,
                               jl_value_t *argex, bool addressOf,
-                              int argn, jl_codectx_t *ctx)
+                              int argn, bool &usedTemp, jl_codectx_t *ctx)
 {
     Type *vt = jv->getType();
     if (ty == jl_pvalue_llvmt) {
@@ -229,7 +380,7 @@ static Value *julia_to_native(Type *ty, jl_value_t *jt, Value *jv,
             if (ty->isPointerTy() && ty->getContainedType(0)==vt) {
                 // pass the address of an alloca'd thing, not a box
                 // since those are immutable.
-                Value *slot = builder.CreateAlloca(vt);
+                Value *slot = emit_arg_slot(vt, ctx);
                 builder.CreateStore(jv, slot);
                 return builder.CreateBitCast(slot, ty);
             }
@@ -264,6 +415,7 @@ static Value *julia_to_native(Type *ty, jl_value_t *jt, Value *jv,
             }
             return builder.CreateBitCast(emit_nthptr_addr(jv, (size_t)1), ty); // skip type tag field
         }
+        usedTemp = true;
         Value *p = builder.CreateCall4(value_to_pointer_func,
                                        literal_pointer_val(jl_tparam0(jt)), jv,
                                        ConstantInt::get(T_int32, argn),
@@ -273,7 +425,7 @@ static Value *julia_to_native(Type *ty, jl_value_t *jt, Value *jv,
     else if (jl_is_structtype(jt)) {
         if (addressOf)
             jl_error("ccall: unexpected addressOf operator"); // the only "safe" thing to emit here is the expected struct
-        assert (ty->isStructTy() && (Type*)((jl_datatype_t*)jt)->struct_decl == ty);
+        Type *sty = (Type*)((jl_datatype_t*)jt)->struct_decl;
         jl_value_t *aty = expr_type(argex, ctx);
         if (aty != jt) {
             std::stringstream msg;
@@ -285,8 +437,19 @@ static Value *julia_to_native(Type *ty, jl_value_t *jt, Value *jv,
         //if (!jl_is_structtype(aty))
         //    emit_typecheck(emit_typeof(jv), (jl_value_t*)jl_struct_kind, "ccall: Struct argument called with something that isn't a struct", ctx);
         // //safe thing would be to also check that jl_typeof(aty)->size > sizeof(ty) here and/or at runtime
-        Value *pjv = builder.CreateBitCast(emit_nthptr_addr(jv, (size_t)1), PointerType::get(ty,0));
-        return builder.CreateLoad(pjv, false);
+        Value *pjv = emit_nthptr_addr(jv, (size_t)1);
+        if (ty == sty)
+            return builder.CreateLoad(builder.CreateBitCast(pjv, PointerType::get(ty,0)), false);
+        if (ty == PointerType::get(sty,0)) {
+            // byval: the callee gets a copy
+            return builder.CreateBitCast(pjv, ty);
+        }
+        // in registers, as the type struct_abi gave
+        Value *slot = emit_arg_slot(ty, ctx);
+        builder.CreateMemCpy(builder.CreateBitCast(slot, T_pint8),
+                             builder.CreateBitCast(pjv, T_pint8),
+                             ((jl_datatype_t*)jt)->size, 1);
+        return builder.CreateLoad(slot, false);
     }
     // TODO: error for & with non-pointer argument type
     assert(jl_is_bitstype(jt));
@@ -393,11 +556,29 @@ static Value *emit_ccall(jl_value_t **args, size_t nargs, jl_codectx_t *ctx)
         return literal_pointer_val(jl_nothing);
     }
     size_t i;
-    bool haspointers = false;
     bool isVa = false;
     size_t nargt = jl_tuple_len(tt);
     std::vector<AttributeWithIndex> attrs;
 
+    // registers left for passing structs (see struct_abi)
+    int nint = 6, nsse = 8;
+    jl_struct_abi_t abi;
+    bool sret = false;
+    if (lrt->isStructTy() && struct_abi(rt, &abi)) {
+        if (abi.memory) {
+            sret = true;
+            fargt.push_back(PointerType::get(lrt,0));
+            fargt_sig.push_back(PointerType::get(lrt,0));
+            add_attr(attrs, 1, JL_ATTR(StructRet));
+            nint--;
+            lrt = T_void;
+        }
+        else {
+            lrt = abi.cty;
+        }
+    }
+    size_t argbase = sret ? 2 : 1;  // attribute index of the first argument
+
     for(i=0; i < nargt; i++) {
         jl_value_t *tti = jl_tupleref(tt,i);
         if (jl_is_vararg_type(tti)) {
@@ -412,22 +593,10 @@ static Value *emit_ccall(jl_value_t **args, size_t nargs, jl_codectx_t *ctx)
                 if (jl_signed_type == NULL) {
                     jl_signed_type = jl_get_global(jl_core_module,jl_symbol("Signed"));
                 }
-#ifdef LLVM32
-                Attributes::AttrVal av;
-                if (jl_signed_type && jl_subtype(tti, jl_signed_type, 0))
-                    av = Attributes::SExt;
-                else
-                    av = Attributes::ZExt;
-                attrs.push_back(AttributeWithIndex::get(getGlobalContext(), i+1,
-                                                        ArrayRef<Attributes::AttrVal>(&av, 1)));
-#else
-                Attribute::AttrConst av;
                 if (jl_signed_type && jl_subtype(tti, jl_signed_type, 0))
-                    av = Attribute::SExt;
+                    add_attr(attrs, i+argbase, JL_ATTR(SExt));
                 else
-                    av = Attribute::ZExt;
-                attrs.push_back(AttributeWithIndex::get(i+1, av));
-#endif
+                    add_attr(attrs, i+argbase, JL_ATTR(ZExt));
             }
         }
         Type *t = julia_struct_to_llvm(tti);
@@ -440,6 +609,23 @@ static Value *emit_ccall(jl_value_t **args, size_t nargs, jl_codectx_t *ctx)
             emit_error(msg.str(), ctx);
             return literal_pointer_val(jl_nothing);
         }
+        if (t->isStructTy() && struct_abi(tti, &abi)) {
+            if (abi.memory || abi.nint > nint || abi.nsse > nsse) {
+                t = PointerType::get(t,0);
+                add_attr(attrs, i+argbase, JL_ATTR(ByVal));
+            }
+            else {
+                t = abi.cty;
+                nint -= abi.nint;
+                nsse -= abi.nsse;
+            }
+        }
+        else if (t->isFloatingPointTy() || t->isVectorTy()) {
+            nsse--;
+        }
+        else if (t != T_void) {
+            nint--;
+        }
         fargt.push_back(t);
         if (!isVa)
             fargt_sig.push_back(t);
@@ -486,15 +672,6 @@ static Value *emit_ccall(jl_value_t **args, size_t nargs, jl_codectx_t *ctx)
         return mark_julia_type(builder.CreateBitCast(ary,lrt),rt);
     }
 
-    // see if there are & arguments
-    for(i=4; i < nargs+1; i+=2) {
-        jl_value_t *argi = args[i];
-        if (jl_is_expr(argi) && ((jl_expr_t*)argi)->head == amp_sym) {
-            haspointers = true;
-            break;
-        }
-    }
-
     // make LLVM function object for the target
     Value *llvmf;
     FunctionType *functype = FunctionType::get(lrt, fargt_sig, isVa);
@@ -525,22 +702,22 @@ static Value *emit_ccall(jl_value_t **args, size_t nargs, jl_codectx_t *ctx)
             emit_error(msg.str(), ctx);
             return literal_pointer_val(jl_nothing);
         }
-        llvmf = jl_Module->getOrInsertFunction(f_name, functype);
+        // bound now: a direct call, with no symbol resolution by the JIT
+        llvmf = literal_pointer_val(symaddr, PointerType::get(functype,0));
     }
 
-    // save temp argument area stack pointer
-    Value *saveloc=NULL;
-    Value *stacksave=NULL;
-    if (haspointers) {
-        // TODO: inline this
-        saveloc = builder.CreateCall(save_arg_area_loc_func);
-        stacksave =
-            builder.CreateCall(Intrinsic::getDeclaration(jl_Module,
-                                                         Intrinsic::stacksave));
-    }
+    // save temp argument area stack pointer. the call is removed again if
+    // no argument needs run-time conversion.
+    Instruction *saveloc = builder.CreateCall(save_arg_area_loc_func);
+    bool usedTemp = false;
 
     // emit arguments
-    Value *argvals[(nargs-3)/2];
+    Value *argvals[sret+(nargs-3)/2];
+    Value *sretslot = NULL;
+    if (sret) {
+        sretslot = emit_arg_slot(fargt[0]->getContainedType(0), ctx);
+        argvals[0] = sretslot;
+    }
     int last_depth = ctx->argDepth;
     int nargty = jl_tuple_len(tt);
     for(i=4; i < nargs+1; i+=2) {
@@ -554,16 +731,16 @@ static Value *emit_ccall(jl_value_t **args, size_t nargs, jl_codectx_t *ctx)
         Type *largty;
         jl_value_t *jargty;
         if (isVa && ai >= nargty-1) {
-            largty = fargt[nargty-1];
+            largty = fargt[sret+nargty-1];
             jargty = jl_tparam0(jl_tupleref(tt,nargty-1));
         }
         else {
-            largty = fargt[ai];
+            largty = fargt[sret+ai];
             jargty = jl_tupleref(tt,ai);
         }
         Value *arg;
-        if (largty == jl_pvalue_llvmt ||
-                largty->isStructTy()) {
+        if (largty == jl_pvalue_llvmt || largty->isStructTy() ||
+            (jl_is_structtype(jargty) && !jl_is_array_type(jargty))) {
             arg = emit_expr(argi, ctx, true);
         }
         else {
@@ -585,12 +762,12 @@ static Value *emit_ccall(jl_value_t **args, size_t nargs, jl_codectx_t *ctx)
         }
 #endif
         */
-        argvals[ai] = julia_to_native(largty, jargty, arg, argi, addressOf,
-                                      ai+1, ctx);
+        argvals[sret+ai] = julia_to_native(largty, jargty, arg, argi, addressOf,
+                                           ai+1, usedTemp, ctx);
     }
     // the actual call
     Value *result = builder.CreateCall(llvmf,
-                                       ArrayRef<Value*>(&argvals[0],(nargs-3)/2));
+                                       ArrayRef<Value*>(&argvals[0],sret+(nargs-3)/2));
     if (cc != CallingConv::C)
         ((CallInst*)result)->setCallingConv(cc);
 
@@ -600,14 +777,10 @@ static Value *emit_ccall(jl_value_t **args, size_t nargs, jl_codectx_t *ctx)
     ((CallInst*)result)->setAttributes(AttrListPtr::get(attrs.data(),attrs.size()));
 #endif
     // restore temp argument area stack pointer
-    if (haspointers) {
-        assert(saveloc != NULL);
+    if (usedTemp)
         builder.CreateCall(restore_arg_area_loc_func, saveloc);
-        assert(stacksave != NULL);
-        builder.CreateCall(Intrinsic::getDeclaration(jl_Module,
-                                                     Intrinsic::stackrestore),
-                           stacksave);
-    }
+    else
+        saveloc->eraseFromParent();
     ctx->argDepth = last_depth;
     if (0) { // Enable this to turn on SSPREQ (-fstack-protector) on the function containing this ccall
 #ifdef LLVM32        
@@ -618,6 +791,24 @@ static Value *emit_ccall(jl_value_t **args, size_t nargs, jl_codectx_t *ctx)
     }
 
     JL_GC_POP();
+    if (jl_is_structtype(rt) && (sret || lrt != julia_struct_to_llvm(rt))) {
+        // returned in memory or registers; copy it into a new box
+        Value *src = sretslot;
+        if (!sret) {
+            src = emit_arg_slot(lrt, ctx);
+            builder.CreateStore(result, src);
+        }
+        Value *strct =
+            builder.CreateCall(jlallocobj_func,
+                               ConstantInt::get(T_size,
+                                    sizeof(void*)+((jl_datatype_t*)rt)->size));
+        builder.CreateStore(literal_pointer_val((jl_value_t*)rt),
+                            emit_nthptr_addr(strct, (size_t)0));
+        builder.CreateMemCpy(builder.CreateBitCast(emit_nthptr_addr(strct, (size_t)1), T_pint8),
+                             builder.CreateBitCast(src, T_pint8),
+                             ((jl_datatype_t*)rt)->size, 1);
+        return mark_julia_type(strct, rt);
+    }
     if (lrt == T_void)
         return literal_pointer_val((jl_value_t*)jl_nothing);
     if (lrt->isStructTy()) {
@@ -61,6 +61,20 @@ static Value *literal_pointer_val(void *p)
 // --- mapping between julia and llvm types ---
 
 static Type *julia_struct_to_llvm(jl_value_t *jt);
+static Type *julia_type_to_llvm(jl_value_t *jt);
+
+// Vec{N,T} subtypes map to <N x T> when the size is consistent, NULL otherwise
+static Type *julia_vec_to_llvm(jl_datatype_t *jt)
+{
+    jl_value_t *n = jl_tparam0(jt->super);
+    jl_value_t *et = jl_tparam1(jt->super);
+    if (!jl_is_long(n) || !jl_is_bitstype(et) || et == (jl_value_t*)jl_bool_type)
+        return NULL;
+    size_t nel = jl_unbox_long(n);
+    if (nel == 0 || nel*jl_datatype_size(et) != jl_datatype_size(jt))
+        return NULL;
+    return VectorType::get(julia_type_to_llvm(et), nel);
+}
 
 static Type *julia_type_to_llvm(jl_value_t *jt)
 {
@@ -75,6 +89,11 @@ static Type *julia_type_to_llvm(jl_value_t *jt)
             lt = T_int8;
         return PointerType::get(lt, 0);
     }
+    if (jl_is_vec_type(jt)) {
+        Type *vt = julia_vec_to_llvm((jl_datatype_t*)jt);
+        if (vt != NULL)
+            return vt;
+    }
     if (jl_is_bitstype(jt)) {
         int nb = jl_datatype_size(jt)*8;
         if (nb == 8)  return T_int8;
@@ -370,8 +389,10 @@ static Value *emit_bounds_check(Value *i, Value *len, jl_codectx_t *ctx)
 {
     Value *im1 = builder.CreateSub(i, ConstantInt::get(T_size, 1));
 #if CHECK_BOUNDS==1
-    Value *ok = builder.CreateICmpULT(im1, len);
-    raise_exception_unless(ok, jlboundserr_var, ctx);
+    if (ctx->inbounds == 0) {
+        Value *ok = builder.CreateICmpULT(im1, len);
+        raise_exception_unless(ok, jlboundserr_var, ctx);
+    }
 #endif
     return im1;
 }
@@ -401,6 +422,45 @@ static void emit_func_check(Value *x, jl_codectx_t *ctx)
 
 // --- loading and storing ---
 
+static MDNode *tbaa_make_child(const char *name, MDNode *parent)
+{
+    Value *ops[2] = { MDString::get(jl_LLVMContext, name), parent };
+    return MDNode::get(jl_LLVMContext, ArrayRef<Value*>(ops));
+}
+
+static Instruction *tbaa_decorate(MDNode *md, Instruction *load_or_store)
+{
+    if (md != NULL)
+        load_or_store->setMetadata(LLVMContext::MD_tbaa, md);
+    return load_or_store;
+}
+
+// fields of immutable objects are only written while constructing them,
+// like boxed bits values, which emit_unbox may load as a whole
+static MDNode *tbaa_field(jl_datatype_t *sty)
+{
+    return sty->mutabl ? tbaa_user : tbaa_value;
+}
+
+// loads and stores of LLVM vectors default to the natural alignment of the
+// whole vector, but boxes and arrays only guarantee that of the element type
+static Value *emit_elalign_load(Value *ptr, MDNode *tbaa=NULL)
+{
+    LoadInst *ld = builder.CreateLoad(ptr, false);
+    Type *t = ptr->getType()->getContainedType(0);
+    if (t->isVectorTy())
+        ld->setAlignment(t->getScalarSizeInBits()/8);
+    return tbaa_decorate(tbaa, ld);
+}
+
+static Value *emit_elalign_store(Value *v, Value *ptr, MDNode *tbaa=NULL)
+{
+    StoreInst *st = builder.CreateStore(v, ptr);
+    if (v->getType()->isVectorTy())
+        st->setAlignment(v->getType()->getScalarSizeInBits()/8);
+    return tbaa_decorate(tbaa, st);
+}
+
 static Value *emit_nthptr_addr(Value *v, size_t n)
 {
     return builder.CreateGEP(builder.CreateBitCast(v, jl_ppvalue_llvmt),
@@ -412,29 +472,29 @@ static Value *emit_nthptr_addr(Value *v, Value *idx)
     return builder.CreateGEP(builder.CreateBitCast(v, jl_ppvalue_llvmt), idx);
 }
 
-static Value *emit_nthptr(Value *v, size_t n)
+static Value *emit_nthptr(Value *v, size_t n, MDNode *tbaa=NULL)
 {
     // p = (jl_value_t**)v; p[n]
     Value *vptr = emit_nthptr_addr(v, n);
-    return builder.CreateLoad(vptr, false);
+    return tbaa_decorate(tbaa, builder.CreateLoad(vptr, false));
 }
 
-static Value *emit_nthptr(Value *v, Value *idx)
+static Value *emit_nthptr(Value *v, Value *idx, MDNode *tbaa=NULL)
 {
     // p = (jl_value_t**)v; p[n]
     Value *vptr = emit_nthptr_addr(v, idx);
-    return builder.CreateLoad(vptr, false);
+    return tbaa_decorate(tbaa, builder.CreateLoad(vptr, false));
 }
 
 static Value *typed_load(Value *ptr, Value *idx_0based, jl_value_t *jltype,
-                         jl_codectx_t *ctx)
+                         jl_codectx_t *ctx, MDNode *tbaa=NULL)
 {
     Type *elty = julia_type_to_llvm(jltype);
     assert(elty != NULL);
     bool isbool=false;
     if (elty==T_int1) { elty = T_int8; isbool=true; }
     Value *data = builder.CreateBitCast(ptr, PointerType::get(elty, 0));
-    Value *elt = builder.CreateLoad(builder.CreateGEP(data, idx_0based), false);
+    Value *elt = emit_elalign_load(builder.CreateGEP(data, idx_0based), tbaa);
     if (elty == jl_pvalue_llvmt) {
         null_pointer_check(elt, ctx);
     }
@@ -446,7 +506,8 @@ static Value *typed_load(Value *ptr, Value *idx_0based, jl_value_t *jltype,
 static Value *emit_unbox(Type *to, Type *pto, Value *x);
 
 static Value *typed_store(Value *ptr, Value *idx_0based, Value *rhs,
-                          jl_value_t *jltype, jl_codectx_t *ctx)
+                          jl_value_t *jltype, jl_codectx_t *ctx,
+                          MDNode *tbaa=NULL)
 {
     Type *elty = julia_type_to_llvm(jltype);
     assert(elty != NULL);
@@ -456,7 +517,7 @@ static Value *typed_store(Value *ptr, Value *idx_0based, Value *rhs,
     else
         rhs = boxed(rhs);
     Value *data = builder.CreateBitCast(ptr, PointerType::get(elty, 0));
-    return builder.CreateStore(rhs, builder.CreateGEP(data, idx_0based));
+    return emit_elalign_store(rhs, builder.CreateGEP(data, idx_0based), tbaa);
 }
 
 // --- convert boolean value to julia ---
@@ -573,7 +634,8 @@ static Value *emit_arraysize(Value *t, Value *dim)
 #endif
     Value *dbits =
         emit_nthptr(t, builder.CreateAdd(dim,
-                                         ConstantInt::get(dim->getType(), o)));
+                                         ConstantInt::get(dim->getType(), o)),
+                    tbaa_arraysize);
     return builder.CreatePtrToInt(dbits, T_size);
 }
 
@@ -584,13 +646,13 @@ static Value *emit_arraysize(Value *t, int dim)
 
 static Value *emit_arraylen(Value *t)
 {
-    Value *lenbits = emit_nthptr(t, 2);
+    Value *lenbits = emit_nthptr(t, 2, tbaa_arraylen);
     return builder.CreatePtrToInt(lenbits, T_size);
 }
 
 static Value *emit_arrayptr(Value *t)
 {
-    return emit_nthptr(t, 1);
+    return emit_nthptr(t, 1, tbaa_arrayptr);
 }
 
 static Value *data_pointer(Value *x)
@@ -599,15 +661,22 @@ static Value *data_pointer(Value *x)
                              ConstantInt::get(T_size, 1));
 }
 
+// checked is false when the caller has proven the index in bounds
 static Value *emit_array_nd_index(Value *a, size_t nd, jl_value_t **args,
-                                  size_t nidxs, jl_codectx_t *ctx)
+                                  size_t nidxs, bool checked, jl_codectx_t *ctx)
 {
     Value *i = ConstantInt::get(T_size, 0);
     Value *stride = ConstantInt::get(T_size, 1);
 #if CHECK_BOUNDS==1
-    BasicBlock *failBB = BasicBlock::Create(getGlobalContext(), "oob");
-    BasicBlock *endBB = BasicBlock::Create(getGlobalContext(), "idxend");
+    checked = checked && ctx->inbounds == 0;
+#else
+    checked = false;
 #endif
+    BasicBlock *failBB=NULL, *endBB=NULL;
+    if (checked) {
+        failBB = BasicBlock::Create(getGlobalContext(), "oob");
+        endBB = BasicBlock::Create(getGlobalContext(), "idxend");
+    }
     for(size_t k=0; k < nidxs; k++) {
         Value *ii = emit_unbox(T_size, T_psize, emit_unboxed(args[k], ctx));
         ii = builder.CreateSub(ii, ConstantInt::get(T_size, 1));
@@ -615,30 +684,30 @@ static Value *emit_array_nd_index(Value *a, size_t nd, jl_value_t **args,
         if (k < nidxs-1) {
             Value *d =
                 k >= nd ? ConstantInt::get(T_size, 1) : emit_arraysize(a, k+1);
-#if CHECK_BOUNDS==1
-            BasicBlock *okBB = BasicBlock::Create(getGlobalContext(), "ib");
-            // if !(i < d) goto error
-            builder.CreateCondBr(builder.CreateICmpULT(ii, d), okBB, failBB);
-            ctx->f->getBasicBlockList().push_back(okBB);
-            builder.SetInsertPoint(okBB);
-#endif
+            if (checked) {
+                BasicBlock *okBB = BasicBlock::Create(getGlobalContext(), "ib");
+                // if !(i < d) goto error
+                builder.CreateCondBr(builder.CreateICmpULT(ii, d), okBB, failBB);
+                ctx->f->getBasicBlockList().push_back(okBB);
+                builder.SetInsertPoint(okBB);
+            }
             stride = builder.CreateMul(stride, d);
         }
     }
-#if CHECK_BOUNDS==1
-    Value *alen = emit_arraylen(a);
-    // if !(i < alen) goto error
-    builder.CreateCondBr(builder.CreateICmpULT(i, alen), endBB, failBB);
-
-    ctx->f->getBasicBlockList().push_back(failBB);
-    builder.SetInsertPoint(failBB);
-    builder.CreateCall2(jlthrow_line_func, builder.CreateLoad(jlboundserr_var),
-                        ConstantInt::get(T_int32, ctx->lineno));
-    builder.CreateUnreachable();
-
-    ctx->f->getBasicBlockList().push_back(endBB);
-    builder.SetInsertPoint(endBB);
-#endif
+    if (checked) {
+        Value *alen = emit_arraylen(a);
+        // if !(i < alen) goto error
+        builder.CreateCondBr(builder.CreateICmpULT(i, alen), endBB, failBB);
+
+        ctx->f->getBasicBlockList().push_back(failBB);
+        builder.SetInsertPoint(failBB);
+        builder.CreateCall2(jlthrow_line_func, builder.CreateLoad(jlboundserr_var),
+                            ConstantInt::get(T_int32, ctx->lineno));
+        builder.CreateUnreachable();
+
+        ctx->f->getBasicBlockList().push_back(endBB);
+        builder.SetInsertPoint(endBB);
+    }
 
     return i;
 }
@@ -657,8 +726,9 @@ static Value *tpropagate(Value *a, Value *b)
 static Value *init_bits_value(Value *newv, Value *jt, Type *t, Value *v)
 {
     builder.CreateStore(jt, builder.CreateBitCast(newv, jl_ppvalue_llvmt));
-    builder.CreateStore(v , builder.CreateBitCast(data_pointer(newv),
-                                                  PointerType::get(t,0)));
+    emit_elalign_store(v, builder.CreateBitCast(data_pointer(newv),
+                                                PointerType::get(t,0)),
+                       tbaa_value);
     return newv;
 }
 
@@ -32,6 +32,7 @@
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/Host.h"
 #include "llvm/Config/llvm-config.h"
 #include <setjmp.h>
 #ifdef __WIN32__
@@ -105,6 +106,17 @@ static Type *T_void;
 // constants
 static Value *V_null;
 
+// type-based alias analysis nodes. accesses with different tags never
+// alias; untagged accesses (e.g. through Ptr) may alias anything.
+static MDNode *tbaa_root;      // everything julia code stores
+static MDNode *tbaa_value;     // contents of boxed bits values
+static MDNode *tbaa_user;      // fields of user-defined objects
+static MDNode *tbaa_array;     // jl_array_t header fields
+static MDNode *tbaa_arrayptr;  // the data pointer
+static MDNode *tbaa_arraylen;  // the length
+static MDNode *tbaa_arraysize; // the dimensions
+static MDNode *tbaa_arraybuf;  // array elements
+
 // global vars
 static GlobalVariable *jltrue_var;
 static GlobalVariable *jlfalse_var;
@@ -114,6 +126,10 @@ static GlobalVariable *jlfloat32temp_var;
 static GlobalVariable *jlpgcstack_var;
 #endif
 static GlobalVariable *jlexc_var;
+#ifdef JULIA_THREADS
+static Function *jlpgcstack_addr_func;
+static Function *jlexc_addr_func;
+#endif
 static GlobalVariable *jldiverr_var;
 static GlobalVariable *jlundeferr_var;
 static GlobalVariable *jldomerr_var;
@@ -172,6 +188,36 @@ static Function *resetstkoflw_func;
   - try using fastcc to get tail calls
 */
 
+// --- per-method compile statistics ---
+
+// wall time in seconds spent in each stage of compiling one method, and the
+// size of what it produced. emit_time excludes methods compiled while this
+// one was being emitted, so the times of all entries add up to the total.
+struct jl_compile_stat_t {
+    jl_sym_t *name;
+    jl_value_t *file;
+    int line;
+    double emit_time;       // emit_function
+    double opt_time;        // FPM->run
+    double native_time;     // machine code generation
+    size_t ninstrs_emitted; // LLVM instructions before optimization
+    size_t ninstrs;         // and after
+    size_t native_bytes;
+};
+
+static std::map<Function*, jl_compile_stat_t> compile_stats;
+static double nested_compile_time = 0;
+
+static size_t count_instructions(Function *f)
+{
+    size_t n = 0;
+    for (Function::iterator bb = f->begin(); bb != f->end(); ++bb)
+        n += bb->size();
+    return n;
+}
+
+static size_t jit_code_size(void *code);
+
 // --- entry point ---
 
 static Function *emit_function(jl_lambda_info_t *lam, bool cstyle);
@@ -185,6 +231,9 @@ static Function *to_function(jl_lambda_info_t *li, bool cstyle)
     bool last_n_c = nested_compile;
     nested_compile = true;
     Function *f = NULL;
+    double t0 = clock_now();
+    double outer_nested_time = nested_compile_time;
+    nested_compile_time = 0;
     JL_TRY {
         f = emit_function(li, cstyle);
     }
@@ -192,6 +241,7 @@ static Function *to_function(jl_lambda_info_t *li, bool cstyle)
         li->functionObject = NULL;
         li->cFunctionObject = NULL;
         nested_compile = last_n_c;
+        nested_compile_time = outer_nested_time + (clock_now()-t0);
         if (old != NULL) {
             builder.SetInsertPoint(old);
             builder.SetCurrentDebugLocation(olddl);
@@ -210,9 +260,22 @@ static Function *to_function(jl_lambda_info_t *li, bool cstyle)
     }
     assert(f != NULL);
     nested_compile = last_n_c;
+    double t1 = clock_now();
+    jl_compile_stat_t &st = compile_stats[f];
+    st.name = li->name;
+    st.file = li->file;
+    st.line = li->line;
+    st.emit_time = (t1-t0) - nested_compile_time;
+    st.ninstrs_emitted = count_instructions(f);
     //f->dump();
     //verifyFunction(*f);
     FPM->run(*f);
+    double t2 = clock_now();
+    st.opt_time = t2-t1;
+    st.ninstrs = count_instructions(f);
+    st.native_time = 0;
+    st.native_bytes = 0;
+    nested_compile_time = outer_nested_time + (t2-t0);
     //n_compile++;
     // print out the function's LLVM code
     //ios_printf(ios_stderr, "%s:%d\n",
@@ -235,9 +298,19 @@ extern "C" void jl_generate_fptr(jl_function_t *f)
     Function *llvmf = (Function*)li->functionObject;
     if (li->fptr == &jl_trampoline) {
         JL_SIGATOMIC_BEGIN();
+        double t0 = clock_now();
         li->fptr = (jl_fptr_t)jl_ExecutionEngine->getPointerToFunction(llvmf);
-        if (li->cFunctionObject != NULL)
-            (void)jl_ExecutionEngine->getPointerToFunction((Function*)li->cFunctionObject);
+        size_t nbytes = jit_code_size((void*)li->fptr);
+        if (li->cFunctionObject != NULL) {
+            void *cptr =
+                jl_ExecutionEngine->getPointerToFunction((Function*)li->cFunctionObject);
+            nbytes += jit_code_size(cptr);
+        }
+        std::map<Function*, jl_compile_stat_t>::iterator st = compile_stats.find(llvmf);
+        if (st != compile_stats.end()) {
+            st->second.native_time += clock_now()-t0;
+            st->second.native_bytes += nbytes;
+        }
         JL_SIGATOMIC_END();
         llvmf->deleteBody();
         if (li->cFunctionObject != NULL)
@@ -268,6 +341,32 @@ void jl_cstyle_compile(jl_function_t *f)
     }
 }
 
+// one tuple (name, file, line, emit_time, opt_time, native_time,
+// ninstrs_emitted, ninstrs, native_bytes) per compiled method
+extern "C" DLLEXPORT jl_array_t *jl_compile_stats(void)
+{
+    jl_array_t *a = jl_alloc_cell_1d(0);
+    jl_value_t *t = NULL;
+    JL_GC_PUSH(&a, &t);
+    for (std::map<Function*, jl_compile_stat_t>::iterator it = compile_stats.begin();
+         it != compile_stats.end(); ++it) {
+        jl_compile_stat_t &st = it->second;
+        t = (jl_value_t*)jl_alloc_tuple(9);
+        jl_tupleset(t, 0, st.name);
+        jl_tupleset(t, 1, st.file);
+        jl_tupleset(t, 2, jl_box_long(st.line));
+        jl_tupleset(t, 3, jl_box_float64(st.emit_time));
+        jl_tupleset(t, 4, jl_box_float64(st.opt_time));
+        jl_tupleset(t, 5, jl_box_float64(st.native_time));
+        jl_tupleset(t, 6, jl_box_long(st.ninstrs_emitted));
+        jl_tupleset(t, 7, jl_box_long(st.ninstrs));
+        jl_tupleset(t, 8, jl_box_long(st.native_bytes));
+        jl_cell_1d_push(a, t);
+    }
+    JL_GC_POP();
+    return a;
+}
+
 extern "C" jl_function_t *jl_get_specialization(jl_function_t *f, jl_tuple_t *types);
 
 extern "C" DLLEXPORT
@@ -302,12 +401,53 @@ const jl_value_t *jl_dump_function(jl_function_t *f, jl_tuple_t *types)
     return jl_cstr_to_string((char*)stream.str().c_str());
 }
 
+// C-callable entry points already handed out, keyed by function, return
+// type and argument types. everything in a key is kept in jl_cfunction_roots.
+static std::map<std::vector<jl_value_t*>, void*> cfunction_cache;
+extern "C" {
+jl_array_t *jl_cfunction_roots = NULL;
+}
+
+// a method was added to f, so the pointers handed out for it may no longer
+// be what dispatch would pick; they are compiled again on the next request
+extern "C" {
+size_t jl_cfunction_age = 0;  // changes whenever pointers are forgotten
+}
+
+extern "C" void jl_forget_cfunctions(jl_function_t *f)
+{
+    std::vector<jl_value_t*> key(1, (jl_value_t*)f);
+    std::map<std::vector<jl_value_t*>, void*>::iterator it = cfunction_cache.lower_bound(key);
+    if (it == cfunction_cache.end() || it->first[0] != (jl_value_t*)f)
+        return;
+    while (it != cfunction_cache.end() && it->first[0] == (jl_value_t*)f)
+        cfunction_cache.erase(it++);
+    jl_cfunction_age++;
+    // root only what the remaining keys hold
+    jl_array_t *roots = jl_alloc_cell_1d(0);
+    JL_GC_PUSH(&roots);
+    for(it = cfunction_cache.begin(); it != cfunction_cache.end(); it++) {
+        for(size_t i=0; i < it->first.size(); i++)
+            jl_cell_1d_push(roots, it->first[i]);
+    }
+    jl_cfunction_roots = roots;
+    JL_GC_POP();
+}
+
 extern "C" DLLEXPORT
 void *jl_function_ptr(jl_function_t *f, jl_value_t *rt, jl_value_t *argt)
 {
     JL_TYPECHK(jl_function_ptr, type, rt);
     JL_TYPECHK(jl_function_ptr, tuple, argt);
     JL_TYPECHK(jl_function_ptr, type, argt);
+    std::vector<jl_value_t*> key;
+    key.push_back((jl_value_t*)f);
+    key.push_back(rt);
+    for(size_t i=0; i < jl_tuple_len(argt); i++)
+        key.push_back(jl_tupleref(argt, i));
+    std::map<std::vector<jl_value_t*>, void*>::iterator it = cfunction_cache.find(key);
+    if (it != cfunction_cache.end())
+        return it->second;
     if (jl_is_gf(f) && (jl_is_leaf_type(rt) || rt == (jl_value_t*)jl_bottom_type) && jl_is_leaf_type(argt)) {
         jl_function_t *ff = jl_get_specialization(f, (jl_tuple_t*)argt);
         if (ff != NULL && ff->env==(jl_value_t*)jl_null && ff->linfo != NULL) {
@@ -331,7 +471,14 @@ void *jl_function_ptr(jl_function_t *f, jl_value_t *rt, jl_value_t *argt)
                                   li->name->name);
                     }
                 }
-                return jl_ExecutionEngine->getPointerToFunction((Function*)ff->linfo->cFunctionObject);
+                void *fptr = jl_ExecutionEngine->getPointerToFunction((Function*)ff->linfo->cFunctionObject);
+                if (jl_cfunction_roots == NULL)
+                    jl_cfunction_roots = jl_alloc_cell_1d(0);
+                jl_cell_1d_push(jl_cfunction_roots, (jl_value_t*)f);
+                jl_cell_1d_push(jl_cfunction_roots, rt);
+                jl_cell_1d_push(jl_cfunction_roots, argt);
+                cfunction_cache[key] = fptr;
+                return fptr;
             }
         }
     }
@@ -339,6 +486,14 @@ void *jl_function_ptr(jl_function_t *f, jl_value_t *rt, jl_value_t *argt)
     return NULL;
 }
 
+// a loop over i = a:length(A) whose body can index A with i unchecked;
+// see find_inbounds_loops
+typedef struct {
+    jl_sym_t *ary;
+    jl_sym_t *idx;
+    size_t first, last;  // statements of the loop body
+} jl_inbounds_loop_t;
+
 // information about the context of a piece of code: its enclosing
 // function and module, and visible local variables and labels.
 typedef struct {
@@ -370,6 +525,11 @@ typedef struct {
     bool vaStack;      // varargs stack-allocated
     int nReqArgs;
     int lineno;
+    int fastmath;      // nesting depth of @fastmath blocks
+    int inbounds;      // nesting depth of @inbounds blocks
+    std::vector<jl_inbounds_loop_t> *inboundsLoops;
+    size_t curStmt;    // index of the statement being emitted
+    Value *pgcstack;   // address of the running thread's jl_pgcstack
 } jl_codectx_t;
 
 static Value *emit_expr(jl_value_t *expr, jl_codectx_t *ctx, bool boxed=true,
@@ -602,6 +762,263 @@ static std::set<jl_sym_t*> find_volatile_vars(jl_array_t *stmts)
     return vv;
 }
 
+// --- bounds check elimination ---
+
+// `for i = a:b` is lowered to
+//     cnt = a; lim = b
+//   top:
+//     gotoifnot(cnt <= lim, exit)
+//     i = cnt
+//     ...body...
+//     cnt = cnt + 1
+//     goto top
+// when a is a positive constant, b is length(A) and none of i, cnt, lim
+// or A is assigned anywhere else, A[i] is in bounds throughout the body
+// as long as the body cannot resize A. we only trust bodies whose calls
+// are all to intrinsics and non-reentrant builtins, i.e. fully inlined
+// kernels.
+
+static jl_sym_t *var_sym(jl_value_t *e)
+{
+    if (jl_is_symbolnode(e))
+        return jl_symbolnode_sym(e);
+    if (jl_is_symbol(e))
+        return (jl_sym_t*)e;
+    return NULL;
+}
+
+static bool is_call(jl_value_t *e)
+{
+    return jl_is_expr(e) && (((jl_expr_t*)e)->head == call_sym ||
+                             ((jl_expr_t*)e)->head == call1_sym);
+}
+
+static int called_intrinsic(jl_value_t *e, jl_codectx_t *ctx)
+{
+    if (!is_call(e))
+        return -1;
+    jl_value_t *f = static_eval(jl_exprarg(e,0), ctx, true);
+    if (f == NULL || !jl_typeis(f, jl_intrinsic_type))
+        return -1;
+    return jl_unbox_int32(f);
+}
+
+static jl_fptr_t called_builtin(jl_value_t *e, jl_codectx_t *ctx)
+{
+    if (!is_call(e))
+        return NULL;
+    jl_value_t *f = static_eval(jl_exprarg(e,0), ctx, true);
+    if (f == NULL || !jl_is_function(f))
+        return NULL;
+    return ((jl_function_t*)f)->fptr;
+}
+
+// look through box and unbox
+static jl_value_t *strip_boxing(jl_value_t *e, jl_codectx_t *ctx)
+{
+    while (is_call(e) && jl_array_dim0(((jl_expr_t*)e)->args) == 3) {
+        int fi = called_intrinsic(e, ctx);
+        if (fi != JL_I::box && fi != JL_I::unbox)
+            break;
+        e = jl_exprarg(e,2);
+    }
+    return e;
+}
+
+static bool no_reentrant_calls(jl_value_t *e, jl_codectx_t *ctx)
+{
+    if (!jl_is_expr(e))
+        return true;
+    jl_expr_t *ex = (jl_expr_t*)e;
+    size_t i = 0;
+    if (is_call(e)) {
+        int fi = called_intrinsic(e, ctx);
+        if (fi == JL_I::ccall)
+            return false;
+        if (fi == -1) {
+            jl_fptr_t fp = called_builtin(e, ctx);
+            if (!(fp == &jl_f_arrayref || fp == &jl_f_arrayset ||
+                  fp == &jl_f_arraylen || fp == &jl_f_arraysize ||
+                  fp == &jl_f_tupleref || fp == &jl_f_tuplelen ||
+                  fp == &jl_f_tuple || fp == &jl_f_get_field ||
+                  fp == &jl_f_set_field || fp == &jl_f_typeassert ||
+                  fp == &jl_f_isa || fp == &jl_f_is || fp == &jl_f_typeof))
+                return false;
+        }
+        i = 1;
+    }
+    else if (ex->head == method_sym) {
+        return false;
+    }
+    for(; i < jl_array_dim0(ex->args); i++) {
+        if (!no_reentrant_calls(jl_exprarg(ex,i), ctx))
+            return false;
+    }
+    return true;
+}
+
+// indexes of the statements assigning s
+static std::vector<size_t> assignments_to(jl_array_t *stmts, jl_sym_t *s)
+{
+    std::vector<size_t> as;
+    for(size_t i=0; i < jl_array_dim0(stmts); i++) {
+        jl_value_t *st = jl_cellref(stmts,i);
+        if (jl_is_expr(st) && ((jl_expr_t*)st)->head == assign_sym &&
+            var_sym(jl_exprarg(st,0)) == s)
+            as.push_back(i);
+    }
+    return as;
+}
+
+static bool only_local_assigns(jl_sym_t *s, jl_codectx_t *ctx)
+{
+    return s != NULL && !(*ctx->isCaptured)[s->name];
+}
+
+// the array whose length is the loop limit, or NULL
+static jl_sym_t *limit_array(jl_array_t *stmts, jl_sym_t *lim, size_t before,
+                             size_t *where, jl_codectx_t *ctx)
+{
+    for(int depth=0; depth < 2; depth++) {
+        if (!only_local_assigns(lim, ctx))
+            return NULL;
+        std::vector<size_t> as = assignments_to(stmts, lim);
+        if (as.size() != 1 || as[0] >= before)
+            return NULL;
+        jl_value_t *rhs = strip_boxing(jl_exprarg(jl_cellref(stmts,as[0]),1), ctx);
+        jl_fptr_t fp = called_builtin(rhs, ctx);
+        jl_expr_t *ex = (jl_expr_t*)rhs;
+        *where = as[0];
+        if (fp == &jl_f_arraylen && jl_array_dim0(ex->args) == 2)
+            return var_sym(jl_exprarg(ex,1));
+        if (fp == &jl_f_arraysize && jl_array_dim0(ex->args) == 3) {
+            jl_value_t *aty = expr_type(jl_exprarg(ex,1), ctx);
+            jl_value_t *d = jl_exprarg(ex,2);
+            jl_value_t *nd = jl_is_array_type(aty) ? jl_tparam1(aty) : NULL;
+            if (nd != NULL && jl_is_long(nd) && jl_unbox_long(nd) == 1 &&
+                jl_is_long(d) && jl_unbox_long(d) == 1)
+                return var_sym(jl_exprarg(ex,1));
+            return NULL;
+        }
+        // n = length(A); for i = 1:n
+        lim = var_sym(rhs);
+        before = as[0];
+    }
+    return NULL;
+}
+
+static bool is_counter_update(jl_value_t *rhs, jl_sym_t *cnt, jl_codectx_t *ctx)
+{
+    rhs = strip_boxing(rhs, ctx);
+    if (called_intrinsic(rhs, ctx) != JL_I::add_int ||
+        jl_array_dim0(((jl_expr_t*)rhs)->args) != 3)
+        return false;
+    jl_value_t *a = strip_boxing(jl_exprarg(rhs,1), ctx);
+    jl_value_t *b = strip_boxing(jl_exprarg(rhs,2), ctx);
+    if (var_sym(a) == cnt) { jl_value_t *t = a; a = b; b = t; }
+    return var_sym(b) == cnt && jl_is_long(a) && jl_unbox_long(a) > 0;
+}
+
+static void find_inbounds_loops(jl_array_t *stmts, jl_codectx_t *ctx)
+{
+    size_t n = jl_array_dim0(stmts);
+    for(size_t s=1; s+1 < n; s++) {
+        jl_value_t *test = jl_cellref(stmts,s);
+        jl_value_t *top = jl_cellref(stmts,s-1);
+        jl_value_t *iasgn = jl_cellref(stmts,s+1);
+        if (!jl_is_expr(test) || ((jl_expr_t*)test)->head != goto_ifnot_sym ||
+            !jl_is_labelnode(top) || !jl_is_expr(iasgn) ||
+            ((jl_expr_t*)iasgn)->head != assign_sym)
+            continue;
+        // gotoifnot(sle_int(cnt, lim), exit); i = cnt
+        jl_value_t *cond = strip_boxing(jl_exprarg(test,0), ctx);
+        if (called_intrinsic(cond, ctx) != JL_I::sle_int)
+            continue;
+        jl_sym_t *cnt = var_sym(strip_boxing(jl_exprarg(cond,1), ctx));
+        jl_sym_t *lim = var_sym(strip_boxing(jl_exprarg(cond,2), ctx));
+        jl_sym_t *idx = var_sym(jl_exprarg(iasgn,0));
+        if (var_sym(jl_exprarg(iasgn,1)) != cnt || !only_local_assigns(cnt, ctx) ||
+            !only_local_assigns(idx, ctx) || assignments_to(stmts, idx).size() != 1)
+            continue;
+        // the loop body runs up to the last jump back to the top
+        size_t last = 0;
+        for(size_t j=s+2; j < n; j++) {
+            jl_value_t *st = jl_cellref(stmts,j);
+            if (jl_is_gotonode(st) &&
+                jl_gotonode_label(st) == jl_labelnode_label(top))
+                last = j;
+        }
+        if (last == 0)
+            continue;
+        // cnt starts at a positive constant and only counts up
+        std::vector<size_t> cas = assignments_to(stmts, cnt);
+        bool ok = true;
+        int ninit = 0;
+        for(size_t k=0; k < cas.size() && ok; k++) {
+            jl_value_t *rhs = jl_exprarg(jl_cellref(stmts,cas[k]),1);
+            if (cas[k] < s-1 && jl_is_long(rhs) && jl_unbox_long(rhs) > 0)
+                ninit++;
+            else
+                ok = (cas[k] > s+1 && cas[k] < last &&
+                      is_counter_update(rhs, cnt, ctx));
+        }
+        if (!ok || ninit != 1)
+            continue;
+        size_t limpos;
+        jl_sym_t *ary = limit_array(stmts, lim, s-1, &limpos, ctx);
+        if (!only_local_assigns(ary, ctx))
+            continue;
+        std::vector<size_t> aas = assignments_to(stmts, ary);
+        for(size_t k=0; k < aas.size(); k++) {
+            if (aas[k] > limpos)
+                ok = false;
+        }
+        // nothing may resize A between computing the limit and the end of
+        // the loop, and no enclosing loop may re-enter the loop without
+        // recomputing the limit
+        for(size_t j=limpos+1; j <= last && ok; j++) {
+            ok = no_reentrant_calls(jl_cellref(stmts,j), ctx);
+        }
+        for(size_t j=last+1; j < n && ok; j++) {
+            jl_value_t *st = jl_cellref(stmts,j);
+            jl_value_t *target = NULL;
+            if (jl_is_gotonode(st))
+                target = st;
+            else if (jl_is_expr(st) && ((jl_expr_t*)st)->head == goto_ifnot_sym)
+                target = jl_exprarg(st,1);
+            if (target == NULL)
+                continue;
+            long l = jl_is_gotonode(target) ? jl_gotonode_label(target) :
+                jl_unbox_long(target);
+            for(size_t k=limpos+1; k < s; k++) {
+                jl_value_t *lb = jl_cellref(stmts,k);
+                if (jl_is_labelnode(lb) && jl_labelnode_label(lb) == l)
+                    ok = false;
+            }
+        }
+        if (!ok)
+            continue;
+        jl_inbounds_loop_t l = { ary, idx, s+2, last };
+        ctx->inboundsLoops->push_back(l);
+    }
+}
+
+// whether A[i] is known to be in bounds at the current statement
+static bool index_known_inbounds(jl_value_t *a, jl_value_t *i, jl_codectx_t *ctx)
+{
+    jl_sym_t *as = var_sym(a);
+    jl_sym_t *is = var_sym(i);
+    if (as == NULL || is == NULL)
+        return false;
+    std::vector<jl_inbounds_loop_t>::iterator it = ctx->inboundsLoops->begin();
+    for(; it != ctx->inboundsLoops->end(); it++) {
+        if (it->ary == as && it->idx == is &&
+            ctx->curStmt >= it->first && ctx->curStmt <= it->last)
+            return true;
+    }
+    return false;
+}
+
 // --- gc root counting ---
 
 static bool expr_is_symbol(jl_value_t *e)
@@ -852,12 +1269,12 @@ static Value *emit_getfield(jl_value_t *expr, jl_sym_t *name, jl_codectx_t *ctx)
                                                        sty->fields[idx].offset + sizeof(void*)));
                 JL_GC_POP();
                 if (sty->fields[idx].isptr) {
-                    Value *fldv = builder.CreateLoad(builder.CreateBitCast(addr,jl_ppvalue_llvmt));
+                    Value *fldv = tbaa_decorate(tbaa_field(sty), builder.CreateLoad(builder.CreateBitCast(addr,jl_ppvalue_llvmt)));
                     null_pointer_check(fldv, ctx);
                     return fldv;
                 }
                 else {
-                    return typed_load(addr, ConstantInt::get(T_size, 0), jfty, ctx);
+                    return typed_load(addr, ConstantInt::get(T_size, 0), jfty, ctx, tbaa_field(sty));
                 }
             }
             else {
@@ -900,11 +1317,11 @@ static void emit_setfield(jl_datatype_t *sty, Value *strct, size_t idx,
                               ConstantInt::get(T_size, sty->fields[idx].offset + sizeof(void*)));
         jl_value_t *jfty = jl_tupleref(sty->types, idx);
         if (sty->fields[idx].isptr) {
-            builder.CreateStore(boxed(rhs),
-                                builder.CreateBitCast(addr, jl_ppvalue_llvmt));
+            tbaa_decorate(tbaa_field(sty), builder.CreateStore(boxed(rhs),
+                                builder.CreateBitCast(addr, jl_ppvalue_llvmt)));
         }
         else {
-            typed_store(addr, ConstantInt::get(T_size, 0), rhs, jfty, ctx);
+            typed_store(addr, ConstantInt::get(T_size, 0), rhs, jfty, ctx, tbaa_field(sty));
         }
     }
     else {
@@ -1331,14 +1748,15 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
                 if (jl_is_long(ndp) || nargs==2) {
                     Value *ary = emit_expr(args[1], ctx);
                     size_t nd = jl_is_long(ndp) ? jl_unbox_long(ndp) : 1;
-                    Value *idx = emit_array_nd_index(ary, nd, &args[2], nargs-1, ctx);
+                    bool checked = !(nargs==2 && index_known_inbounds(args[1], args[2], ctx));
+                    Value *idx = emit_array_nd_index(ary, nd, &args[2], nargs-1, checked, ctx);
                     JL_GC_POP();
                     if (jl_array_store_unboxed(ety) &&
                         ((jl_datatype_t*)ety)->size == 0) {
                         jl_new_struct_uninit((jl_datatype_t*)ety);
                         return literal_pointer_val(((jl_datatype_t*)ety)->instance);
                     }
-                    return typed_load(emit_arrayptr(ary), idx, ety, ctx);
+                    return typed_load(emit_arrayptr(ary), idx, ety, ctx, tbaa_arraybuf);
                 }
             }
         }
@@ -1361,7 +1779,8 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
                 if (jl_is_long(ndp) || nargs==3) {
                     Value *ary = emit_expr(args[1], ctx);
                     size_t nd = jl_is_long(ndp) ? jl_unbox_long(ndp) : 1;
-                    Value *idx = emit_array_nd_index(ary, nd, &args[3], nargs-2, ctx);
+                    bool checked = !(nargs==3 && index_known_inbounds(args[1], args[3], ctx));
+                    Value *idx = emit_array_nd_index(ary, nd, &args[3], nargs-2, checked, ctx);
                     if (jl_array_store_unboxed(ety) &&
                         ((jl_datatype_t*)ety)->size == 0) {
                         // no-op
@@ -1369,7 +1788,7 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
                     else {
                         typed_store(emit_arrayptr(ary), idx,
                                     ety==(jl_value_t*)jl_any_type ? emit_expr(args[2],ctx) : emit_unboxed(args[2],ctx),
-                                    ety, ctx);
+                                    ety, ctx, tbaa_arraybuf);
                     }
                     JL_GC_POP();
                     return ary;
@@ -1695,6 +2114,27 @@ static void emit_assignment(jl_value_t *l, jl_value_t *r, jl_codectx_t *ctx)
     }
 }
 
+// thread-local runtime state has no address fixed at JIT time; with threads
+// enabled the code asks the runtime where the running thread's copy is
+
+static Value *emit_pgcstack_addr()
+{
+#ifdef JULIA_THREADS
+    return builder.CreateCall(jlpgcstack_addr_func);
+#else
+    return jlpgcstack_var;
+#endif
+}
+
+static Value *emit_exc_addr()
+{
+#ifdef JULIA_THREADS
+    return builder.CreateCall(jlexc_addr_func);
+#else
+    return jlexc_var;
+#endif
+}
+
 // --- convert expression to code ---
 
 static Value *emit_expr(jl_value_t *expr, jl_codectx_t *ctx, bool isboxed,
@@ -1937,7 +2377,7 @@ static Value *emit_expr(jl_value_t *expr, jl_codectx_t *ctx, bool isboxed,
         return emit_jlcall(jlnew_func, typ, &args[1], nargs-1, ctx);
     }
     else if (head == exc_sym) {
-        return builder.CreateLoad(jlexc_var, true);
+        return builder.CreateLoad(emit_exc_addr(), true);
     }
     else if (head == leave_sym) {
         assert(jl_is_long(args[0]));
@@ -1967,7 +2407,7 @@ static Value *emit_expr(jl_value_t *expr, jl_codectx_t *ctx, bool isboxed,
         builder.SetInsertPoint(cond_resetstkoflw_blk);
         builder.CreateCondBr(builder.CreateICmpEQ(
                     literal_pointer_val(jl_stackovf_exception),
-                    builder.CreateLoad(jlexc_var, true)),
+                    builder.CreateLoad(emit_exc_addr(), true)),
                 resetstkoflw_blk, handlr);
         builder.SetInsertPoint(resetstkoflw_blk);
         builder.CreateCall(resetstkoflw_func);
@@ -1977,6 +2417,22 @@ static Value *emit_expr(jl_value_t *expr, jl_codectx_t *ctx, bool isboxed,
 #endif
         builder.SetInsertPoint(tryblk);
     }
+    else if (head == fastmath_sym) {
+        // (fastmath true) and (fastmath false) bracket a @fastmath block;
+        // intrinsics emitted in between get relaxed floating-point semantics
+        if (args[0] == jl_true)
+            ctx->fastmath++;
+        else if (ctx->fastmath > 0)
+            ctx->fastmath--;
+    }
+    else if (head == inbounds_sym) {
+        // (inbounds true) and (inbounds false) bracket an @inbounds block,
+        // in which indexing is not bounds checked
+        if (args[0] == jl_true)
+            ctx->inbounds++;
+        else if (ctx->inbounds > 0)
+            ctx->inbounds--;
+    }
     else {
         if (!strcmp(head->name, "$"))
             jl_error("syntax: prefix $ in non-quoted expression");
@@ -2088,6 +2544,7 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
     std::map<std::string, bool> isAssigned;
     std::map<std::string, bool> isCaptured;
     std::map<std::string, bool> escapes;
+    std::vector<jl_inbounds_loop_t> inboundsLoops;
     std::set<jl_sym_t*> volvars;
     std::map<std::string, jl_value_t*> declTypes;
     std::map<int, BasicBlock*> labels;
@@ -2111,6 +2568,10 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
     ctx.funcName = lam->name->name;
     ctx.vaName = NULL;
     ctx.vaStack = false;
+    ctx.fastmath = 0;
+    ctx.inbounds = 0;
+    ctx.inboundsLoops = &inboundsLoops;
+    ctx.curStmt = 0;
 
     // step 2. process var-info lists to see what vars are captured, need boxing
     jl_array_t *largs = jl_lam_args(ast);
@@ -2330,6 +2791,7 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
     if (n_roots > 0) {
 #ifdef JL_GC_MARKSWEEP
         // allocate gc frame
+        ctx.pgcstack = emit_pgcstack_addr();
         ctx.argTemp = builder.CreateAlloca(jl_pvalue_llvmt,
                                            ConstantInt::get(T_int32,n_roots+2));
         gcframe = (Instruction*)ctx.argTemp;
@@ -2338,9 +2800,9 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
         storeFrameSize =
             builder.CreateStore(ConstantInt::get(T_size, n_roots<<1),
                                 builder.CreateBitCast(builder.CreateConstGEP1_32(gcframe, 0), T_psize));
-        builder.CreateStore(builder.CreateLoad(jlpgcstack_var, false),
+        builder.CreateStore(builder.CreateLoad(ctx.pgcstack, false),
                             builder.CreateBitCast(builder.CreateConstGEP1_32(gcframe, 1), PointerType::get(jl_ppvalue_llvmt,0)));
-        Instruction *linst=builder.CreateStore(gcframe, jlpgcstack_var, false);
+        Instruction *linst=builder.CreateStore(gcframe, ctx.pgcstack, false);
         last_gcframe_inst = BasicBlock::iterator(linst);
         // initialize local variable stack roots to null
         for(i=0; i < (size_t)ctx.argSpaceOffs; i++) {
@@ -2534,8 +2996,10 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
     // step 15. compile body statements
     std::vector<Instruction*> gc_frame_pops;
     bool prevlabel = false;
+    find_inbounds_loops(stmts, &ctx);
     for(i=0; i < stmtslen; i++) {
         jl_value_t *stmt = jl_cellref(stmts,i);
+        ctx.curStmt = i;
         if (jl_is_linenode(stmt)) {
             int lno = jl_linenode_line(stmt);
             builder.SetCurrentDebugLocation(DebugLoc::get(lno, 1, (MDNode*)SP, NULL));
@@ -2573,7 +3037,7 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
                 Instruction *gcpop = (Instruction*)builder.CreateConstGEP1_32(gcframe, 1);
                 gc_frame_pops.push_back(gcpop);
                 builder.CreateStore(builder.CreateBitCast(builder.CreateLoad(gcpop, false), jl_ppvalue_llvmt),
-                                    jlpgcstack_var);
+                                    ctx.pgcstack);
             }
 #endif
             if (retty == T_void)
@@ -2698,6 +3162,79 @@ extern "C" jl_value_t *jl_new_box(jl_value_t *v)
     return box;
 }
 
+// the pass pipeline for each optimization level. level 2 is the
+// historical default; 0 does no optimization at all and is mostly useful
+// for measuring compile time, and 3 adds the loop idiom recognizer,
+// memcpy optimization and the vectorizers.
+static void add_optimization_passes(FunctionPassManager *PM, int opt_level)
+{
+    if (opt_level <= 0)
+        return;
+
+    // list of passes from vmkit
+    PM->add(createCFGSimplificationPass()); // Clean up disgusting code
+    PM->add(createPromoteMemoryToRegisterPass());// Kill useless allocas
+    PM->add(createInstructionCombiningPass()); // Cleanup for scalarrepl.
+
+    if (opt_level == 1) {
+        PM->add(createEarlyCSEPass());
+        PM->add(createCFGSimplificationPass());
+        return;
+    }
+
+    PM->add(createScalarReplAggregatesPass()); // Break up aggregate allocas
+    PM->add(createInstructionCombiningPass()); // Cleanup for scalarrepl.
+    PM->add(createJumpThreadingPass());        // Thread jumps.
+    PM->add(createCFGSimplificationPass());    // Merge & remove BBs
+    //PM->add(createInstructionCombiningPass()); // Combine silly seq's
+    
+    //PM->add(createCFGSimplificationPass());    // Merge & remove BBs
+    PM->add(createReassociatePass());          // Reassociate expressions
+    PM->add(createEarlyCSEPass()); //// ****
+
+    PM->add(createLoopRotatePass());           // Rotate loops.
+    PM->add(createLICMPass());                 // Hoist loop invariants
+    PM->add(createLoopUnswitchPass());         // Unswitch loops.
+    PM->add(createInstructionCombiningPass()); 
+    PM->add(createIndVarSimplifyPass());       // Canonicalize indvars
+    if (opt_level >= 3) {
+        PM->add(createLoopIdiomPass());        // Recognize memset/memcpy loops
+        PM->add(createLoopDeletionPass());     // Delete dead loops
+#if defined(LLVM_VERSION_MAJOR) && LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR >= 2
+        PM->add(createLoopVectorizePass());    // Vectorize inner loops
+#endif
+    }
+    PM->add(createLoopUnrollPass());           // Unroll small loops
+    // LoopStrengthReduce is run by the JIT's code generator itself
+    
+    PM->add(createInstructionCombiningPass()); // Clean up after the unroller
+    PM->add(createGVNPass());                  // Remove redundancies
+    if (opt_level >= 3)
+        PM->add(createMemCpyOptPass());        // Remove memcpy / form memset
+    PM->add(createSCCPPass());                 // Constant prop with SCCP
+    
+    // Run instcombine after redundancy elimination to exploit opportunities
+    // opened up by them.
+    //PM->add(createSinkingPass()); ////////////// ****
+    //PM->add(createInstructionSimplifierPass());///////// ****
+    PM->add(createInstructionCombiningPass());
+    PM->add(createJumpThreadingPass());         // Thread jumps
+    PM->add(createDeadStoreEliminationPass());  // Delete dead stores
+
+    if (opt_level >= 3) {
+        // straight-line (SLP) vectorization of the cleaned-up code
+#if defined(LLVM_VERSION_MAJOR) && LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR >= 3
+        PM->add(createSLPVectorizerPass());
+#elif defined(LLVM_VERSION_MAJOR) && LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR >= 1
+        PM->add(createBBVectorizePass());
+#endif
+        PM->add(createInstructionCombiningPass());
+    }
+
+    PM->add(createAggressiveDCEPass());         // Delete dead instructions
+    PM->add(createCFGSimplificationPass());     // Merge & remove BBs
+}
+
 static void init_julia_llvm_env(Module *m)
 {
     T_int1  = Type::getInt1Ty(getGlobalContext());
@@ -2733,6 +3270,16 @@ static void init_julia_llvm_env(Module *m)
     jl_pvalue_llvmt = PointerType::get(jl_value_llvmt, 0);
     jl_ppvalue_llvmt = PointerType::get(jl_pvalue_llvmt, 0);
     V_null = Constant::getNullValue(jl_pvalue_llvmt);
+
+    tbaa_root = MDNode::get(jl_LLVMContext,
+                            ArrayRef<Value*>(MDString::get(jl_LLVMContext, "jtbaa")));
+    tbaa_value = tbaa_make_child("jtbaa_value", tbaa_root);
+    tbaa_user = tbaa_make_child("jtbaa_user", tbaa_root);
+    tbaa_array = tbaa_make_child("jtbaa_array", tbaa_root);
+    tbaa_arrayptr = tbaa_make_child("jtbaa_arrayptr", tbaa_array);
+    tbaa_arraylen = tbaa_make_child("jtbaa_arraylen", tbaa_array);
+    tbaa_arraysize = tbaa_make_child("jtbaa_arraysize", tbaa_array);
+    tbaa_arraybuf = tbaa_make_child("jtbaa_arraybuf", tbaa_root);
     std::vector<Type*> ftargs(0);
     ftargs.push_back(jl_pvalue_llvmt);
     ftargs.push_back(jl_ppvalue_llvmt);
@@ -2748,6 +3295,27 @@ static void init_julia_llvm_env(Module *m)
                            NULL, "jl_pgcstack");
     jl_ExecutionEngine->addGlobalMapping(jlpgcstack_var, (void*)&jl_pgcstack);
 #endif
+#ifdef JULIA_THREADS
+    // the address of a thread-local is fixed for the life of a thread, so
+    // calls to these can be treated as constants
+    jlpgcstack_addr_func =
+        Function::Create(FunctionType::get(PointerType::get(jl_ppvalue_llvmt,0),
+                                           false),
+                         Function::ExternalLinkage,
+                         "jl_pgcstack_addr", jl_Module);
+    jlpgcstack_addr_func->setDoesNotAccessMemory();
+    jlpgcstack_addr_func->setDoesNotThrow();
+    jl_ExecutionEngine->addGlobalMapping(jlpgcstack_addr_func,
+                                         (void*)&jl_pgcstack_addr);
+    jlexc_addr_func =
+        Function::Create(FunctionType::get(jl_ppvalue_llvmt, false),
+                         Function::ExternalLinkage,
+                         "jl_exception_in_transit_addr", jl_Module);
+    jlexc_addr_func->setDoesNotAccessMemory();
+    jlexc_addr_func->setDoesNotThrow();
+    jl_ExecutionEngine->addGlobalMapping(jlexc_addr_func,
+                                         (void*)&jl_exception_in_transit_addr);
+#endif
 
     global_to_llvm("__stack_chk_guard", (void*)&__stack_chk_guard);
     Function *jl__stack_chk_fail =
@@ -2961,62 +3529,64 @@ static void init_julia_llvm_env(Module *m)
 #ifndef LLVM32
     FPM->add(new TargetData(*jl_ExecutionEngine->getTargetData()));
 #endif
-    // list of passes from vmkit
-    FPM->add(createCFGSimplificationPass()); // Clean up disgusting code
-    FPM->add(createPromoteMemoryToRegisterPass());// Kill useless allocas
-    
-    FPM->add(createInstructionCombiningPass()); // Cleanup for scalarrepl.
-    FPM->add(createScalarReplAggregatesPass()); // Break up aggregate allocas
-    FPM->add(createInstructionCombiningPass()); // Cleanup for scalarrepl.
-    FPM->add(createJumpThreadingPass());        // Thread jumps.
-    FPM->add(createCFGSimplificationPass());    // Merge & remove BBs
-    //FPM->add(createInstructionCombiningPass()); // Combine silly seq's
-    
-    //FPM->add(createCFGSimplificationPass());    // Merge & remove BBs
-    FPM->add(createReassociatePass());          // Reassociate expressions
+    add_optimization_passes(FPM, jl_compileropts.opt_level);
+    FPM->doInitialization();
+}
 
+// pick the cpu and features the JIT targets. "native" (the default) means
+// the host cpu with exactly the extensions cpuid reports, so that e.g. AVX
+// is not used when the OS does not save the ymm registers. any other name
+// is passed to LLVM as is, for reproducible code generation.
+static std::string jl_target_cpu(std::vector<std::string> &attrs)
+{
+    const char *target = jl_compileropts.cpu_target;
+    if (target == NULL)
+        target = getenv("JULIA_CPU_TARGET");
+    if (target != NULL && strcmp(target, "native") != 0)
+        return std::string(target);
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    uint32_t features = jl_cpu_features();
+    attrs.push_back(features & JL_CPU_SSE3   ? "+sse3"   : "-sse3");
+    attrs.push_back(features & JL_CPU_SSSE3  ? "+ssse3"  : "-ssse3");
+    attrs.push_back(features & JL_CPU_SSE41  ? "+sse41"  : "-sse41");
+    attrs.push_back(features & JL_CPU_SSE42  ? "+sse42"  : "-sse42");
+    attrs.push_back(features & JL_CPU_POPCNT ? "+popcnt" : "-popcnt");
+    attrs.push_back(features & JL_CPU_AVX    ? "+avx"    : "-avx");
 #if defined(LLVM_VERSION_MAJOR) && LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR >= 1
-    //FPM->add(createBBVectorizePass());
+    attrs.push_back(features & JL_CPU_AVX2   ? "+avx2"   : "-avx2");
+#if LLVM_VERSION_MINOR >= 3
+    attrs.push_back(features & JL_CPU_FMA    ? "+fma"    : "-fma");
+#else
+    attrs.push_back(features & JL_CPU_FMA    ? "+fma3"   : "-fma3");
 #endif
-    FPM->add(createEarlyCSEPass()); //// ****
-
-    //FPM->add(createLoopIdiomPass()); //// ****
-    FPM->add(createLoopRotatePass());           // Rotate loops.
-    FPM->add(createLICMPass());                 // Hoist loop invariants
-    FPM->add(createLoopUnswitchPass());         // Unswitch loops.
-    FPM->add(createInstructionCombiningPass()); 
-    FPM->add(createIndVarSimplifyPass());       // Canonicalize indvars
-    //FPM->add(createLoopDeletionPass());         // Delete dead loops
-    FPM->add(createLoopUnrollPass());           // Unroll small loops
-    //FPM->add(createLoopStrengthReducePass());   // (jwb added)
-    
-    FPM->add(createInstructionCombiningPass()); // Clean up after the unroller
-    FPM->add(createGVNPass());                  // Remove redundancies
-    //FPM->add(createMemCpyOptPass());            // Remove memcpy / form memset  
-    FPM->add(createSCCPPass());                 // Constant prop with SCCP
-    
-    // Run instcombine after redundancy elimination to exploit opportunities
-    // opened up by them.
-    //FPM->add(createSinkingPass()); ////////////// ****
-    //FPM->add(createInstructionSimplifierPass());///////// ****
-    FPM->add(createInstructionCombiningPass());
-    FPM->add(createJumpThreadingPass());         // Thread jumps
-    FPM->add(createDeadStoreEliminationPass());  // Delete dead stores
-
-    FPM->add(createAggressiveDCEPass());         // Delete dead instructions
-    FPM->add(createCFGSimplificationPass());     // Merge & remove BBs
-
-    FPM->doInitialization();
+#endif
+#endif
+    return sys::getHostCPUName();
 }
 
 extern "C" void jl_init_codegen(void)
 {
+    if (jl_compileropts.opt_level == JL_OPT_LEVEL_UNSET) {
+        const char *lvl = getenv("JULIA_OPT_LEVEL");
+        if (lvl != NULL && lvl[0] >= '0' && lvl[0] <= '0'+JL_OPT_LEVEL_MAX &&
+            lvl[1] == '\0')
+            jl_compileropts.opt_level = lvl[0] - '0';
+        else
+            jl_compileropts.opt_level = JL_OPT_LEVEL_DEFAULT;
+    }
     
     InitializeNativeTarget();
     jl_Module = new Module("julia", jl_LLVMContext);
 
+    std::vector<std::string> attrs;
+    std::string cpu = jl_target_cpu(attrs);
+
 #if !defined(LLVM_VERSION_MAJOR) || (LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR == 0)
-    jl_ExecutionEngine = EngineBuilder(jl_Module).setEngineKind(EngineKind::JIT).create();
+    jl_ExecutionEngine = EngineBuilder(jl_Module)
+        .setEngineKind(EngineKind::JIT)
+        .setMCPU(cpu)
+        .setMAttrs(attrs)
+        .create();
 #ifdef DEBUG
     llvm::JITEmitDebugInfo = true;
 #endif
@@ -3043,6 +3613,8 @@ extern "C" void jl_init_codegen(void)
     jl_ExecutionEngine = EngineBuilder(jl_Module)
         .setEngineKind(EngineKind::JIT)
         .setTargetOptions(options)
+        .setMCPU(cpu)
+        .setMAttrs(attrs)
         .create();
 #endif // LLVM VERSION
     
@@ -3081,9 +3653,6 @@ extern "C" void jl_init_codegen(void)
     jl_ExecutionEngine->addGlobalMapping(value_to_pointer_func,
                                          (void*)&jl_value_to_pointer);
 
-    temp_arg_area = (char*)malloc(arg_area_sz);
-    arg_area_loc = 0;
-
     std::vector<Type*> noargs(0);
     save_arg_area_loc_func =
         Function::Create(FunctionType::get(T_uint64, noargs, false),
@@ -29,6 +29,14 @@ public:
 
 JuliaJITEventListener *jl_jit_events;
 
+// size of the machine code the JIT emitted starting at code, or 0
+static size_t jit_code_size(void *code)
+{
+    std::map<size_t, FuncInfo> &info = jl_jit_events->getMap();
+    std::map<size_t, FuncInfo>::iterator it = info.find((size_t)code);
+    return it == info.end() ? 0 : (*it).second.lengthAdr;
+}
+
 extern "C" void getFunctionInfo(const char **name, int *line, const char **filename,size_t pointer);
 
 void getFunctionInfo(const char **name, int *line, const char **filename, size_t pointer)
@@ -6,6 +6,11 @@
 #include <assert.h>
 #ifdef __WIN32__
 #include <malloc.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 #include "julia.h"
 #include "builtin_proto.h"
@@ -15,6 +20,9 @@
 static htable_t ser_tag;
 static htable_t deser_tag;
 static htable_t backref_table;
+// the table in use. sections of the system image are restored by
+// several threads at once, each with its own.
+static JL_THREAD htable_t *backrefs = &backref_table;
 static htable_t fptr_to_id;
 static htable_t id_to_fptr;
 
@@ -25,6 +33,13 @@ static const ptrint_t LiteralVal_tag = 26;
 static const ptrint_t SmallInt64_tag = 27;
 static const ptrint_t IdTable_tag    = 28;
 static const ptrint_t Int32_tag      = 29;
+static const ptrint_t SymRef_tag     = 30;
+static const ptrint_t LineNode_tag   = 31;
+static const ptrint_t LabelNode_tag  = 32;
+static const ptrint_t GotoNode_tag   = 33;
+static const ptrint_t GlobalRef_tag  = 34;
+static const ptrint_t TypeApply_tag  = 35;
+static const ptrint_t SharedRef_tag  = 36;
 static const ptrint_t Null_tag         = 253;
 static const ptrint_t ShortBackRef_tag = 254;
 static const ptrint_t BackRef_tag      = 255;
@@ -34,11 +49,84 @@ static ptrint_t VALUE_TAGS;
 // pointers to non-AST-ish objects in a compressed tree
 static jl_array_t *tree_literal_values=NULL;
 
+/*
+  compressed trees use a more compact encoding than the system image:
+  integers, literal indexes and node labels are varints, line, label and
+  goto nodes have tags of their own, and a symbol is spelled out only the
+  first time it occurs in a tree. later occurrences refer back to it by
+  its number among the symbols of that tree (SymRef).
+*/
+static htable_t *tree_symbols=NULL;        // symbol => number+1, writing
+static size_t tree_nsymbols=0;
+static arraylist_t *tree_symbol_list=NULL; // number => symbol, reading
+
 static jl_value_t *jl_idtable_type=NULL;
 
 // queue of types to cache
 static jl_array_t *datatype_list=NULL;
 
+/*
+  a system image starts with JL_IMAGE_MAGIC and the format version. the
+  data of every bits array in it is aligned to JL_IMAGE_ALIGN bytes in the
+  file (and 1-byte arrays are followed by a NUL, as in jl_new_array_), so
+  the image can be mapped and that data used in place: most of it is
+  compressed ASTs, and the pages holding them are shared by all processes
+  started from the same image. the rest of the objects are still rebuilt
+  on the heap as the image is read.
+
+  the image is split into JL_IMAGE_SECTIONS sections, each with its own
+  back references, so that all but the first can be read in parallel.
+  the first holds the module tree, every type, and every object reached
+  from more than one section; values of the globals are left out of it
+  where they belong to a later section. each later section holds the
+  remaining values of a run of globals, as (module, name, value) triples,
+  and refers to objects of the first section by position (SharedRef).
+  the globals are bound once all sections are read.
+
+  built with USE_COMPRESSED_SYSIMG=1, each section is compressed (see
+  support/lz.c) and decompressed into memory of its own as it is read. the
+  file is smaller, but its pages are no longer shared between processes.
+*/
+static const char JL_IMAGE_MAGIC[] = "\211jli\r\n\032\n";
+#define JL_IMAGE_VERSION 5
+#define JL_IMAGE_ALIGN 16
+#define JL_IMAGE_SECTIONS 32
+
+// what serializing a value does while a sectioned image is written
+#define SECTIONS_OFF    0
+#define SECTIONS_MARK   1  // record which sections reach each object
+#define SECTIONS_SHARED 2  // add everything reached to the first section
+#define SECTIONS_WRITE  3
+static int sections_mode = SECTIONS_OFF;
+static int cur_section = 0;
+// object => 2 + the section it is written in
+static htable_t obj_section;
+// objects of the first section and their positions in it
+static htable_t shared_table;
+
+// the mapped image being restored, if any
+static char *image_base = NULL;
+// identifies the running system image; see jl_save_module
+static int64_t image_stamp = 0;
+
+/*
+  a module cache holds one module (and its submodules), so that a session
+  started from the same system image can restore it instead of loading
+  its source. values that belong to other modules are not copied: they
+  are written by name, as the constant global they are bound to
+  (GlobalRef), and instances of other modules' types as the type applied
+  to its parameters (TypeApply). methods the module added to functions of
+  other modules are listed after it and added back when it is restored.
+*/
+static const char JL_MODULE_MAGIC[] = "\211jlm\r\n\032\n";
+
+// the module being saved, the constant globals of all other modules
+// (value => binding), and the methods it added to their functions
+static jl_module_t *saving_module = NULL;
+static htable_t external_names;
+static jl_array_t *external_methods = NULL;
+static int restoring_module = 0;
+
 #define write_uint8(s, n) ios_putc((n), (s))
 #define read_uint8(s) ((uint8_t)ios_getc(s))
 #define write_int8(s, n) write_uint8(s, n)
@@ -73,6 +161,40 @@ static uint16_t read_uint16(ios_t *s)
     return b0 | (b1<<8);
 }
 
+static void write_varint(ios_t *s, uint64_t n)
+{
+    while (n >= 0x80) {
+        write_uint8(s, (n & 0x7f) | 0x80);
+        n >>= 7;
+    }
+    write_uint8(s, n);
+}
+
+static uint64_t read_varint(ios_t *s)
+{
+    uint64_t n = 0;
+    int shift = 0;
+    uint8_t b;
+    do {
+        b = read_uint8(s);
+        n |= (uint64_t)(b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    return n;
+}
+
+// zigzag, so that small negative numbers are short too
+static void write_svarint(ios_t *s, int64_t n)
+{
+    write_varint(s, ((uint64_t)n << 1) ^ (uint64_t)(n >> 63));
+}
+
+static int64_t read_svarint(ios_t *s)
+{
+    uint64_t n = read_varint(s);
+    return (int64_t)(n >> 1) ^ -(int64_t)(n & 1);
+}
+
 static void writetag(ios_t *s, void *v)
 {
     write_uint8(s, (uint8_t)(ptrint_t)ptrhash_get(&ser_tag, v));
@@ -115,18 +237,19 @@ static void jl_serialize_datatype(ios_t *s, jl_datatype_t *dt)
     size_t nf = jl_tuple_len(dt->names);
     write_uint16(s, nf);
     write_int32(s, dt->size);
+    write_uint8(s, dt->abstract | (dt->mutabl<<1) | (dt->pointerfree<<2));
+    if (!dt->abstract)
+        write_int32(s, dt->uid);
+    // name and parameters come before the field types, which can apply
+    // other types to this one (see TypeApply)
+    jl_serialize_value(s, dt->name);
+    jl_serialize_value(s, dt->parameters);
     if (nf > 0) {
         write_int32(s, dt->alignment);
         ios_write(s, (char*)&dt->fields[0], nf*sizeof(jl_fielddesc_t));
         jl_serialize_value(s, dt->names);
         jl_serialize_value(s, dt->types);
     }
-    write_uint8(s, dt->abstract | (dt->mutabl<<1) | (dt->pointerfree<<2));
-    if (!dt->abstract)
-        write_int32(s, dt->uid);
-
-    jl_serialize_value(s, dt->name);
-    jl_serialize_value(s, dt->parameters);
     jl_serialize_value(s, dt->super);
     jl_serialize_value(s, dt->ctor_factory);
     jl_serialize_value(s, dt->env);
@@ -134,22 +257,40 @@ static void jl_serialize_datatype(ios_t *s, jl_datatype_t *dt)
     jl_serialize_fptr(s, dt->fptr);
 }
 
-static void jl_serialize_module(ios_t *s, jl_module_t *m)
+// the section of the image v is written in, or -1 if not marked
+static int object_section(jl_value_t *v)
+{
+    void *p = ptrhash_get(&obj_section, v);
+    return p == HT_NOTFOUND ? -1 : (int)((ptrint_t)p-2);
+}
+
+// whether binding b of module m is saved
+static int module_binding_saved(jl_module_t *m, jl_binding_t *b)
 {
     // set on every startup; don't save
-    jl_sym_t *jhsym = jl_symbol("JULIA_HOME");
+    if (m == jl_core_module && b->name == jl_symbol("JULIA_HOME"))
+        return 0;
+    return !(b->owner != m && m == jl_main_module);
+}
+
+static void jl_serialize_module(ios_t *s, jl_module_t *m)
+{
     writetag(s, jl_module_type);
     jl_serialize_value(s, m->name);
     jl_serialize_value(s, m->parent);
     size_t i;
     void **table = m->bindings.table;
     for(i=1; i < m->bindings.size; i+=2) {
-        if (table[i] != HT_NOTFOUND &&
-            !(table[i-1] == jhsym && m == jl_core_module)) {
+        if (table[i] != HT_NOTFOUND) {
             jl_binding_t *b = (jl_binding_t*)table[i];
-            if (!(b->owner != m && m == jl_main_module)) {
+            if (module_binding_saved(m, b)) {
+                jl_value_t *v = b->value;
+                // bound after the later sections of the image are read
+                if (sections_mode == SECTIONS_WRITE && v != NULL &&
+                    object_section(v) > 0)
+                    v = NULL;
                 jl_serialize_value(s, b->name);
-                jl_serialize_value(s, b->value);
+                jl_serialize_value(s, v);
                 jl_serialize_value(s, b->type);
                 jl_serialize_value(s, b->owner);
                 write_int8(s, (b->constp<<2) | (b->exportp<<1) | (b->imported));
@@ -169,6 +310,75 @@ static void jl_serialize_module(ios_t *s, jl_module_t *m)
     }
 }
 
+static int module_in(jl_module_t *m, jl_module_t *parent)
+{
+    while (m != parent) {
+        if (m == NULL || m->parent == m)
+            return 0;
+        m = m->parent;
+    }
+    return 1;
+}
+
+// Main, then the names of the modules down to m
+static void write_module_path(ios_t *s, jl_module_t *m)
+{
+    if (m->parent == m)
+        return;
+    write_module_path(s, m->parent);
+    jl_serialize_value(s, m->name);
+}
+
+// write v by name if it belongs to a module other than the one being saved
+static int jl_serialize_external(ios_t *s, jl_value_t *v)
+{
+    jl_module_t *m;
+    jl_sym_t *name = NULL;
+    if (jl_is_module(v)) {
+        if (module_in((jl_module_t*)v, saving_module))
+            return 0;
+        m = (jl_module_t*)v;
+    }
+    else {
+        jl_binding_t *b = (jl_binding_t*)ptrhash_get(&external_names, v);
+        if (b == HT_NOTFOUND) {
+            if (!jl_is_datatype(v) ||
+                module_in(((jl_datatype_t*)v)->name->module, saving_module))
+                return 0;
+            jl_datatype_t *dt = (jl_datatype_t*)v;
+            if (dt->name->primary == v)
+                jl_errorf("cannot save module %s: type %s is not bound to a constant",
+                          saving_module->name->name, dt->name->name->name);
+            writetag(s, (jl_value_t*)TypeApply_tag);
+            jl_serialize_value(s, dt->name->primary);
+            jl_serialize_value(s, dt->parameters);
+            return 1;
+        }
+        m = b->owner;
+        name = b->name;
+    }
+    writetag(s, (jl_value_t*)GlobalRef_tag);
+    write_module_path(s, m);
+    jl_serialize_value(s, NULL);
+    jl_serialize_value(s, name);
+    return 1;
+}
+
+// while a sectioned image is written: record that v is reached from
+// cur_section. types, modules, and objects reached from more than one
+// section go in the first. returns whether to skip the contents of v.
+static int mark_section(jl_value_t *v)
+{
+    void **bp = ptrhash_bp(&obj_section, v);
+    ptrint_t sec = cur_section;
+    if (sections_mode == SECTIONS_SHARED || jl_is_datatype(v) || jl_is_module(v) ||
+        (*bp != HT_NOTFOUND && (ptrint_t)*bp-2 != sec))
+        sec = 0;
+    *bp = (void*)(sec+2);
+    // the module tree is written whole in the first section
+    return jl_is_module(v);
+}
+
 static int is_ast_node(jl_value_t *v)
 {
     if (jl_is_lambda_info(v)) {
@@ -212,12 +422,44 @@ static void jl_serialize_value_(ios_t *s, jl_value_t *v)
         // compressing tree
         if (!is_ast_node(v)) {
             writetag(s, (jl_value_t*)LiteralVal_tag);
-            write_uint16(s, literal_val_id(v));
+            write_varint(s, literal_val_id(v));
+            return;
+        }
+        if (jl_is_symbol(v)) {
+            bp = ptrhash_bp(tree_symbols, v);
+            if (*bp != HT_NOTFOUND) {
+                writetag(s, (jl_value_t*)SymRef_tag);
+                write_varint(s, (uptrint_t)*bp - 1);
+                return;
+            }
+            *bp = (void*)(uptrint_t)(++tree_nsymbols);
+        }
+        else if (jl_is_linenode(v)) {
+            writetag(s, (jl_value_t*)LineNode_tag);
+            write_varint(s, jl_linenode_line(v));
+            return;
+        }
+        else if (jl_is_labelnode(v)) {
+            writetag(s, (jl_value_t*)LabelNode_tag);
+            write_varint(s, jl_labelnode_label(v));
+            return;
+        }
+        else if (jl_is_gotonode(v)) {
+            writetag(s, (jl_value_t*)GotoNode_tag);
+            write_varint(s, jl_gotonode_label(v));
             return;
         }
     }
     else {
-        bp = ptrhash_bp(&backref_table, v);
+        if (sections_mode == SECTIONS_WRITE && cur_section > 0) {
+            void *spos = ptrhash_get(&shared_table, v);
+            if (spos != HT_NOTFOUND) {
+                writetag(s, (jl_value_t*)SharedRef_tag);
+                write_int32(s, (ptrint_t)spos);
+                return;
+            }
+        }
+        bp = ptrhash_bp(backrefs, v);
         if (*bp != HT_NOTFOUND) {
             if ((uptrint_t)*bp < 65536) {
                 write_uint8(s, ShortBackRef_tag);
@@ -229,7 +471,12 @@ static void jl_serialize_value_(ios_t *s, jl_value_t *v)
             }
             return;
         }
-        ptrhash_put(&backref_table, v, (void*)(ptrint_t)ios_pos(s));
+        ptrhash_put(backrefs, v, (void*)(ptrint_t)ios_pos(s));
+        if (saving_module && jl_serialize_external(s, v))
+            return;
+        if ((sections_mode == SECTIONS_MARK || sections_mode == SECTIONS_SHARED) &&
+            mark_section(v))
+            return;
     }
 
     size_t i;
@@ -267,7 +514,18 @@ static void jl_serialize_value_(ios_t *s, jl_value_t *v)
             jl_serialize_value(s, jl_box_long(jl_array_dim(ar,i)));
         if (!ar->ptrarray) {
             size_t tot = jl_array_len(ar) * ar->elsize;
-            ios_write(s, jl_array_data(ar), tot);
+            if (tree_literal_values == NULL) {
+                // system image; see JL_IMAGE_ALIGN
+                size_t pad = LLT_ALIGN(ios_pos(s), JL_IMAGE_ALIGN) - ios_pos(s);
+                for(i=0; i < pad; i++)
+                    write_uint8(s, 0);
+                ios_write(s, jl_array_data(ar), tot);
+                if (ar->elsize == 1)
+                    write_uint8(s, 0);
+            }
+            else {
+                ios_write(s, jl_array_data(ar), tot);
+            }
         }
         else {
             for(i=0; i < jl_array_len(ar); i++) {
@@ -348,12 +606,18 @@ static void jl_serialize_value_(ios_t *s, jl_value_t *v)
         if (t == jl_int64_type &&
             *(int64_t*)data >= S32_MIN && *(int64_t*)data <= S32_MAX) {
             writetag(s, (jl_value_t*)SmallInt64_tag);
-            write_int32(s, (int32_t)*(int64_t*)data);
+            if (tree_literal_values)
+                write_svarint(s, *(int64_t*)data);
+            else
+                write_int32(s, (int32_t)*(int64_t*)data);
             return;
         }
         if (t == jl_int32_type) {
             writetag(s, (jl_value_t*)Int32_tag);
-            write_int32(s, (int32_t)*(int32_t*)data);
+            if (tree_literal_values)
+                write_svarint(s, *(int32_t*)data);
+            else
+                write_int32(s, (int32_t)*(int32_t*)data);
             return;
         }
         if ((jl_value_t*)t == jl_idtable_type)
@@ -426,18 +690,8 @@ static jl_value_t *jl_deserialize_datatype(ios_t *s, int pos)
     dt->size = size;
 
     assert(tree_literal_values==NULL);
-    ptrhash_put(&backref_table, (void*)(ptrint_t)pos, dt);
+    ptrhash_put(backrefs, (void*)(ptrint_t)pos, dt);
 
-    if (nf > 0) {
-        dt->alignment = read_int32(s);
-        ios_read(s, (char*)&dt->fields[0], nf*sizeof(jl_fielddesc_t));
-        dt->names = (jl_tuple_t*)jl_deserialize_value(s);
-        dt->types = (jl_tuple_t*)jl_deserialize_value(s);
-    }
-    else {
-        dt->alignment = 0;
-        dt->names = dt->types = jl_null;
-    }
     uint8_t flags = read_uint8(s);
     dt->abstract = flags&1;
     dt->mutabl = (flags>>1)&1;
@@ -446,8 +700,21 @@ static jl_value_t *jl_deserialize_datatype(ios_t *s, int pos)
         dt->uid = read_int32(s);
     else
         dt->uid = 0;
+    if (restoring_module && tag == 0 && !dt->abstract)
+        dt->uid = jl_assign_type_uid();
+    dt->names = dt->types = jl_null;
+    dt->super = jl_any_type;
     dt->name = (jl_typename_t*)jl_deserialize_value(s);
     dt->parameters = (jl_tuple_t*)jl_deserialize_value(s);
+    if (nf > 0) {
+        dt->alignment = read_int32(s);
+        ios_read(s, (char*)&dt->fields[0], nf*sizeof(jl_fielddesc_t));
+        dt->names = (jl_tuple_t*)jl_deserialize_value(s);
+        dt->types = (jl_tuple_t*)jl_deserialize_value(s);
+    }
+    else {
+        dt->alignment = 0;
+    }
     dt->super = (jl_datatype_t*)jl_deserialize_value(s);
     dt->ctor_factory = jl_deserialize_value(s);
     dt->env = jl_deserialize_value(s);
@@ -483,7 +750,7 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
     if (tag == BackRef_tag || tag == ShortBackRef_tag) {
         assert(tree_literal_values == NULL);
         ptrint_t offs = (tag == BackRef_tag) ? read_int32(s) : read_uint16(s);
-        void **bp = ptrhash_bp(&backref_table, (void*)(ptrint_t)offs);
+        void **bp = ptrhash_bp(backrefs, (void*)(ptrint_t)offs);
         assert(*bp != HT_NOTFOUND);
         return (jl_value_t*)*bp;
     }
@@ -505,7 +772,7 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
             len = read_int32(s);
         jl_tuple_t *tu = jl_alloc_tuple_uninit(len);
         if (usetable)
-            ptrhash_put(&backref_table, (void*)(ptrint_t)pos, (jl_value_t*)tu);
+            ptrhash_put(backrefs, (void*)(ptrint_t)pos, (jl_value_t*)tu);
         for(i=0; i < len; i++)
             jl_tupleset(tu, i, jl_deserialize_value(s));
         return (jl_value_t*)tu;
@@ -522,7 +789,9 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
         name[len] = '\0';
         jl_value_t *s = (jl_value_t*)jl_symbol(name);
         if (usetable)
-            ptrhash_put(&backref_table, (void*)(ptrint_t)pos, s);
+            ptrhash_put(backrefs, (void*)(ptrint_t)pos, s);
+        else
+            arraylist_push(tree_symbol_list, s);
         return s;
     }
     else if (vtag == (jl_value_t*)jl_array_type) {
@@ -531,12 +800,24 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
         size_t *dims = alloca(ndims*sizeof(size_t));
         for(i=0; i < ndims; i++)
             dims[i] = jl_unbox_long(jl_deserialize_value(s));
+        int isunboxed = jl_array_store_unboxed(jl_tparam0(aty));
+        if (usetable && isunboxed)
+            ios_skip(s, LLT_ALIGN(ios_pos(s), JL_IMAGE_ALIGN) - ios_pos(s));
+        if (usetable && isunboxed && image_base != NULL && ndims == 1) {
+            // point into the mapped image
+            jl_array_t *a = jl_ptr_to_array_1d(aty, s->buf + ios_pos(s), dims[0], 0);
+            ptrhash_put(backrefs, (void*)(ptrint_t)pos, (jl_value_t*)a);
+            ios_skip(s, jl_array_len(a) * a->elsize + (a->elsize == 1));
+            return (jl_value_t*)a;
+        }
         jl_array_t *a = jl_new_array_((jl_value_t*)aty, ndims, dims);
         if (usetable)
-            ptrhash_put(&backref_table, (void*)(ptrint_t)pos, (jl_value_t*)a);
+            ptrhash_put(backrefs, (void*)(ptrint_t)pos, (jl_value_t*)a);
         if (!a->ptrarray) {
             size_t tot = jl_array_len(a) * a->elsize;
             ios_read(s, jl_array_data(a), tot);
+            if (usetable && a->elsize == 1)
+                ios_skip(s, 1);
         }
         else {
             for(i=0; i < jl_array_len(a); i++) {
@@ -554,7 +835,7 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
             len = read_int32(s);
         jl_expr_t *e = jl_exprn((jl_sym_t*)jl_deserialize_value(s), len);
         if (usetable)
-            ptrhash_put(&backref_table, (void*)(ptrint_t)pos, (jl_value_t*)e);
+            ptrhash_put(backrefs, (void*)(ptrint_t)pos, (jl_value_t*)e);
         e->etype = jl_deserialize_value(s);
         for(i=0; i < len; i++) {
             jl_cellset(e->args, i, jl_deserialize_value(s));
@@ -562,12 +843,54 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
         return (jl_value_t*)e;
     }
     else if (vtag == (jl_value_t*)LiteralVal_tag) {
-        return jl_cellref(tree_literal_values, read_uint16(s));
+        return jl_cellref(tree_literal_values, read_varint(s));
+    }
+    else if (vtag == (jl_value_t*)GlobalRef_tag) {
+        jl_module_t *m = jl_main_module;
+        jl_sym_t *name;
+        while ((name = (jl_sym_t*)jl_deserialize_value(s)) != NULL) {
+            m = (jl_module_t*)jl_get_global(m, name);
+            if (m == NULL || !jl_is_module(m))
+                jl_errorf("module %s is not loaded", name->name);
+        }
+        name = (jl_sym_t*)jl_deserialize_value(s);
+        jl_value_t *v = (jl_value_t*)m;
+        if (name != NULL) {
+            v = jl_get_global(m, name);
+            if (v == NULL)
+                jl_errorf("%s.%s is not defined", m->name->name, name->name);
+        }
+        ptrhash_put(backrefs, (void*)(ptrint_t)pos, v);
+        return v;
+    }
+    else if (vtag == (jl_value_t*)TypeApply_tag) {
+        jl_value_t *tc = jl_deserialize_value(s);
+        jl_tuple_t *params = (jl_tuple_t*)jl_deserialize_value(s);
+        jl_value_t *v = jl_apply_type(tc, params);
+        ptrhash_put(backrefs, (void*)(ptrint_t)pos, v);
+        return v;
+    }
+    else if (vtag == (jl_value_t*)SharedRef_tag) {
+        jl_value_t *v = ptrhash_get(&shared_table, (void*)(ptrint_t)read_int32(s));
+        assert(v != HT_NOTFOUND);
+        return v;
+    }
+    else if (vtag == (jl_value_t*)SymRef_tag) {
+        return (jl_value_t*)tree_symbol_list->items[read_varint(s)];
+    }
+    else if (vtag == (jl_value_t*)LineNode_tag) {
+        return jl_new_struct(jl_linenumbernode_type, jl_box_long(read_varint(s)));
+    }
+    else if (vtag == (jl_value_t*)LabelNode_tag) {
+        return jl_new_struct(jl_labelnode_type, jl_box_long(read_varint(s)));
+    }
+    else if (vtag == (jl_value_t*)GotoNode_tag) {
+        return jl_new_struct(jl_gotonode_type, jl_box_long(read_varint(s)));
     }
     else if (vtag == (jl_value_t*)jl_tvar_type) {
         jl_tvar_t *tv = (jl_tvar_t*)newobj((jl_value_t*)jl_tvar_type, 4);
         if (usetable)
-            ptrhash_put(&backref_table, (void*)(ptrint_t)pos, tv);
+            ptrhash_put(backrefs, (void*)(ptrint_t)pos, tv);
         tv->name = (jl_sym_t*)jl_deserialize_value(s);
         tv->lb = jl_deserialize_value(s);
         tv->ub = jl_deserialize_value(s);
@@ -578,7 +901,7 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
         jl_function_t *f =
             (jl_function_t*)newobj((jl_value_t*)jl_function_type, 3);
         if (usetable)
-            ptrhash_put(&backref_table, (void*)(ptrint_t)pos, f);
+            ptrhash_put(backrefs, (void*)(ptrint_t)pos, f);
         f->linfo = (jl_lambda_info_t*)jl_deserialize_value(s);
         f->env = jl_deserialize_value(s);
         f->fptr = jl_deserialize_fptr(s);
@@ -589,7 +912,7 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
             (jl_lambda_info_t*)newobj((jl_value_t*)jl_lambda_info_type,
                                       LAMBDA_INFO_NW);
         if (usetable)
-            ptrhash_put(&backref_table, (void*)(ptrint_t)pos, li);
+            ptrhash_put(backrefs, (void*)(ptrint_t)pos, li);
         li->ast = jl_deserialize_value(s);
         li->sparams = (jl_tuple_t*)jl_deserialize_value(s);
         li->tfunc = jl_deserialize_value(s);
@@ -616,7 +939,7 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
         jl_sym_t *mname = (jl_sym_t*)jl_deserialize_value(s);
         jl_module_t *m = jl_new_module(mname);
         if (usetable)
-            ptrhash_put(&backref_table, (void*)(ptrint_t)pos, m);
+            ptrhash_put(backrefs, (void*)(ptrint_t)pos, m);
         m->parent = (jl_module_t*)jl_deserialize_value(s);
         while (1) {
             jl_value_t *name = jl_deserialize_value(s);
@@ -638,15 +961,15 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
         return (jl_value_t*)m;
     }
     else if (vtag == (jl_value_t*)SmallInt64_tag) {
-        jl_value_t *v = jl_box_int64(read_int32(s));
+        jl_value_t *v = jl_box_int64(usetable ? read_int32(s) : read_svarint(s));
         if (usetable)
-            ptrhash_put(&backref_table, (void*)(ptrint_t)pos, v);
+            ptrhash_put(backrefs, (void*)(ptrint_t)pos, v);
         return v;
     }
     else if (vtag == (jl_value_t*)Int32_tag) {
-        jl_value_t *v = jl_box_int32(read_int32(s));
+        jl_value_t *v = jl_box_int32(usetable ? read_int32(s) : read_svarint(s));
         if (usetable)
-            ptrhash_put(&backref_table, (void*)(ptrint_t)pos, v);
+            ptrhash_put(backrefs, (void*)(ptrint_t)pos, v);
         return v;
     }
     else if (vtag == (jl_value_t*)jl_datatype_type || vtag == (jl_value_t*)IdTable_tag) {
@@ -679,12 +1002,12 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
                 }
             }
             if (usetable)
-                ptrhash_put(&backref_table, (void*)(ptrint_t)pos, v);
+                ptrhash_put(backrefs, (void*)(ptrint_t)pos, v);
         }
         else {
             v = jl_new_struct_uninit(dt);
             if (usetable)
-                ptrhash_put(&backref_table, (void*)(ptrint_t)pos, v);
+                ptrhash_put(backrefs, (void*)(ptrint_t)pos, v);
             if (vtag == (jl_value_t*)IdTable_tag) {
                 jl_array_t *a = jl_alloc_cell_1d(32);
                 while (1) {
@@ -701,6 +1024,13 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
                     jl_set_nth_field(v, i, jl_deserialize_value(s));
                 }
             }
+            if (restoring_module && dt == jl_methtable_type) {
+                // indexed by type uids, which are new in this session
+                jl_methtable_t *mt = (jl_methtable_t*)v;
+                mt->cache = JL_NULL;
+                mt->cache_arg1 = JL_NULL;
+                mt->cache_targ = JL_NULL;
+            }
         }
         // TODO: put WeakRefs on the weak_refs list
         return v;
@@ -711,6 +1041,41 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
 
 // --- entry points ---
 
+// the saved globals of the modules under m whose values are not modules,
+// as (module, binding) pairs, in the order jl_serialize_module writes them
+static void image_globals(jl_module_t *m, arraylist_t *list, htable_t *visited)
+{
+    ptrhash_put(visited, m, m);
+    void **table = m->bindings.table;
+    for(size_t i=1; i < m->bindings.size; i+=2) {
+        if (table[i] == HT_NOTFOUND)
+            continue;
+        jl_binding_t *b = (jl_binding_t*)table[i];
+        if (!module_binding_saved(m, b) || b->value == NULL)
+            continue;
+        if (jl_is_module(b->value)) {
+            if (ptrhash_get(visited, b->value) == HT_NOTFOUND)
+                image_globals((jl_module_t*)b->value, list, visited);
+        }
+        else {
+            arraylist_push(list, m);
+            arraylist_push(list, b);
+        }
+    }
+}
+
+#define image_global(list, i) ((jl_binding_t*)(list)->items[2*(i)+1])
+
+// the objects marked for the first section of the image
+static void shared_objects(arraylist_t *list)
+{
+    void **table = obj_section.table;
+    for(size_t i=1; i < obj_section.size; i+=2) {
+        if (table[i] == (void*)2)
+            arraylist_push(list, table[i-1]);
+    }
+}
+
 DLLEXPORT
 void jl_save_system_image(char *fname)
 {
@@ -738,12 +1103,142 @@ void jl_save_system_image(char *fname)
 
     jl_idtable_type = jl_get_global(jl_base_module, jl_symbol("ObjectIdDict"));
 
-    jl_serialize_value(&f, jl_array_type->env);
-
-    jl_serialize_value(&f, jl_main_module);
+    // the saved globals, as (module, binding) pairs, and their sections
+    arraylist_t globals;
+    arraylist_new(&globals, 0);
+    htable_t visited;
+    htable_new(&visited, 0);
+    image_globals(jl_main_module, &globals, &visited);
+    htable_free(&visited);
+    size_t ng = globals.len/2, i;
+    int *gsection = (int*)malloc(ng*sizeof(int));
+    ios_t scratch;
+
+    // split the globals into runs of about the same size
+    ios_mem(&scratch, 0);
+    sections_mode = SECTIONS_MARK;
+    cur_section = 0;
+    htable_reset(&obj_section, 50000);
+    jl_serialize_value(&scratch, jl_array_type->env);
+    size_t *sizes = (size_t*)malloc(ng*sizeof(size_t));
+    for(i=0; i < ng; i++) {
+        size_t start = ios_pos(&scratch);
+        jl_serialize_value(&scratch, image_global(&globals, i)->value);
+        sizes[i] = ios_pos(&scratch) - start;
+    }
+    size_t total = ios_pos(&scratch)+1, acc = 0;
+    for(i=0; i < ng; i++) {
+        gsection[i] = 1 + (int)((double)acc/total*(JL_IMAGE_SECTIONS-1));
+        acc += sizes[i];
+    }
+    free(sizes);
+    ios_close(&scratch);
+
+    // find the objects reached from each run, and those that are shared
+    ios_mem(&scratch, 0);
+    htable_reset(&obj_section, 50000);
+    for(cur_section=1; cur_section < JL_IMAGE_SECTIONS; cur_section++) {
+        htable_reset(&backref_table, 50000);
+        for(i=0; i < ng; i++) {
+            if (gsection[i] == cur_section)
+                jl_serialize_value(&scratch, image_global(&globals, i)->value);
+        }
+    }
+    arraylist_t shared;
+    arraylist_new(&shared, 0);
+    shared_objects(&shared);
+    sections_mode = SECTIONS_SHARED;
+    cur_section = 0;
+    htable_reset(&backref_table, 50000);
+    jl_serialize_value(&scratch, jl_array_type->env);
+    for(i=0; i < ng; i++)
+        jl_serialize_value(&scratch, image_global(&globals, i)->type);
+    for(i=0; i < shared.len; i++)
+        jl_serialize_value(&scratch, shared.items[i]);
+    ios_close(&scratch);
+    shared.len = 0;
+    shared_objects(&shared);
+
+    ios_t sections[JL_IMAGE_SECTIONS];
+    sections_mode = SECTIONS_WRITE;
+    ios_mem(&sections[0], 0);
+    htable_reset(&shared_table, 50000);
+    backrefs = &shared_table;
+    jl_serialize_value(&sections[0], jl_array_type->env);
+    jl_serialize_value(&sections[0], jl_main_module);
+    for(i=0; i < shared.len; i++)
+        jl_serialize_value(&sections[0], shared.items[i]);
+    jl_serialize_value(&sections[0], NULL);
+    backrefs = &backref_table;
+    for(cur_section=1; cur_section < JL_IMAGE_SECTIONS; cur_section++) {
+        ios_t *sec = &sections[cur_section];
+        ios_mem(sec, 0);
+        htable_reset(&backref_table, 50000);
+        for(i=0; i < ng; i++) {
+            jl_binding_t *b = image_global(&globals, i);
+            if (gsection[i] == cur_section &&
+                object_section(b->value) == cur_section) {
+                jl_serialize_value(sec, globals.items[2*i]);
+                jl_serialize_value(sec, b->name);
+                jl_serialize_value(sec, b->value);
+            }
+        }
+        jl_serialize_value(sec, NULL);
+    }
+    sections_mode = SECTIONS_OFF;
+    cur_section = 0;
 
+    ios_write(&f, JL_IMAGE_MAGIC, sizeof(JL_IMAGE_MAGIC)-1);
+    write_int32(&f, JL_IMAGE_VERSION);
     write_int32(&f, jl_get_t_uid_ctr());
     write_int32(&f, jl_get_gs_ctr());
+    write_int32(&f, JL_IMAGE_SECTIONS);
+    // the data of each section as stored, and its length before
+    // compression, or 0 if it isn't compressed
+    char *sdata[JL_IMAGE_SECTIONS];
+    size_t slen[JL_IMAGE_SECTIONS], sraw[JL_IMAGE_SECTIONS];
+    for(i=0; i < JL_IMAGE_SECTIONS; i++) {
+        sdata[i] = sections[i].buf;
+        slen[i] = sections[i].size;
+        sraw[i] = 0;
+#ifdef JL_COMPRESS_IMAGE
+        size_t cap = lz_bound(slen[i]);
+        char *c = (char*)malloc(cap);
+        size_t clen = lz_compress((uint8_t*)sdata[i], slen[i], (uint8_t*)c, cap);
+        if (clen != 0) {
+            sdata[i] = c;
+            sraw[i] = slen[i];
+            slen[i] = clen;
+        }
+        else {
+            free(c);
+        }
+#endif
+    }
+    size_t pos = ios_pos(&f) + JL_IMAGE_SECTIONS*12;
+    for(i=0; i < JL_IMAGE_SECTIONS; i++) {
+        pos = LLT_ALIGN(pos, JL_IMAGE_ALIGN);
+        write_int32(&f, pos);
+        write_int32(&f, slen[i]);
+        write_int32(&f, sraw[i]);
+        pos += slen[i];
+    }
+    for(i=0; i < JL_IMAGE_SECTIONS; i++) {
+        // bits arrays are aligned relative to the start of their section
+        size_t pad = LLT_ALIGN(ios_pos(&f), JL_IMAGE_ALIGN) - ios_pos(&f);
+        while (pad-- > 0)
+            write_uint8(&f, 0);
+        ios_write(&f, sdata[i], slen[i]);
+        if (sraw[i] != 0)
+            free(sdata[i]);
+        ios_close(&sections[i]);
+    }
+
+    free(gsection);
+    arraylist_free(&shared);
+    arraylist_free(&globals);
+    htable_reset(&obj_section, 0);
+    htable_reset(&shared_table, 0);
     htable_reset(&backref_table, 0);
 
     ios_close(&f);
@@ -755,26 +1250,210 @@ extern int jl_boot_file_loaded;
 extern void jl_get_builtin_hooks(void);
 extern void jl_get_system_hooks(void);
 extern void jl_get_uv_hooks(void);
+extern void jl_add_constructors(jl_datatype_t *t);
+
+// the contents of file fname, mapped copy-on-write where possible.
+// never released, since the restored arrays point into it.
+static char *map_image(char *fname, size_t *psz)
+{
+#ifndef __WIN32__
+    int fd = open(fname, O_RDONLY);
+    if (fd == -1)
+        return NULL;
+    struct stat st;
+    char *p = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        p = (char*)mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+            p = NULL;
+        *psz = st.st_size;
+        image_stamp = ((int64_t)st.st_mtime << 32) ^ st.st_size;
+    }
+    close(fd);
+    return p;
+#else
+    ios_t f;
+    if (ios_file(&f, fname, 1, 0, 0, 0) == NULL)
+        return NULL;
+    ios_t buf;
+    ios_mem(&buf, 0);
+    ios_copyall(&buf, &f);
+    ios_close(&f);
+    char *p = ios_takebuf(&buf, psz);
+    image_stamp = *psz;
+    return p;
+#endif
+}
+
+// the sections of the image being restored, the (module, name, value)
+// triples read from each, and the next one to read
+static ios_t *image_sections = NULL;
+static int n_image_sections = 0;
+static jl_array_t *section_globals = NULL;
+static volatile int next_section = 0;
+// the first error thrown while reading them, rethrown on the main thread
+static jl_value_t * volatile restore_error = NULL;
+// the length of each section before compression, or 0 if it isn't compressed
+static size_t *image_section_raw = NULL;
+
+// replace the data of section k with its decompressed form, if it is
+// compressed. the buffer is never freed, since restored arrays point into it.
+static void inflate_section(int k)
+{
+    size_t raw = image_section_raw[k];
+    if (raw == 0)
+        return;
+    ios_t *s = &image_sections[k];
+    char *p = (char*)malloc(raw + JL_IMAGE_ALIGN);
+    char *data = (char*)LLT_ALIGN((uptrint_t)p, JL_IMAGE_ALIGN);
+    if (p == NULL ||
+        lz_decompress((uint8_t*)s->buf, s->size, (uint8_t*)data, raw) != 0) {
+        JL_PRINTF(JL_STDERR, "system image is corrupt\n");
+        exit(1);
+    }
+    ios_close(s);
+    ios_static_buffer(s, data, raw);
+}
+
+// read sections until none are left. runs on several threads at once;
+// arg is non-NULL on the threads started for it.
+static void *restore_sections(void *arg)
+{
+    if (arg != NULL) {
+        // somewhere for errors to go
+        jl_current_task = jl_new_root_task(NULL, 0);
+        jl_root_task = jl_current_task;
+        jl_exception_in_transit = (jl_value_t*)jl_null;
+    }
+    htable_t table;
+    htable_new(&table, 0);
+    backrefs = &table;
+    JL_TRY {
+        int k;
+        while ((k = __sync_fetch_and_add(&next_section, 1)) < n_image_sections) {
+            inflate_section(k);
+            ios_t *s = &image_sections[k];
+            jl_array_t *g = (jl_array_t*)jl_cellref(section_globals, k);
+            htable_reset(&table, 5000);
+            jl_value_t *m;
+            while ((m = jl_deserialize_value(s)) != NULL) {
+                jl_cell_1d_push(g, m);
+                jl_cell_1d_push(g, jl_deserialize_value(s));
+                jl_cell_1d_push(g, jl_deserialize_value(s));
+            }
+        }
+    }
+    JL_CATCH {
+        __sync_bool_compare_and_swap(&restore_error, NULL, jl_exception_in_transit);
+        next_section = n_image_sections;  // the others stop too
+    }
+    htable_free(&table);
+    backrefs = &backref_table;
+    return NULL;
+}
 
 DLLEXPORT
 void jl_restore_system_image(char *fname)
 {
     ios_t f;
     char *fpath = fname;
-    if (ios_file(&f, fpath, 1, 0, 0, 0) == NULL) {
+    size_t sz = 0;
+    image_base = map_image(fpath, &sz);
+    if (image_base == NULL) {
         JL_PRINTF(JL_STDERR, "system image file not found\n");
         exit(1);
     }
+    ios_static_buffer(&f, image_base, sz);
+    size_t nmagic = sizeof(JL_IMAGE_MAGIC)-1;
+    if (sz < nmagic+4 || memcmp(image_base, JL_IMAGE_MAGIC, nmagic) != 0) {
+        JL_PRINTF(JL_STDERR, "%s is not a system image\n", fpath);
+        exit(1);
+    }
+    ios_skip(&f, nmagic);
+    if (read_int32(&f) != JL_IMAGE_VERSION) {
+        JL_PRINTF(JL_STDERR, "system image %s was built by a different version; rebuild it\n", fpath);
+        exit(1);
+    }
 #ifdef JL_GC_MARKSWEEP
     int en = jl_gc_is_enabled();
     jl_gc_disable();
 #endif
+    jl_set_t_uid_ctr(read_int32(&f));
+    jl_set_gs_ctr(read_int32(&f));
+    n_image_sections = read_int32(&f);
+    image_sections = (ios_t*)malloc(n_image_sections*sizeof(ios_t));
+    image_section_raw = (size_t*)malloc(n_image_sections*sizeof(size_t));
+    int i;
+    for(i=0; i < n_image_sections; i++) {
+        size_t offs = read_int32(&f);
+        size_t len = read_int32(&f);
+        image_section_raw[i] = read_int32(&f);
+        if (offs+len > sz) {
+            JL_PRINTF(JL_STDERR, "system image %s is truncated\n", fpath);
+            exit(1);
+        }
+        ios_static_buffer(&image_sections[i], image_base+offs, len);
+    }
+    ios_close(&f);
 
     datatype_list = jl_alloc_cell_1d(0);
 
-    jl_array_type->env = jl_deserialize_value(&f);
-    
-    jl_main_module = (jl_module_t*)jl_deserialize_value(&f);
+    inflate_section(0);
+    ios_t *s0 = &image_sections[0];
+    htable_reset(&shared_table, 50000);
+    backrefs = &shared_table;
+    jl_array_type->env = jl_deserialize_value(s0);
+    jl_main_module = (jl_module_t*)jl_deserialize_value(s0);
+    while (jl_deserialize_value(s0) != NULL)
+        ;
+    backrefs = &backref_table;
+
+    section_globals = jl_alloc_cell_1d(n_image_sections);
+    for(i=1; i < n_image_sections; i++)
+        jl_cellset(section_globals, i, jl_alloc_cell_1d(0));
+    next_section = 1;
+#ifdef JULIA_THREADS
+    int nt = jl_nthreads();
+    if (nt > n_image_sections-1)
+        nt = n_image_sections-1;
+    pthread_t *threads = (pthread_t*)alloca(nt*sizeof(pthread_t));
+    jl_threads_running = 1;
+    int started = 1;
+    while (started < nt &&
+           jl_start_thread(&threads[started], restore_sections, (void*)1) == 0)
+        started++;
+    restore_sections(NULL);
+    for(i=1; i < started; i++)
+        pthread_join(threads[i], NULL);
+    jl_threads_running = 0;
+#else
+    restore_sections(NULL);
+#endif
+    if (restore_error != NULL) {
+        jl_value_t *e = restore_error;
+        restore_error = NULL;
+        jl_throw(e);
+    }
+
+    // bind the globals read from the later sections
+    for(i=1; i < n_image_sections; i++) {
+        jl_array_t *g = (jl_array_t*)jl_cellref(section_globals, i);
+        for(size_t j=0; j < jl_array_len(g); j+=3) {
+            jl_module_t *m = (jl_module_t*)jl_cellref(g, j);
+            jl_binding_t *b = (jl_binding_t*)ptrhash_get(&m->bindings, jl_cellref(g, j+1));
+            assert(b != HT_NOTFOUND);
+            b->value = jl_cellref(g, j+2);
+        }
+        ios_close(&image_sections[i]);
+    }
+    ios_close(s0);
+    free(image_sections);
+    free(image_section_raw);
+    image_sections = NULL;
+    image_section_raw = NULL;
+    section_globals = NULL;
+    htable_reset(&shared_table, 0);
+
     jl_core_module = (jl_module_t*)jl_get_global(jl_main_module,
                                                  jl_symbol("Core"));
     jl_base_module = (jl_module_t*)jl_get_global(jl_main_module,
@@ -782,7 +1461,7 @@ void jl_restore_system_image(char *fname)
     jl_current_module = jl_base_module; // run start_image in Base
 
     // cache builtin parametric types
-    for(int i=0; i < jl_array_len(datatype_list); i++) {
+    for(i=0; i < jl_array_len(datatype_list); i++) {
         jl_value_t *v = jl_cellref(datatype_list, i);
         uint32_t uid = ((jl_datatype_t*)v)->uid;
         jl_cache_type_((jl_datatype_t*)v);
@@ -797,11 +1476,7 @@ void jl_restore_system_image(char *fname)
                                                     jl_symbol("typeinf_ext"));
     jl_init_box_caches();
 
-    jl_set_t_uid_ctr(read_int32(&f));
-    jl_set_gs_ctr(read_int32(&f));
-    htable_reset(&backref_table, 0);
-
-    ios_close(&f);
+    image_base = NULL;
     if (fpath != fname) free(fpath);
 
 #ifdef JL_GC_MARKSWEEP
@@ -809,12 +1484,202 @@ void jl_restore_system_image(char *fname)
 #endif
 }
 
+// find the constant globals of the modules under m, except saving_module,
+// and the methods saving_module added to the functions among them
+static void collect_external(jl_module_t *m)
+{
+    void **table = m->bindings.table;
+    for(size_t i=1; i < m->bindings.size; i+=2) {
+        if (table[i] == HT_NOTFOUND)
+            continue;
+        jl_binding_t *b = (jl_binding_t*)table[i];
+        jl_value_t *v = b->value;
+        if (b->owner != m || !b->constp || v == NULL)
+            continue;
+        if (jl_is_module(v)) {
+            jl_module_t *child = (jl_module_t*)v;
+            if (child != m && child->parent == m &&
+                !module_in(child, saving_module))
+                collect_external(child);
+            continue;
+        }
+        if (jl_isbits(jl_typeof(v)))
+            continue;
+        void **bp = ptrhash_bp(&external_names, v);
+        if (*bp != HT_NOTFOUND)
+            continue;
+        *bp = b;
+        if ((jl_is_function(v) || jl_is_datatype(v)) && jl_is_gf(v)) {
+            jl_methlist_t *ml = jl_gf_mtable(v)->defs;
+            while (ml != JL_NULL) {
+                jl_lambda_info_t *li = ml->func->linfo;
+                if (li != NULL && module_in(li->module, saving_module)) {
+                    jl_cell_1d_push(external_methods, v);
+                    jl_cell_1d_push(external_methods, (jl_value_t*)ml->sig);
+                    jl_cell_1d_push(external_methods, (jl_value_t*)ml->tvars);
+                    jl_cell_1d_push(external_methods, (jl_value_t*)ml->func);
+                }
+                ml = ml->next;
+            }
+        }
+    }
+}
+
+static void end_module_cache(int en)
+{
+    saving_module = NULL;
+    restoring_module = 0;
+    external_methods = NULL;
+    htable_reset(&external_names, 0);
+    htable_reset(&backref_table, 0);
+    if (en) jl_gc_enable();
+}
+
+// the cache of module m, as an array of bytes
+DLLEXPORT
+jl_value_t *jl_save_module(jl_module_t *m)
+{
+    if (m == jl_main_module || m == jl_core_module || m == jl_base_module)
+        jl_errorf("cannot save module %s", m->name->name);
+    int en = jl_gc_is_enabled();
+    jl_gc_disable();
+    htable_reset(&backref_table, 5000);
+    htable_reset(&external_names, 5000);
+    saving_module = m;
+    external_methods = jl_alloc_cell_1d(0);
+    jl_idtable_type = jl_get_global(jl_base_module, jl_symbol("ObjectIdDict"));
+    ios_t dest;
+    ios_mem(&dest, 0);
+    JL_TRY {
+        collect_external(jl_main_module);
+
+        ios_write(&dest, JL_MODULE_MAGIC, sizeof(JL_MODULE_MAGIC)-1);
+        write_int32(&dest, JL_IMAGE_VERSION);
+        ios_write(&dest, (char*)&image_stamp, sizeof(image_stamp));
+
+        jl_serialize_value(&dest, m);
+        for(size_t i=0; i < jl_array_len(external_methods); i++)
+            jl_serialize_value(&dest, jl_cellref(external_methods, i));
+        jl_serialize_value(&dest, NULL);
+    }
+    JL_CATCH {
+        ios_close(&dest);
+        end_module_cache(en);
+        jl_rethrow();
+    }
+    jl_value_t *data = (jl_value_t*)jl_takebuf_array(&dest);
+    end_module_cache(en);
+    return data;
+}
+
+// restore a module from its cache, and bind it in its parent. returns
+// nothing if the cache was made from a different system image.
+DLLEXPORT
+jl_value_t *jl_restore_module(jl_array_t *data)
+{
+    size_t nmagic = sizeof(JL_MODULE_MAGIC)-1;
+    size_t sz = jl_array_len(data);
+    if (sz < nmagic+4+sizeof(image_stamp) ||
+        memcmp(data->data, JL_MODULE_MAGIC, nmagic) != 0)
+        jl_error("not a module cache");
+    ios_t src;
+    ios_static_buffer(&src, (char*)data->data, sz);
+    ios_skip(&src, nmagic);
+    int64_t stamp;
+    if (read_int32(&src) != JL_IMAGE_VERSION)
+        return (jl_value_t*)jl_nothing;
+    ios_read(&src, (char*)&stamp, sizeof(stamp));
+    if (stamp != image_stamp || image_stamp == 0)
+        return (jl_value_t*)jl_nothing;
+
+    int en = jl_gc_is_enabled();
+    jl_gc_disable();
+    htable_reset(&backref_table, 5000);
+    restoring_module = 1;
+    jl_module_t *m = NULL;
+    JL_TRY {
+        m = (jl_module_t*)jl_deserialize_value(&src);
+        if (!jl_is_module(m))
+            jl_error("not a module cache");
+        // (function, signature, type vars, method) of the methods it adds
+        // to functions of other modules
+        jl_array_t *methods = jl_alloc_cell_1d(0);
+        while (1) {
+            jl_value_t *gf = jl_deserialize_value(&src);
+            if (gf == NULL)
+                break;
+            jl_cell_1d_push(methods, gf);
+            for(int i=0; i < 3; i++)
+                jl_cell_1d_push(methods, jl_deserialize_value(&src));
+        }
+        // nothing is changed outside the module until all of it is read, so
+        // that a cache that fails to load leaves no trace
+        jl_set_const(m->parent, m->name, (jl_value_t*)m);
+        for(size_t i=0; i < jl_array_len(methods); i+=4) {
+            jl_value_t *gf = jl_cellref(methods, i);
+            if (jl_is_datatype(gf) &&
+                ((jl_function_t*)gf)->fptr == jl_f_ctor_trampoline)
+                jl_add_constructors((jl_datatype_t*)gf);
+            jl_add_method((jl_function_t*)gf, (jl_tuple_t*)jl_cellref(methods, i+1),
+                          (jl_function_t*)jl_cellref(methods, i+3),
+                          (jl_tuple_t*)jl_cellref(methods, i+2));
+        }
+    }
+    JL_CATCH {
+        end_module_cache(en);
+        jl_rethrow();
+    }
+    end_module_cache(en);
+    return (jl_value_t*)m;
+}
+
+/*
+  recently uncompressed trees are kept in a direct-mapped cache keyed by
+  their compressed data, since inference, inlining and codegen each ask
+  for the body of the same lambda in turn. callers are free to modify the
+  tree they get, so they are given a copy of the cached one. only trees of
+  up to JL_AST_CACHE_MAXBYTES compressed are kept, which bounds the memory
+  held by the cache.
+*/
+#define JL_AST_CACHE_SIZE 128
+#define JL_AST_CACHE_MAXBYTES 4096
+
+// compressed data in [0,n), the uncompressed tree in [n,2n)
+jl_array_t *jl_ast_cache = NULL;
+
+// copy of the parts of a tree that can be modified: exprs and cell arrays
+static jl_value_t *copy_tree(jl_value_t *v)
+{
+    if (v == NULL)
+        return v;
+    if (jl_is_expr(v)) {
+        jl_expr_t *e = (jl_expr_t*)v;
+        size_t l = jl_array_len(e->args);
+        jl_expr_t *ne = jl_exprn(e->head, l);
+        ne->etype = e->etype;
+        for(size_t i=0; i < l; i++)
+            jl_exprarg(ne, i) = copy_tree(jl_exprarg(e, i));
+        return (jl_value_t*)ne;
+    }
+    if (jl_typeis(v, jl_array_any_type)) {
+        jl_array_t *a = (jl_array_t*)v;
+        jl_array_t *na = jl_alloc_cell_1d(jl_array_len(a));
+        for(size_t i=0; i < jl_array_len(a); i++)
+            jl_cellset(na, i, copy_tree(jl_cellref(a, i)));
+        return (jl_value_t*)na;
+    }
+    return v;
+}
+
 DLLEXPORT
 jl_value_t *jl_ast_rettype(jl_lambda_info_t *li, jl_value_t *ast)
 {
     if (jl_is_expr(ast))
         return jl_lam_body((jl_expr_t*)ast)->etype;
     tree_literal_values = li->def->roots;
+    arraylist_t syms;
+    arraylist_new(&syms, 0);
+    tree_symbol_list = &syms;
     ios_t src;
     jl_array_t *bytes = (jl_array_t*)ast;
     ios_mem(&src, 0);
@@ -822,6 +1687,8 @@ jl_value_t *jl_ast_rettype(jl_lambda_info_t *li, jl_value_t *ast)
     src.size = jl_array_len(bytes);
     jl_value_t *rt = jl_deserialize_value(&src);
     tree_literal_values = NULL;
+    tree_symbol_list = NULL;
+    arraylist_free(&syms);
     return rt;
 }
 
@@ -831,6 +1698,10 @@ jl_value_t *jl_compress_ast(jl_lambda_info_t *li, jl_value_t *ast)
     ios_t dest;
     ios_mem(&dest, 0);
     jl_array_t *last_tlv = tree_literal_values;
+    htable_t *last_syms = tree_symbols;
+    size_t last_nsyms = tree_nsymbols;
+    htable_t syms;
+    htable_new(&syms, 0);
     int en = jl_gc_is_enabled();
     jl_gc_disable();
 
@@ -839,6 +1710,8 @@ jl_value_t *jl_compress_ast(jl_lambda_info_t *li, jl_value_t *ast)
         def->roots = jl_alloc_cell_1d(0);
     }
     tree_literal_values = def->roots;
+    tree_symbols = &syms;
+    tree_nsymbols = 0;
     li->capt = (jl_value_t*)jl_lam_capt((jl_expr_t*)ast);
     if (jl_array_len(li->capt) == 0)
         li->capt = NULL;
@@ -852,6 +1725,9 @@ jl_value_t *jl_compress_ast(jl_lambda_info_t *li, jl_value_t *ast)
         def->roots = NULL;
     }
     tree_literal_values = last_tlv;
+    tree_symbols = last_syms;
+    tree_nsymbols = last_nsyms;
+    htable_free(&syms);
     if (en)
         jl_gc_enable();
     return v;
@@ -861,20 +1737,37 @@ DLLEXPORT
 jl_value_t *jl_uncompress_ast(jl_lambda_info_t *li, jl_value_t *data)
 {
     jl_array_t *bytes = (jl_array_t*)data;
+    size_t slot = ((uptrint_t)bytes >> 4) % JL_AST_CACHE_SIZE;
+    int en = jl_gc_is_enabled();
+    jl_gc_disable();
+    if (jl_cellref(jl_ast_cache, slot) == data) {
+        jl_value_t *v = copy_tree(jl_cellref(jl_ast_cache, JL_AST_CACHE_SIZE+slot));
+        if (en)
+            jl_gc_enable();
+        return v;
+    }
     tree_literal_values = li->def->roots;
+    arraylist_t syms;
+    arraylist_new(&syms, 0);
+    tree_symbol_list = &syms;
     ios_t src;
     ios_mem(&src, 0);
     ios_setbuf(&src, bytes->data, jl_array_len(bytes), 0);
     src.size = jl_array_len(bytes);
-    int en = jl_gc_is_enabled();
-    jl_gc_disable();
     jl_gc_ephemeral_on();
     (void)jl_deserialize_value(&src); // skip ret type
     jl_value_t *v = jl_deserialize_value(&src);
     jl_gc_ephemeral_off();
+    tree_literal_values = NULL;
+    tree_symbol_list = NULL;
+    arraylist_free(&syms);
+    if (jl_array_len(bytes) <= JL_AST_CACHE_MAXBYTES) {
+        jl_cellset(jl_ast_cache, slot, data);
+        jl_cellset(jl_ast_cache, JL_AST_CACHE_SIZE+slot, v);
+        v = copy_tree(v);
+    }
     if (en)
         jl_gc_enable();
-    tree_literal_values = NULL;
     return v;
 }
 
@@ -887,13 +1780,21 @@ void jl_init_serializer(void)
     htable_new(&fptr_to_id, 0);
     htable_new(&id_to_fptr, 0);
     htable_new(&backref_table, 50000);
+    htable_new(&external_names, 0);
+    htable_new(&obj_section, 0);
+    htable_new(&shared_table, 0);
 
+    // a value's tag is its position here, so any change to this list
+    // needs a new JL_IMAGE_VERSION
     void *tags[] = { jl_symbol_type, jl_datatype_type,
                      jl_function_type, jl_tuple_type, jl_array_type,
                      jl_expr_type, (void*)LongSymbol_tag, (void*)LongTuple_tag,
                      (void*)LongExpr_tag, (void*)LiteralVal_tag,
                      (void*)SmallInt64_tag, (void*)IdTable_tag,
-                     (void*)Int32_tag,
+                     (void*)Int32_tag, (void*)SymRef_tag,
+                     (void*)LineNode_tag, (void*)LabelNode_tag,
+                     (void*)GotoNode_tag, (void*)GlobalRef_tag,
+                     (void*)TypeApply_tag, (void*)SharedRef_tag,
                      jl_module_type, jl_tvar_type, jl_lambda_info_type,
 
                      jl_null, jl_false, jl_true, jl_any_type, jl_symbol("Any"),
@@ -934,48 +1835,48 @@ void jl_init_serializer(void)
                      jl_box_int32(6), jl_box_int32(7), jl_box_int32(8),
                      jl_box_int32(9), jl_box_int32(10), jl_box_int32(11),
                      jl_box_int32(12), jl_box_int32(13), jl_box_int32(14),
-                     jl_box_int32(15), jl_box_int32(16), jl_box_int32(17),
-                     jl_box_int32(18), jl_box_int32(19), jl_box_int32(20),
-                     jl_box_int32(21), jl_box_int32(22), jl_box_int32(23),
-                     jl_box_int32(24), jl_box_int32(25), jl_box_int32(26),
-                     jl_box_int32(27), jl_box_int32(28), jl_box_int32(29),
-                     jl_box_int32(30), jl_box_int32(31), jl_box_int32(32),
+                     jl_box_int32(15), jl_box_int32(16),
 #ifndef _P64
-                     jl_box_int32(33), jl_box_int32(34), jl_box_int32(35),
-                     jl_box_int32(36), jl_box_int32(37), jl_box_int32(38),
-                     jl_box_int32(39), jl_box_int32(40), jl_box_int32(41),
-                     jl_box_int32(42), jl_box_int32(43), jl_box_int32(44),
-                     jl_box_int32(45), jl_box_int32(46), jl_box_int32(47),
-                     jl_box_int32(48), jl_box_int32(49), jl_box_int32(50),
-                     jl_box_int32(51), jl_box_int32(52), jl_box_int32(53),
-                     jl_box_int32(54), jl_box_int32(55), jl_box_int32(56),
-                     jl_box_int32(57), jl_box_int32(58), jl_box_int32(59),
-                     jl_box_int32(60), jl_box_int32(61), jl_box_int32(62),
-                     jl_box_int32(63), jl_box_int32(64),
+                     jl_box_int32(17), jl_box_int32(18), jl_box_int32(19),
+                     jl_box_int32(20), jl_box_int32(21), jl_box_int32(22),
+                     jl_box_int32(23), jl_box_int32(24), jl_box_int32(25),
+                     jl_box_int32(26), jl_box_int32(27), jl_box_int32(28),
+                     jl_box_int32(29), jl_box_int32(30), jl_box_int32(31),
+                     jl_box_int32(32), jl_box_int32(33), jl_box_int32(34),
+                     jl_box_int32(35), jl_box_int32(36), jl_box_int32(37),
+                     jl_box_int32(38), jl_box_int32(39), jl_box_int32(40),
+                     jl_box_int32(41), jl_box_int32(42), jl_box_int32(43),
+                     jl_box_int32(44), jl_box_int32(45), jl_box_int32(46),
+                     jl_box_int32(47), jl_box_int32(48), jl_box_int32(49),
+                     jl_box_int32(50), jl_box_int32(51), jl_box_int32(52),
+                     jl_box_int32(53), jl_box_int32(54), jl_box_int32(55),
+                     jl_box_int32(56), jl_box_int32(57), jl_box_int32(58),
+                     jl_box_int32(59), jl_box_int32(60), jl_box_int32(61),
+                     jl_box_int32(62), jl_box_int32(63), jl_box_int32(64),
 #endif
                      jl_box_int64(0), jl_box_int64(1), jl_box_int64(2),
                      jl_box_int64(3), jl_box_int64(4), jl_box_int64(5),
                      jl_box_int64(6), jl_box_int64(7), jl_box_int64(8),
                      jl_box_int64(9), jl_box_int64(10), jl_box_int64(11),
                      jl_box_int64(12), jl_box_int64(13), jl_box_int64(14),
-                     jl_box_int64(15), jl_box_int64(16), jl_box_int64(17),
-                     jl_box_int64(18), jl_box_int64(19), jl_box_int64(20),
-                     jl_box_int64(21), jl_box_int64(22), jl_box_int64(23),
-                     jl_box_int64(24), jl_box_int64(25), jl_box_int64(26),
-                     jl_box_int64(27), jl_box_int64(28), jl_box_int64(29),
-                     jl_box_int64(30), jl_box_int64(31), jl_box_int64(32),
+                     jl_box_int64(15), jl_box_int64(16),
 #ifdef _P64
-                     jl_box_int64(33), jl_box_int64(34), jl_box_int64(35),
-                     jl_box_int64(36), jl_box_int64(37), jl_box_int64(38),
-                     jl_box_int64(39), jl_box_int64(40), jl_box_int64(41),
-                     jl_box_int64(42), jl_box_int64(43), jl_box_int64(44),
-                     jl_box_int64(45), jl_box_int64(46), jl_box_int64(47),
-                     jl_box_int64(48), jl_box_int64(49), jl_box_int64(50),
-                     jl_box_int64(51), jl_box_int64(52), jl_box_int64(53),
-                     jl_box_int64(54), jl_box_int64(55), jl_box_int64(56),
-                     jl_box_int64(57), jl_box_int64(58), jl_box_int64(59),
-                     jl_box_int64(60), jl_box_int64(61), jl_box_int64(62),
-                     jl_box_int64(63), jl_box_int64(64),
+                     jl_box_int64(17), jl_box_int64(18), jl_box_int64(19),
+                     jl_box_int64(20), jl_box_int64(21), jl_box_int64(22),
+                     jl_box_int64(23), jl_box_int64(24), jl_box_int64(25),
+                     jl_box_int64(26), jl_box_int64(27), jl_box_int64(28),
+                     jl_box_int64(29), jl_box_int64(30), jl_box_int64(31),
+                     jl_box_int64(32), jl_box_int64(33), jl_box_int64(34),
+                     jl_box_int64(35), jl_box_int64(36), jl_box_int64(37),
+                     jl_box_int64(38), jl_box_int64(39), jl_box_int64(40),
+                     jl_box_int64(41), jl_box_int64(42), jl_box_int64(43),
+                     jl_box_int64(44), jl_box_int64(45), jl_box_int64(46),
+                     jl_box_int64(47), jl_box_int64(48), jl_box_int64(49),
+                     jl_box_int64(50), jl_box_int64(51), jl_box_int64(52),
+                     jl_box_int64(53), jl_box_int64(54), jl_box_int64(55),
+                     jl_box_int64(56), jl_box_int64(57), jl_box_int64(58),
+                     jl_box_int64(59), jl_box_int64(60), jl_box_int64(61),
+                     jl_box_int64(62), jl_box_int64(63), jl_box_int64(64),
 #endif
                      jl_labelnode_type, jl_linenumbernode_type,
                      jl_gotonode_type, jl_quotenode_type, jl_topnode_type,
@@ -1031,7 +1932,7 @@ void jl_init_serializer(void)
                       jl_f_typevar, jl_f_union, 
                       jl_f_methodexists, jl_f_applicable, 
                       jl_f_invoke, jl_apply_generic, 
-                      jl_unprotect_stack, jl_f_task, 
+                      jl_f_task, 
                       jl_f_yieldto, jl_f_ctor_trampoline,
                       NULL };
     i=2;
@@ -1040,4 +1941,5 @@ void jl_init_serializer(void)
         ptrhash_put(&id_to_fptr, (void*)i, fptrs[i-2]);
         i += 1;
     }
+    jl_ast_cache = jl_alloc_cell_1d(2*JL_AST_CACHE_SIZE);
 }
@@ -6,6 +6,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#ifdef JULIA_THREADS
+#include <sched.h>
+#endif
 #include "julia.h"
 
 // with MEMDEBUG, every object is allocated explicitly with malloc, and
@@ -105,6 +108,35 @@ static arraylist_t preserved_values;
 
 static arraylist_t weak_refs;
 
+#ifndef COPY_STACKS
+// tasks that have a stack of their own
+static arraylist_t task_stacks;
+#endif
+
+#ifdef JULIA_THREADS
+// while a threaded region runs, every thread allocates from the same pools
+// under this (recursive) lock. a collection stops the world: the thread
+// that starts it waits until every other thread has either stopped at a
+// safepoint (an allocation, see jl_gc_safepoint) or is waiting somewhere it
+// can't touch the heap (see jl_gc_safe_enter). nothing that holds this lock
+// allocates, so no thread stops while holding it. finalizers can run any
+// code, so they wait for the end of the region.
+pthread_mutex_t jl_gc_lock;
+static int gc_region = 0;  // in a region of jl_threading_run
+static volatile int gc_stopping = 0;  // a collection wants the world stopped
+static volatile int gc_running = 0;   // threads in the region not stopped
+// where each stopped thread's gc frames and task are, for the collector
+static jl_gcframe_t **gc_thread_stacks = NULL;
+static jl_task_t **gc_thread_tasks = NULL;
+#define GC_LOCK()   if (jl_threads_running) pthread_mutex_lock(&jl_gc_lock)
+#define GC_UNLOCK() if (jl_threads_running) pthread_mutex_unlock(&jl_gc_lock)
+#define GC_SAFEPOINT() if (gc_stopping) jl_gc_safepoint()
+#else
+#define GC_LOCK()
+#define GC_UNLOCK()
+#define GC_SAFEPOINT()
+#endif
+
 #ifdef OBJPROFILE
 static htable_t obj_counts;
 #endif
@@ -121,12 +153,16 @@ int jl_gc_n_preserved_values(void)
 
 void jl_gc_preserve(jl_value_t *v)
 {
+    GC_LOCK();
     arraylist_push(&preserved_values, (void*)v);
+    GC_UNLOCK();
 }
 
 void jl_gc_unpreserve(void)
 {
+    GC_LOCK();
     (void)arraylist_pop(&preserved_values);
+    GC_UNLOCK();
 }
 
 DLLEXPORT jl_weakref_t *jl_gc_new_weakref(jl_value_t *value)
@@ -134,7 +170,9 @@ DLLEXPORT jl_weakref_t *jl_gc_new_weakref(jl_value_t *value)
     jl_weakref_t *wr = (jl_weakref_t*)alloc_2w();
     wr->type = (jl_value_t*)jl_weakref_type;
     wr->value = value;
+    GC_LOCK();
     arraylist_push(&weak_refs, wr);
+    GC_UNLOCK();
     return wr;
 }
 
@@ -163,6 +201,32 @@ static void sweep_weak_refs(void)
     weak_refs.len -= ndel;
 }
 
+#ifndef COPY_STACKS
+void jl_gc_add_task_stack(jl_task_t *t)
+{
+    GC_LOCK();
+    arraylist_push(&task_stacks, t);
+    GC_UNLOCK();
+}
+
+// free the stacks of unreachable tasks, and forget finished ones
+static void sweep_task_stacks(void)
+{
+    size_t n = 0;
+    for(size_t i=0; i < task_stacks.len; i++) {
+        jl_task_t *t = (jl_task_t*)task_stacks.items[i];
+        if (t->stkbuf == NULL)
+            continue;
+        if (!gc_marked(t)) {
+            jl_free_task_stack(t);
+            continue;
+        }
+        task_stacks.items[n++] = t;
+    }
+    task_stacks.len = n;
+}
+#endif
+
 static void schedule_finalization(void *o)
 {
     arraylist_push(&to_finalize, o);
@@ -198,6 +262,7 @@ static void run_finalizers(void)
 
 void jl_gc_add_finalizer(jl_value_t *v, jl_function_t *f)
 {
+    GC_LOCK();
     jl_value_t **bp = (jl_value_t**)ptrhash_bp(&finalizer_table, v);
     if (*bp == HT_NOTFOUND) {
         *bp = (jl_value_t*)f;
@@ -205,6 +270,7 @@ void jl_gc_add_finalizer(jl_value_t *v, jl_function_t *f)
     else {
         *bp = (jl_value_t*)jl_tuple2((jl_value_t*)f, *bp);
     }
+    GC_UNLOCK();
 }
 
 static int szclass(size_t sz)
@@ -249,18 +315,21 @@ static void *alloc_big(size_t sz)
     if (allocd_bytes > collect_interval) {
         jl_gc_collect();
     }
+    GC_SAFEPOINT();
     size_t offs = BVOFFS*sizeof(void*);
     if (sz+offs+15 < offs+15)  // overflow in adding offs, size was "negative"
         jl_throw(jl_memory_exception);
     size_t allocsz = (sz+offs+15) & -16;
     bigval_t *v = (bigval_t*)malloc_a16(allocsz);
-    allocd_bytes += allocsz;
     if (v == NULL)
         jl_throw(jl_memory_exception);
     v->sz = sz;
     v->flags = 0;
+    GC_LOCK();
+    allocd_bytes += allocsz;
     v->next = big_objects;
     big_objects = v;
+    GC_UNLOCK();
     return &v->_data[0];
 }
 
@@ -289,6 +358,7 @@ static void sweep_big(void)
 jl_mallocptr_t *jl_gc_acquire_buffer(void *b, size_t sz)
 {
     jl_mallocptr_t *mp;
+    GC_LOCK();
     if (malloc_ptrs_freelist == NULL) {
         mp = malloc(sizeof(jl_mallocptr_t));
     }
@@ -300,6 +370,7 @@ jl_mallocptr_t *jl_gc_acquire_buffer(void *b, size_t sz)
     mp->ptr = b;
     mp->next = malloc_ptrs;
     malloc_ptrs = mp;
+    GC_UNLOCK();
     return mp;
 }
 
@@ -308,11 +379,14 @@ jl_mallocptr_t *jl_gc_managed_malloc(size_t sz)
     if (allocd_bytes > collect_interval) {
         jl_gc_collect();
     }
+    GC_SAFEPOINT();
     sz = (sz+15) & -16;
     void *b = malloc_a16(sz);
     if (b == NULL)
         jl_throw(jl_memory_exception);
+    GC_LOCK();
     allocd_bytes += sz;
+    GC_UNLOCK();
     return jl_gc_acquire_buffer(b, sz);
 }
 
@@ -342,8 +416,10 @@ static void sweep_malloc_ptrs(void)
 static void add_page(pool_t *p)
 {
     gcpage_t *pg = malloc_a16(sizeof(gcpage_t));
-    if (pg == NULL)
+    if (pg == NULL) {
+        GC_UNLOCK();
         jl_throw(jl_memory_exception);
+    }
     gcval_t *v = (gcval_t*)&pg->data[0];
     char *lim = (char*)v + GC_PAGE_SZ - p->osize;
     gcval_t *fl;
@@ -366,6 +442,8 @@ static inline void *pool_alloc(pool_t *p)
     if (allocd_bytes > collect_interval) {
         jl_gc_collect();
     }
+    GC_SAFEPOINT();
+    GC_LOCK();
     allocd_bytes += p->osize;
     if (p->freelist == NULL) {
         add_page(p);
@@ -374,6 +452,7 @@ static inline void *pool_alloc(pool_t *p)
     gcval_t *v = p->freelist;
     p->freelist = p->freelist->next;
     v->flags = 0;
+    GC_UNLOCK();
     return v;
 }
 
@@ -594,10 +673,10 @@ static void gc_mark_all()
         gc_push_root(ta->consumers);
         if (ta->start)  gc_push_root(ta->start);
         if (ta->result) gc_push_root(ta->result);
+#ifdef COPY_STACKS
         if (ta->stkbuf != NULL || ta == jl_current_task) {
             if (ta->stkbuf != NULL)
                 gc_setmark_buf(ta->stkbuf);
-#ifdef COPY_STACKS
             ptrint_t offset;
             if (ta == jl_current_task) {
                 offset = 0;
@@ -607,10 +686,14 @@ static void gc_mark_all()
                 offset = ta->stkbuf - (ta->stackbase-ta->ssize);
                 gc_mark_stack(ta->gcstack, offset);
             }
+        }
 #else
+        // the stack is not managed by the gc, only the frames on it
+        if (ta == jl_current_task)
+            gc_mark_stack(jl_pgcstack, 0);
+        else if (!ta->done)
             gc_mark_stack(ta->gcstack, 0);
 #endif
-        }
     }
     else {
         jl_datatype_t *dt = (jl_datatype_t*)vt;
@@ -628,7 +711,7 @@ static void gc_mark_all()
 
 void jl_mark_box_caches(void);
 
-extern jl_value_t * volatile jl_task_arg_in_transit;
+extern JL_THREAD jl_value_t * volatile jl_task_arg_in_transit;
 #if defined(GCTIME) || defined(GC_FINAL_STATS)
 double clock_now(void);
 #endif
@@ -652,6 +735,30 @@ static void gc_mark(void)
     // active tasks
     gc_push_root(jl_root_task);
     gc_push_root(jl_current_task);
+#ifdef JULIA_THREADS
+    // root tasks of the other threads
+    if (jl_thread_roots) gc_push_root(jl_thread_roots);
+    // and what the threads stopped for this collection are running
+    if (gc_region) {
+        int16_t self = jl_threadid();
+        for(int i=0; i < jl_nthreads(); i++) {
+            if (i != self && gc_thread_tasks[i] != NULL) {
+                gc_push_root(gc_thread_tasks[i]);
+                gc_mark_stack(gc_thread_stacks[i], 0);
+            }
+        }
+    }
+#endif
+    // queued work
+    if (jl_sched_roots) gc_push_root(jl_sched_roots);
+    // functions and types with C-callable entry points
+    if (jl_cfunction_roots) gc_push_root(jl_cfunction_roots);
+    // arrays being written to streams
+    if (jl_write_roots) gc_push_root(jl_write_roots);
+    // types the wire serializer has looked at
+    if (jl_wire_plain_types) gc_push_root(jl_wire_plain_types);
+    // recently uncompressed ASTs
+    if (jl_ast_cache) gc_push_root(jl_ast_cache);
 
     // modules
     gc_push_root(jl_main_module);
@@ -661,7 +768,6 @@ static void gc_mark(void)
     if (jl_an_empty_cell) gc_push_root(jl_an_empty_cell);
     gc_push_root(jl_exception_in_transit);
     gc_push_root(jl_task_arg_in_transit);
-    gc_push_root(jl_unprotect_stack_func);
     gc_push_root(jl_bottom_func);
     gc_push_root(jl_typetype_type);
 
@@ -732,8 +838,113 @@ static void print_obj_profile(void)
 }
 #endif
 
+#ifdef JULIA_THREADS
+// this thread stops touching the heap, e.g. to wait for a lock that a
+// thread stopped for a collection may hold
+void jl_gc_safe_enter(void)
+{
+    if (!gc_region)
+        return;
+    int16_t tid = jl_threadid();
+    gc_thread_stacks[tid] = jl_pgcstack;
+    gc_thread_tasks[tid] = jl_current_task;
+    __sync_fetch_and_sub(&gc_running, 1);
+}
+
+// and goes back to it once no collection is in progress
+void jl_gc_safe_leave(void)
+{
+    if (!gc_region)
+        return;
+    while (1) {
+        __sync_fetch_and_add(&gc_running, 1);
+        if (!gc_stopping)
+            break;
+        __sync_fetch_and_sub(&gc_running, 1);
+        while (gc_stopping)
+            sched_yield();
+    }
+    gc_thread_tasks[jl_threadid()] = NULL;
+}
+
+// a thread that may spend long without allocating calls this now and then,
+// so that it doesn't hold up a collection on another thread
+void jl_gc_safepoint(void)
+{
+    if (gc_stopping) {
+        jl_gc_safe_enter();
+        jl_gc_safe_leave();
+    }
+}
+
+// lock m, which a thread stopped for a collection may hold
+void jl_mutex_lock(pthread_mutex_t *m)
+{
+    if (!gc_region) {
+        pthread_mutex_lock(m);
+        return;
+    }
+    if (pthread_mutex_trylock(m) != 0) {
+        jl_gc_safe_enter();
+        pthread_mutex_lock(m);
+        jl_gc_safe_leave();
+    }
+}
+
+// called before the n threads of a region are started
+void jl_gc_region_begin(int n)
+{
+    if (gc_thread_tasks == NULL) {
+        gc_thread_stacks = (jl_gcframe_t**)malloc(jl_nthreads()*sizeof(void*));
+        gc_thread_tasks = (jl_task_t**)malloc(jl_nthreads()*sizeof(void*));
+    }
+    memset(gc_thread_tasks, 0, jl_nthreads()*sizeof(void*));
+    gc_running = n;
+    gc_region = 1;
+}
+
+// called at the end of the region, with the other threads parked again
+void jl_gc_region_end(void)
+{
+    gc_region = 0;
+    run_finalizers();
+    if (allocd_bytes > collect_interval)
+        jl_gc_collect();
+}
+
+// stop the other threads of the region. returns 0, having waited for it,
+// if another thread is already collecting.
+static int gc_stop_world(void)
+{
+    if (!__sync_bool_compare_and_swap(&gc_stopping, 0, 1)) {
+        jl_gc_safepoint();
+        return 0;
+    }
+    while (gc_running > 1)
+        sched_yield();
+    return 1;
+}
+#else
+void jl_gc_safepoint(void)
+{
+}
+#endif
+
 void jl_gc_collect(void)
 {
+#ifdef JULIA_THREADS
+    int stopped = 0;
+    if (gc_region) {
+        if (!gc_stop_world())
+            return;
+        stopped = 1;
+    }
+    else if (jl_threads_running) {
+        // threads restoring the system image, with the gc disabled
+        allocd_bytes = 0;
+        return;
+    }
+#endif
     allocd_bytes = 0;
     if (is_gc_enabled) {
         freed_bytes = 0;
@@ -753,9 +964,15 @@ void jl_gc_collect(void)
         t0 = clock_now();
 #endif
         sweep_weak_refs();
+#ifndef COPY_STACKS
+        sweep_task_stacks();
+#endif
         gc_sweep();
 #ifdef GCTIME
         JL_PRINTF(JL_STDERR, "sweep time %.3f ms\n", (clock_now()-t0)*1000);
+#endif
+#ifdef JULIA_THREADS
+        if (!stopped)
 #endif
         run_finalizers();
         JL_SIGATOMIC_END();
@@ -777,6 +994,10 @@ void jl_gc_collect(void)
             collect_interval = default_collect_interval;
         }
     }
+#ifdef JULIA_THREADS
+    if (stopped)
+        gc_stopping = 0;
+#endif
 }
 
 void *allocb(size_t sz)
@@ -883,10 +1104,21 @@ void jl_gc_init(void)
         ephe_pools[i].freelist = NULL;
     }
 
+#ifdef JULIA_THREADS
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&jl_gc_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+#endif
+
     htable_new(&finalizer_table, 0);
     arraylist_new(&to_finalize, 0);
     arraylist_new(&preserved_values, 0);
     arraylist_new(&weak_refs, 0);
+#ifndef COPY_STACKS
+    arraylist_new(&task_stacks, 0);
+#endif
 
 #ifdef OBJPROFILE
     htable_new(&obj_counts, 0);
@@ -1300,6 +1300,31 @@ static void show_call(jl_value_t *F, jl_value_t **args, uint32_t nargs)
 }
 #endif
 
+static jl_function_t *method_lookup(jl_methtable_t *mt, jl_value_t **args,
+                                    size_t nargs)
+{
+    jl_function_t *mfunc = jl_method_table_assoc_exact(mt, args, nargs);
+    if (mfunc != jl_bottom_func) {
+        if (mfunc->linfo != NULL && 
+            (mfunc->linfo->inInference || mfunc->linfo->inCompile)) {
+            // if inference is running on this function, return a copy
+            // of the function to be compiled without inference and run.
+            jl_lambda_info_t *li = mfunc->linfo;
+            if (li->unspecialized == NULL) {
+                li->unspecialized = jl_instantiate_method(mfunc, li->sparams);
+            }
+            mfunc = li->unspecialized;
+        }
+    }
+    else {
+        jl_tuple_t *tt = arg_type_tuple(args, nargs);
+        JL_GC_PUSH(&tt);
+        mfunc = jl_mt_assoc_by_type(mt, tt, 1);
+        JL_GC_POP();
+    }
+    return mfunc;
+}
+
 JL_CALLABLE(jl_apply_generic)
 {
     jl_methtable_t *mt = jl_gf_mtable(F);
@@ -1320,25 +1345,15 @@ JL_CALLABLE(jl_apply_generic)
       if no generic match, use the concrete one even if inexact
       otherwise instantiate the generic method and use it
     */
-    jl_function_t *mfunc = jl_method_table_assoc_exact(mt, args, nargs);
-    if (mfunc != jl_bottom_func) {
-        if (mfunc->linfo != NULL && 
-            (mfunc->linfo->inInference || mfunc->linfo->inCompile)) {
-            // if inference is running on this function, return a copy
-            // of the function to be compiled without inference and run.
-            jl_lambda_info_t *li = mfunc->linfo;
-            if (li->unspecialized == NULL) {
-                li->unspecialized = jl_instantiate_method(mfunc, li->sparams);
-            }
-            mfunc = li->unspecialized;
-        }
-    }
-    else {
-        jl_tuple_t *tt = arg_type_tuple(args, nargs);
-        JL_GC_PUSH(&tt);
-        mfunc = jl_mt_assoc_by_type(mt, tt, 1);
-        JL_GC_POP();
+    jl_function_t *mfunc;
+#ifdef JULIA_THREADS
+    if (jl_threads_running) {
+        // method tables and the compiler are shared by all threads
+        JL_LOCKED(jl_codegen_lock, mfunc = method_lookup(mt, args, nargs));
     }
+    else
+#endif
+    mfunc = method_lookup(mt, args, nargs);
 
     if (mfunc == jl_bottom_func) {
 #ifdef JL_TRACE
@@ -1528,6 +1543,7 @@ void jl_add_method(jl_function_t *gf, jl_tuple_t *types, jl_function_t *meth,
     if (meth->linfo != NULL)
         meth->linfo->name = jl_gf_name(gf);
     (void)jl_method_table_insert(jl_gf_mtable(gf), types, meth, tvars);
+    jl_forget_cfunctions(gf);
 }
 
 DLLEXPORT jl_tuple_t *jl_match_method(jl_value_t *type, jl_value_t *sig,
@@ -45,6 +45,14 @@ void __cdecl __MINGW_NOTHROW fpreset (void);
 
 int jl_boot_file_loaded = 0;
 
+DLLEXPORT jl_compileropts_t jl_compileropts = { JL_OPT_LEVEL_UNSET, NULL };
+
+// the JIT optimization level in effect, for the workers this process starts
+DLLEXPORT int jl_opt_level(void)
+{
+    return jl_compileropts.opt_level;
+}
+
 char *jl_stack_lo;
 char *jl_stack_hi;
 size_t jl_page_size;
@@ -355,7 +363,7 @@ uv_loop_t *jl_io_loop;
 
 #ifdef COPY_STACKS
 void jl_switch_stack(jl_task_t *t, jl_jmp_buf *where);
-extern jl_jmp_buf * volatile jl_jmp_target;
+extern JL_THREAD jl_jmp_buf * volatile jl_jmp_target;
 #endif
 
 #ifdef __WIN32__
@@ -447,6 +455,8 @@ void julia_init(char *imageFile)
     jl_init_types();
     jl_init_tasks(jl_stack_lo, jl_stack_hi-jl_stack_lo);
     jl_init_codegen();
+    jl_init_threading();
+    jl_init_sched();
     jl_an_empty_cell = (jl_value_t*)jl_alloc_cell_1d(0);
 
     jl_init_serializer();
@@ -633,6 +643,7 @@ void jl_get_builtin_hooks(void)
 
     jl_float32_type = (jl_datatype_t*)core("Float32");
     jl_float64_type = (jl_datatype_t*)core("Float64");
+    jl_vec_typename = ((jl_datatype_t*)core("Vec"))->name;
 
     jl_stackovf_exception =
         jl_apply((jl_function_t*)core("StackOverflowError"), NULL, 0);
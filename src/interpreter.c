@@ -287,6 +287,10 @@ static jl_value_t *eval(jl_value_t *e, jl_value_t **locals, size_t nl)
         jl_lineno = jl_unbox_long(jl_exprarg(ex,0));
         return (jl_value_t*)jl_nothing;
     }
+    else if (ex->head == fastmath_sym || ex->head == inbounds_sym) {
+        // only affects compiled code
+        return (jl_value_t*)jl_nothing;
+    }
     else if (ex->head == module_sym) {
         return jl_eval_module_expr(ex);
     }
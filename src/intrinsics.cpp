@@ -6,6 +6,7 @@ namespace JL_I {
         neg_int, add_int, sub_int, mul_int,
         sdiv_int, udiv_int, srem_int, urem_int, smod_int,
         neg_float, add_float, sub_float, mul_float, div_float, rem_float,
+        fma_float, muladd_float,
         // same-type comparisons
         eq_int,  ne_int,
         slt_int, ult_int,
@@ -39,6 +40,8 @@ namespace JL_I {
         checked_smul, checked_umul,
         checked_fptoui, checked_fptosi,
         nan_dom_err,
+        // simd vectors
+        vecelt, vecsetelt, vecsplat, vecshuffle, vecbitmask,
         // c interface
         ccall, jl_alloca
     };
@@ -63,8 +66,11 @@ using namespace JL_I;
 // convert int type to same-size float type
 static Type *FT(Type *t)
 {
-    if (t->isFloatingPointTy())
+    if (t->isFPOrFPVectorTy())
         return t;
+    if (t->isVectorTy())
+        return VectorType::get(FT(t->getScalarType()),
+                               cast<VectorType>(t)->getNumElements());
     if (t == T_int32) return T_float32;
     assert(t == T_int64);
     return T_float64;
@@ -73,7 +79,7 @@ static Type *FT(Type *t)
 // reinterpret-cast to float
 static Value *FP(Value *v)
 {
-    if (v->getType()->isFloatingPointTy())
+    if (v->getType()->isFPOrFPVectorTy())
         return v;
     return builder.CreateBitCast(v, FT(v->getType()));
 }
@@ -81,10 +87,13 @@ static Value *FP(Value *v)
 // convert float type to same-size int type
 static Type *JL_INTT(Type *t)
 {
-    if (t->isIntegerTy())
+    if (t->isIntOrIntVectorTy())
         return t;
     if (t->isPointerTy())
         return T_size;
+    if (t->isVectorTy())
+        return VectorType::get(JL_INTT(t->getScalarType()),
+                               cast<VectorType>(t)->getNumElements());
     if (t == T_float32) return T_int32;
     assert(t == T_float64);
     return T_int64;
@@ -94,17 +103,35 @@ static Type *JL_INTT(Type *t)
 static Value *JL_INT(Value *v)
 {
     Type *t = v->getType();
-    if (t->isIntegerTy())
+    if (t->isIntOrIntVectorTy())
         return v;
     if (t->isPointerTy())
         return builder.CreatePtrToInt(v, JL_INTT(t));
     return builder.CreateBitCast(v, JL_INTT(t));
 }
 
+// inside a @fastmath block, allow LLVM to treat floating-point arithmetic
+// as associative and to ignore NaN, Inf and signed zeros
+static Value *math_flags(Value *v, jl_codectx_t *ctx)
+{
+#ifdef LLVM32
+    if (ctx->fastmath > 0 && isa<Instruction>(v)) {
+        FastMathFlags fmf;
+        fmf.setUnsafeAlgebra();
+        cast<Instruction>(v)->setFastMathFlags(fmf);
+    }
+#endif
+    return v;
+}
+
+static Value *emit_splat(Type *vt, Value *x);
+
 static Value *uint_cnvt(Type *to, Value *x)
 {
     Type *t = x->getType();
     if (t == to) return x;
+    if (to->isVectorTy() && !t->isVectorTy())
+        return emit_splat(to, uint_cnvt(to->getScalarType(), x));
     if (to->getPrimitiveSizeInBits() < x->getType()->getPrimitiveSizeInBits())
         return builder.CreateTrunc(x, to);
     return builder.CreateZExt(x, to);
@@ -181,7 +208,7 @@ static Value *emit_unbox(Type *to, Type *pto, Value *x)
         // empty struct - TODO - is this a good way to represent it?
         return UndefValue::get(to);
     }
-    return builder.CreateLoad(builder.CreateBitCast(p, pto), false);
+    return emit_elalign_load(builder.CreateBitCast(p, pto), tbaa_value);
 }
 
 // unbox trying to determine type automatically
@@ -499,6 +526,107 @@ static Value *emit_pointerset(jl_value_t *e, jl_value_t *x, jl_value_t *i, jl_co
     return mark_julia_type(thePtr, aty);
 }
 
+// --- simd vectors ---
+
+// broadcast scalar x into every element of vector type vt
+static Value *emit_splat(Type *vt, Value *x)
+{
+    unsigned n = cast<VectorType>(vt)->getNumElements();
+    Value *v = builder.CreateInsertElement(UndefValue::get(vt), x,
+                                           ConstantInt::get(T_int32, 0));
+    return builder.CreateShuffleVector(v, UndefValue::get(vt),
+                                       ConstantAggregateZero::get(VectorType::get(T_int32, n)));
+}
+
+// 1-based, bounds-checked element index into vector v
+static Value *emit_vec_index(Value *v, Value *i, jl_codectx_t *ctx)
+{
+    unsigned n = cast<VectorType>(v->getType())->getNumElements();
+    Value *im1 = emit_bounds_check(JL_INT(i), ConstantInt::get(T_size, n), ctx);
+    return builder.CreateTrunc(im1, T_int32);
+}
+
+static Value *emit_vec_element(Type *vt, Value *x, const char *fname)
+{
+    Type *et = vt->getScalarType();
+    if (x->getType() != et) {
+        if (x->getType()->getPrimitiveSizeInBits() != et->getPrimitiveSizeInBits())
+            jl_errorf("%s: element is of incorrect size", fname);
+        x = builder.CreateBitCast(x, et);
+    }
+    return x;
+}
+
+static Value *emit_vecsplat(jl_value_t *targ, jl_value_t *x, jl_codectx_t *ctx)
+{
+    Type *vt = staticeval_bitstype(targ, "vecsplat", ctx);
+    if (!vt->isVectorTy())
+        jl_error("vecsplat: expected Vec type as first argument");
+    return emit_splat(vt, emit_vec_element(vt, auto_unbox(x, ctx), "vecsplat"));
+}
+
+static Value *emit_vecsetelt(jl_value_t *v, jl_value_t *x, jl_value_t *i,
+                             jl_codectx_t *ctx)
+{
+    Value *vv = auto_unbox(v, ctx);
+    Type *vt = vv->getType();
+    if (!vt->isVectorTy())
+        jl_error("vecsetelt: expected vector as first argument");
+    Value *vx = emit_vec_element(vt, auto_unbox(x, ctx), "vecsetelt");
+    return builder.CreateInsertElement(vv, vx,
+                                       emit_vec_index(vv, auto_unbox(i, ctx), ctx));
+}
+
+// the mask is a constant tuple of 1-based indexes into the concatenation
+// of x and y, one per element of the result
+static Value *emit_vecshuffle(jl_value_t *x, jl_value_t *y, jl_value_t *mask,
+                              jl_codectx_t *ctx)
+{
+    Value *vx = auto_unbox(x, ctx);
+    Value *vy = auto_unbox(y, ctx);
+    Type *vt = vx->getType();
+    if (!vt->isVectorTy() || vy->getType() != vt)
+        jl_error("vecshuffle: expected two vectors of the same type");
+    size_t n = cast<VectorType>(vt)->getNumElements();
+    jl_value_t *m = static_eval(mask, ctx, true);
+    if (m == NULL || !jl_is_tuple(m) || jl_tuple_len(m) != n)
+        jl_errorf("vecshuffle: mask must be a constant tuple of %d indexes", (int)n);
+    std::vector<Constant*> idxs(0);
+    for(size_t i=0; i < n; i++) {
+        jl_value_t *e = jl_tupleref(m, i);
+        if (!jl_is_long(e) || jl_unbox_long(e) < 1 || (size_t)jl_unbox_long(e) > 2*n)
+            jl_error("vecshuffle: mask index out of range");
+        idxs.push_back(ConstantInt::get(T_int32, jl_unbox_long(e)-1));
+    }
+    return builder.CreateShuffleVector(vx, vy, ConstantVector::get(idxs));
+}
+
+// vector comparisons give all-ones or all-zeros in each element, like SSE
+static Value *vec_mask(Value *cmp, Type *t)
+{
+    if (!cmp->getType()->isVectorTy())
+        return cmp;
+    return builder.CreateSExt(cmp, JL_INTT(t));
+}
+
+static bool vector_intrinsic_ok(intrinsic f)
+{
+    switch (f) {
+    case neg_int: case add_int: case sub_int: case mul_int:
+    case neg_float: case add_float: case sub_float: case mul_float:
+    case div_float: case rem_float: case fma_float: case muladd_float:
+    case eq_int: case ne_int: case slt_int: case ult_int:
+    case sle_int: case ule_int:
+    case eq_float: case ne_float: case lt_float: case le_float:
+    case and_int: case or_int: case xor_int: case not_int:
+    case shl_int: case lshr_int: case ashr_int:
+    case vecelt: case vecbitmask:
+        return true;
+    default:
+        return false;
+    }
+}
+
 #define HANDLE(intr,n)                                                  \
     case intr: if (nargs!=n) jl_error(#intr": wrong number of arguments");
 
@@ -530,6 +658,9 @@ static Value *emit_intrinsic(intrinsic f, jl_value_t **args, size_t nargs,
         Value *x = FP(auto_unbox(args[2], ctx));
         return emit_checked_fptoui(args[1], x, ctx);
     }
+    HANDLE(vecsplat,2)    return emit_vecsplat(args[1], args[2], ctx);
+    HANDLE(vecsetelt,3)   return emit_vecsetelt(args[1], args[2], args[3], ctx);
+    HANDLE(vecshuffle,3)  return emit_vecshuffle(args[1], args[2], args[3], ctx);
     default: ;
     }
 
@@ -540,6 +671,8 @@ static Value *emit_intrinsic(intrinsic f, jl_value_t **args, size_t nargs,
         y = auto_unbox(args[2], ctx);
     }
     Type *t = x->getType();
+    if (t->isVectorTy() && !vector_intrinsic_ok(f))
+        jl_error("intrinsic: vector arguments not supported");
     Value *fy;
     Value *den;
     switch (f) {
@@ -566,12 +699,34 @@ static Value *emit_intrinsic(intrinsic f, jl_value_t **args, size_t nargs,
         x = JL_INT(x); y = JL_INT(y);
         return builder.CreateSRem(builder.CreateAdd(y,builder.CreateSRem(x,y)),y);
 
-    HANDLE(neg_float,1) return builder.CreateFMul(ConstantFP::get(FT(t), -1.0), FP(x));
-    HANDLE(add_float,2) return builder.CreateFAdd(FP(x), FP(y));
-    HANDLE(sub_float,2) return builder.CreateFSub(FP(x), FP(y));
-    HANDLE(mul_float,2) return builder.CreateFMul(FP(x), FP(y));
-    HANDLE(div_float,2) return builder.CreateFDiv(FP(x), FP(y));
-    HANDLE(rem_float,2) return builder.CreateFRem(FP(x), FP(y));
+    HANDLE(neg_float,1) return math_flags(builder.CreateFMul(ConstantFP::get(FT(t), -1.0), FP(x)), ctx);
+    HANDLE(add_float,2) return math_flags(builder.CreateFAdd(FP(x), FP(y)), ctx);
+    HANDLE(sub_float,2) return math_flags(builder.CreateFSub(FP(x), FP(y)), ctx);
+    HANDLE(mul_float,2) return math_flags(builder.CreateFMul(FP(x), FP(y)), ctx);
+    HANDLE(div_float,2) return math_flags(builder.CreateFDiv(FP(x), FP(y)), ctx);
+    HANDLE(rem_float,2) return math_flags(builder.CreateFRem(FP(x), FP(y)), ctx);
+    HANDLE(fma_float,3) {
+        // x*y+z with a single rounding; calls libm where there is no fma unit
+        x = FP(x);
+        return builder.CreateCall3(
+            Intrinsic::getDeclaration(jl_Module, Intrinsic::fma,
+                                      ArrayRef<Type*>(x->getType())),
+            x, FP(y), FP(auto_unbox(args[3], ctx)));
+    }
+    HANDLE(muladd_float,3) {
+        // x*y+z, fused only where that is faster
+        x = FP(x);
+        Value *z = FP(auto_unbox(args[3], ctx));
+#ifdef LLVM32
+        return builder.CreateCall3(
+            Intrinsic::getDeclaration(jl_Module, Intrinsic::fmuladd,
+                                      ArrayRef<Type*>(x->getType())),
+            x, FP(y), z);
+#else
+        return math_flags(builder.CreateFAdd(
+                   math_flags(builder.CreateFMul(x, FP(y)), ctx), z), ctx);
+#endif
+    }
 
     HANDLE(checked_sadd,2)
     HANDLE(checked_uadd,2)
@@ -601,17 +756,17 @@ static Value *emit_intrinsic(intrinsic f, jl_value_t **args, size_t nargs,
         return builder.CreateExtractValue(res, ArrayRef<unsigned>(0));
     }
 
-    HANDLE(eq_int,2)  return builder.CreateICmpEQ(JL_INT(x), JL_INT(y));
-    HANDLE(ne_int,2)  return builder.CreateICmpNE(JL_INT(x), JL_INT(y));
-    HANDLE(slt_int,2) return builder.CreateICmpSLT(JL_INT(x), JL_INT(y));
-    HANDLE(ult_int,2) return builder.CreateICmpULT(JL_INT(x), JL_INT(y));
-    HANDLE(sle_int,2) return builder.CreateICmpSLE(JL_INT(x), JL_INT(y));
-    HANDLE(ule_int,2) return builder.CreateICmpULE(JL_INT(x), JL_INT(y));
+    HANDLE(eq_int,2)  return vec_mask(builder.CreateICmpEQ(JL_INT(x), JL_INT(y)), t);
+    HANDLE(ne_int,2)  return vec_mask(builder.CreateICmpNE(JL_INT(x), JL_INT(y)), t);
+    HANDLE(slt_int,2) return vec_mask(builder.CreateICmpSLT(JL_INT(x), JL_INT(y)), t);
+    HANDLE(ult_int,2) return vec_mask(builder.CreateICmpULT(JL_INT(x), JL_INT(y)), t);
+    HANDLE(sle_int,2) return vec_mask(builder.CreateICmpSLE(JL_INT(x), JL_INT(y)), t);
+    HANDLE(ule_int,2) return vec_mask(builder.CreateICmpULE(JL_INT(x), JL_INT(y)), t);
 
-    HANDLE(eq_float,2) return builder.CreateFCmpOEQ(FP(x), FP(y));
-    HANDLE(ne_float,2) return builder.CreateFCmpUNE(FP(x), FP(y));
-    HANDLE(lt_float,2) return builder.CreateFCmpOLT(FP(x), FP(y));
-    HANDLE(le_float,2) return builder.CreateFCmpOLE(FP(x), FP(y));
+    HANDLE(eq_float,2) return vec_mask(builder.CreateFCmpOEQ(FP(x), FP(y)), t);
+    HANDLE(ne_float,2) return vec_mask(builder.CreateFCmpUNE(FP(x), FP(y)), t);
+    HANDLE(lt_float,2) return vec_mask(builder.CreateFCmpOLT(FP(x), FP(y)), t);
+    HANDLE(le_float,2) return vec_mask(builder.CreateFCmpOLE(FP(x), FP(y)), t);
 
     HANDLE(eqfsi64,2) return emit_eqfsi64(x, y);
     HANDLE(eqfui64,2) return emit_eqfui64(x, y);
@@ -944,9 +1099,15 @@ static Value *emit_intrinsic(intrinsic f, jl_value_t **args, size_t nargs,
         // understood that everything is implicitly rounded to 23 bits,
         // but if we start looking at more bits we need to actually do the
         // rounding first instead of carrying around incorrect low bits.
+#ifdef JULIA_THREADS
+        // threaded builds target SSE2, where float32 values are never
+        // carried in extended precision; the shared temporary would race
+        return builder.CreateFPExt(FP(x), T_float64);
+#else
         builder.CreateStore(FP(x), jlfloat32temp_var, true);
         return builder.CreateFPExt(builder.CreateLoad(jlfloat32temp_var, true),
                                    T_float64);
+#endif
 
     HANDLE(nan_dom_err,2) {
         // nan_dom_err(f, x) throw DomainError if isnan(f)&&!isnan(x)
@@ -1005,6 +1166,23 @@ static Value *emit_intrinsic(intrinsic f, jl_value_t **args, size_t nargs,
         Value *tmp = builder.CreateAShr(fy, ConstantInt::get(intt,((IntegerType*)intt)->getBitWidth()-1));
         return builder.CreateXor(builder.CreateAdd(x,tmp),tmp);
     }
+    HANDLE(vecelt,2) {
+        if (!t->isVectorTy())
+            jl_error("vecelt: expected vector as first argument");
+        return builder.CreateExtractElement(x, emit_vec_index(x, y, ctx));
+    }
+    HANDLE(vecbitmask,1) {
+        // the sign bit of each element, as an integer with element 1 lowest
+        if (!t->isVectorTy())
+            jl_error("vecbitmask: expected vector argument");
+        unsigned n = cast<VectorType>(t)->getNumElements();
+        if (n > 64)
+            jl_error("vecbitmask: vector has too many elements");
+        x = JL_INT(x);
+        Value *bits = builder.CreateICmpSLT(x, ConstantInt::get(x->getType(), 0));
+        bits = builder.CreateBitCast(bits, IntegerType::get(jl_LLVMContext, n));
+        return builder.CreateZExt(bits, T_int64);
+    }
     HANDLE(jl_alloca,1) {
         return builder.CreateAlloca(IntegerType::get(jl_LLVMContext, 8),JL_INT(x));
     }
@@ -1066,6 +1244,7 @@ extern "C" void jl_init_intrinsic_functions(void)
     ADD_I(smod_int);
     ADD_I(neg_float); ADD_I(add_float); ADD_I(sub_float); ADD_I(mul_float);
     ADD_I(div_float); ADD_I(rem_float);
+    ADD_I(fma_float); ADD_I(muladd_float);
     ADD_I(eq_int); ADD_I(ne_int);
     ADD_I(slt_int); ADD_I(ult_int);
     ADD_I(sle_int); ADD_I(ule_int);
@@ -1095,6 +1274,8 @@ extern "C" void jl_init_intrinsic_functions(void)
     ADD_I(checked_smul); ADD_I(checked_umul);
     ADD_I(checked_fptosi); ADD_I(checked_fptoui);
     ADD_I(nan_dom_err);
+    ADD_I(vecelt); ADD_I(vecsetelt); ADD_I(vecsplat); ADD_I(vecshuffle);
+    ADD_I(vecbitmask);
     ADD_I(ccall);
     ADD_I(jl_alloca);
 }
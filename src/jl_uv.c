@@ -36,6 +36,7 @@ extern "C" {
 	XX(connectcb) \
 	XX(connectioncb) \
 	XX(asynccb) \
+	XX(writecb) \
     XX(getaddrinfo)
 //TODO add UDP and other missing callbacks
 
@@ -110,6 +111,82 @@ jl_value_t *jl_callback_call(jl_function_t *f,jl_value_t *val,int count,...)
     return v;
 }
 
+// hooks called through C-callable entry points (see jl_function_ptr),
+// compiled for each type of julia object a handle can belong to, so that
+// the arguments are passed unboxed. a hook that can't be compiled this way
+// for a type (or a hook with too many types) goes through jl_callback_call.
+#define JL_UV_THUNKS 8
+typedef struct {
+    jl_value_t *type;   // NULL marks an unused slot
+    void *fptr;         // NULL if jl_callback_call has to be used
+} jl_uv_thunk_t;
+
+#define JULIA_THUNK(hook) jl_uvthunk_##hook
+#define XX(hook) static jl_uv_thunk_t JULIA_THUNK(hook)[JL_UV_THUNKS];
+XX(return_spawn)
+XX(readcb)
+XX(connectcb)
+XX(connectioncb)
+XX(asynccb)
+#undef XX
+
+// jl_cfunction_age when the caches were last emptied. a method added to a
+// hook can change which code it runs for a type.
+static size_t thunks_age = 0;
+
+static void jl_uv_forget_thunks(void)
+{
+#define XX(hook) memset(JULIA_THUNK(hook), 0, sizeof(JULIA_THUNK(hook)));
+    XX(return_spawn)
+    XX(readcb)
+    XX(connectcb)
+    XX(connectioncb)
+    XX(asynccb)
+#undef XX
+    thunks_age = jl_cfunction_age;
+}
+
+// the entry point of hook for data, returning nothing and taking data and
+// then n more arguments of the given types. the callback can drop the handle's
+// reference to data, so callers keep data rooted across the call, as
+// jl_callback_call does.
+static void *jl_uv_thunk(jl_uv_thunk_t *cache, jl_function_t *hook, jl_value_t *data, size_t n, ...)
+{
+    if (base_module_conflict || hook == NULL || data == NULL)
+        return NULL;
+    if (thunks_age != jl_cfunction_age)
+        jl_uv_forget_thunks();
+    jl_value_t *t = (jl_value_t*)jl_typeof(data);
+    int i;
+    for(i=0; i < JL_UV_THUNKS && cache[i].type != NULL; i++) {
+        if (cache[i].type == t)
+            return cache[i].fptr;
+    }
+    if (i == JL_UV_THUNKS)
+        return NULL;
+    jl_tuple_t *argt = jl_alloc_tuple(n+1);
+    JL_GC_PUSH(&argt);
+    jl_tupleset(argt, 0, t);
+    va_list argp;
+    va_start(argp, n);
+    size_t j;
+    for(j=1; j <= n; j++)
+        jl_tupleset(argt, j, va_arg(argp, jl_value_t*));
+    va_end(argp);
+    void *fptr;
+    JL_TRY {
+        fptr = jl_function_ptr(hook, (jl_value_t*)jl_nothing->type, (jl_value_t*)argt);
+    }
+    JL_CATCH {
+        fptr = NULL;
+    }
+    JL_GC_POP();
+    // if fptr was found, jl_function_ptr keeps t alive
+    cache[i].type = t;
+    cache[i].fptr = fptr;
+    return fptr;
+}
+
 void closeHandle(uv_handle_t* handle)
 {
     JULIA_CB(close,handle->data,0); (void)ret;
@@ -119,12 +196,32 @@ void closeHandle(uv_handle_t* handle)
 
 void jl_return_spawn(uv_process_t *p, int exit_status, int term_signal)
 {
+    void (*fptr)(jl_value_t*,int32_t,int32_t) = (void(*)(jl_value_t*,int32_t,int32_t))
+        jl_uv_thunk(JULIA_THUNK(return_spawn), JULIA_HOOK(return_spawn), (jl_value_t*)p->data,
+                    2, jl_int32_type, jl_int32_type);
+    if (fptr) {
+        jl_value_t *data = (jl_value_t*)p->data;
+        JL_GC_PUSH(&data);
+        fptr(data, exit_status, term_signal);
+        JL_GC_POP();
+        return;
+    }
     JULIA_CB(return_spawn,p->data,2,CB_INT32,exit_status,CB_INT32,term_signal);
     (void)ret;
 }
 
 void jl_readcb(uv_stream_t *handle, ssize_t nread, uv_buf_t buf)
 {
+    void (*fptr)(jl_value_t*,ssize_t,void*,int32_t) = (void(*)(jl_value_t*,ssize_t,void*,int32_t))
+        jl_uv_thunk(JULIA_THUNK(readcb), JULIA_HOOK(readcb), (jl_value_t*)handle->data,
+                    3, jl_long_type, jl_voidpointer_type, jl_int32_type);
+    if (fptr) {
+        jl_value_t *data = (jl_value_t*)handle->data;
+        JL_GC_PUSH(&data);
+        fptr(data, nread, buf.base, buf.len);
+        JL_GC_POP();
+        return;
+    }
     JULIA_CB(readcb,handle->data,3,CB_INT,nread,CB_PTR,(buf.base),CB_INT32,buf.len);
     (void)ret;
 }
@@ -143,12 +240,32 @@ uv_buf_t jl_alloc_buf(uv_handle_t *handle, size_t suggested_size)
 
 void jl_connectcb(uv_connect_t *connect, int status)
 {
+    void (*fptr)(jl_value_t*,int32_t) = (void(*)(jl_value_t*,int32_t))
+        jl_uv_thunk(JULIA_THUNK(connectcb), JULIA_HOOK(connectcb), (jl_value_t*)connect->handle->data,
+                    1, jl_int32_type);
+    if (fptr) {
+        jl_value_t *data = (jl_value_t*)connect->handle->data;
+        JL_GC_PUSH(&data);
+        fptr(data, status);
+        JL_GC_POP();
+        return;
+    }
     JULIA_CB(connectcb,connect->handle->data,1,CB_INT32,status);
     (void)ret;
 }
 
 void jl_connectioncb(uv_stream_t *stream, int status)
 {
+    void (*fptr)(jl_value_t*,int32_t) = (void(*)(jl_value_t*,int32_t))
+        jl_uv_thunk(JULIA_THUNK(connectioncb), JULIA_HOOK(connectioncb), (jl_value_t*)stream->data,
+                    1, jl_int32_type);
+    if (fptr) {
+        jl_value_t *data = (jl_value_t*)stream->data;
+        JL_GC_PUSH(&data);
+        fptr(data, status);
+        JL_GC_POP();
+        return;
+    }
     JULIA_CB(connectioncb,stream->data,1,CB_INT32,status);
     (void)ret;
 }
@@ -161,6 +278,16 @@ void jl_getaddrinfocb(uv_getaddrinfo_t *req,int status, struct addrinfo *addr)
 
 void jl_asynccb(uv_handle_t *handle, int status)
 {
+    void (*fptr)(jl_value_t*,int32_t) = (void(*)(jl_value_t*,int32_t))
+        jl_uv_thunk(JULIA_THUNK(asynccb), JULIA_HOOK(asynccb), (jl_value_t*)handle->data,
+                    1, jl_int32_type);
+    if (fptr) {
+        jl_value_t *data = (jl_value_t*)handle->data;
+        JL_GC_PUSH(&data);
+        fptr(data, status);
+        JL_GC_POP();
+        return;
+    }
     JULIA_CB(asynccb,handle->data,1,CB_INT32,status);
     (void)ret;
 }
@@ -459,6 +586,72 @@ DLLEXPORT size_t jl_write(uv_stream_t *stream, const char *str, size_t n)
     }
 }
 
+// writes straight from the memory of julia arrays (write_arrays in
+// stream.jl). the julia request object holding the arrays stays in
+// jl_write_roots until the write completes, and is then passed to
+// _uv_hook_writecb with the status.
+jl_array_t *jl_write_roots = NULL;
+
+typedef struct {
+    uv_write_t uvw;
+    size_t root;  // index of the request in jl_write_roots
+} jl_write_req_t;
+
+static size_t jl_root_write_req(jl_value_t *req)
+{
+    size_t i, n;
+    if (jl_write_roots == NULL)
+        jl_write_roots = jl_alloc_cell_1d(16);
+    n = jl_array_len(jl_write_roots);
+    for(i=0; i < n; i++) {
+        if (jl_cellref(jl_write_roots, i) == NULL)
+            break;
+    }
+    if (i == n) {
+        jl_array_grow_end(jl_write_roots, n);
+        memset(&jl_cellref(jl_write_roots, n), 0, n*sizeof(void*));
+    }
+    jl_cellset(jl_write_roots, i, req);
+    return i;
+}
+
+static void jl_write_arrays_cb(uv_write_t *uvw, int status)
+{
+    jl_write_req_t *w = (jl_write_req_t*)uvw;
+    jl_value_t *req = jl_cellref(jl_write_roots, w->root);
+    jl_cellset(jl_write_roots, w->root, NULL);
+    free(w);
+    JL_GC_PUSH(&req);
+    JULIA_CB(writecb,req,1,CB_INT32,status);
+    (void)ret;
+    JL_GC_POP();
+}
+
+// write bytes [ranges[2i], ranges[2i]+ranges[2i+1]) of each array bufs[i],
+// in order, in one vectored write
+DLLEXPORT int jl_write_arrays(uv_stream_t *stream, jl_value_t *req, jl_array_t *bufs,
+                              size_t *ranges)
+{
+    size_t i, n = jl_array_len(bufs);
+    uv_buf_t *uvbufs = (uv_buf_t*)malloc(n*sizeof(uv_buf_t));
+    for(i=0; i < n; i++) {
+        jl_array_t *a = (jl_array_t*)jl_cellref(bufs, i);
+        uvbufs[i].base = (char*)jl_array_data(a) + ranges[2*i];
+        uvbufs[i].len = ranges[2*i+1];
+    }
+    jl_write_req_t *w = (jl_write_req_t*)malloc(sizeof(jl_write_req_t));
+    w->root = jl_root_write_req(req);
+    JL_SIGATOMIC_BEGIN();
+    int err = uv_write(&w->uvw, stream, uvbufs, n, &jl_write_arrays_cb);
+    JL_SIGATOMIC_END();
+    free(uvbufs);  // uv_write keeps its own copy
+    if (err) {
+        jl_cellset(jl_write_roots, w->root, NULL);
+        free(w);
+    }
+    return err;
+}
+
 extern int vasprintf(char **str, const char *fmt, va_list ap);
 
 int jl_vprintf(uv_stream_t *s, const char *format, va_list args)
@@ -534,6 +727,13 @@ DLLEXPORT int jl_getpid()
 #endif
 }
 
+DLLEXPORT size_t jl_resident_memory(void)
+{
+    size_t rss = 0;
+    uv_resident_set_memory(&rss);
+    return rss;
+}
+
 //NOTE: This function expects port/host to be in network byte-order (Big Endian)
 DLLEXPORT int jl_tcp_bind(uv_tcp_t* handle, uint16_t port, uint32_t host)
 {
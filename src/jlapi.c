@@ -51,7 +51,7 @@ DLLEXPORT void jl_init(char *julia_home_dir)
 
 #ifdef COPY_STACKS
 void jl_switch_stack(jl_task_t *t, jl_jmp_buf *where);
-extern jl_jmp_buf * volatile jl_jmp_target;
+extern JL_THREAD jl_jmp_buf * volatile jl_jmp_target;
 #endif
 
 DLLEXPORT void *jl_eval_string(char *str)
@@ -1533,7 +1533,7 @@ static void cache_type_(jl_value_t *type)
     }
 }
 
-jl_value_t *jl_cache_type_(jl_datatype_t *type)
+static jl_value_t *cache_type_locked(jl_datatype_t *type)
 {
     jl_value_t *t = lookup_type(type->name, type->parameters->data,
                                 jl_tuple_len(type->parameters));
@@ -1542,6 +1542,21 @@ jl_value_t *jl_cache_type_(jl_datatype_t *type)
     return (jl_value_t*)type;
 }
 
+// the type caches are shared by all threads, so inside a threaded region
+// they are looked up and added to under jl_codegen_lock, as jl_symbol does
+// with the symbol table
+jl_value_t *jl_cache_type_(jl_datatype_t *type)
+{
+#ifdef JULIA_THREADS
+    if (jl_threads_running) {
+        jl_value_t *t;
+        JL_LOCKED(jl_codegen_lock, t = cache_type_locked(type));
+        return t;
+    }
+#endif
+    return cache_type_locked(type);
+}
+
 JL_CALLABLE(jl_f_tuple);
 JL_CALLABLE(jl_f_ctor_trampoline);
 
@@ -1721,6 +1736,13 @@ static jl_value_t *inst_type_w_(jl_value_t *t, jl_value_t **env, size_t n,
 
 jl_value_t *jl_instantiate_type_with(jl_value_t *t, jl_value_t **env, size_t n)
 {
+#ifdef JULIA_THREADS
+    if (jl_threads_running) {
+        jl_value_t *r;
+        JL_LOCKED(jl_codegen_lock, r = inst_type_w_((jl_value_t*)t, env, n, NULL));
+        return r;
+    }
+#endif
     return inst_type_w_((jl_value_t*)t, env, n, NULL);
 }
 
@@ -2685,6 +2707,8 @@ void jl_init_types(void)
     enter_sym = jl_symbol("enter");
     leave_sym = jl_symbol("leave");
     static_typeof_sym = jl_symbol("static_typeof");
+    fastmath_sym = jl_symbol("fastmath");
+    inbounds_sym = jl_symbol("inbounds");
     new_sym = jl_symbol("new");
     const_sym = jl_symbol("const");
     global_sym = jl_symbol("global");
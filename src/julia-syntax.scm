@@ -1677,6 +1677,10 @@
 	   (cons (to-blk (to-lff '(null) dest tail))
 		 (list e)))
 
+	  ((fastmath inbounds)
+	   (cons (to-blk (to-lff '(null) dest tail))
+		 (list e)))
+
 	  ((|::|)
 	   (if dest
 	       ;; convert to typeassert or decl based on whether it's in
@@ -28,6 +28,15 @@
 #define NORETURN
 #endif
 
+// with USE_THREADS=1 the state of the running task (current task, gc frame
+// stack, exception in transit) is kept per OS thread
+#ifdef JULIA_THREADS
+#include <pthread.h>
+#define JL_THREAD __thread
+#else
+#define JL_THREAD
+#endif
+
 #ifdef _P64
 // a risky way to save 8 bytes per tuple
 //#define OVERLAP_TUPLE_LEN
@@ -386,6 +395,7 @@ extern jl_datatype_t *jl_float32_type;
 extern jl_datatype_t *jl_float64_type;
 extern jl_datatype_t *jl_voidpointer_type;
 extern jl_datatype_t *jl_pointer_type;
+extern jl_typename_t *jl_vec_typename;
 
 extern jl_value_t *jl_array_uint8_type;
 extern jl_value_t *jl_array_any_type;
@@ -409,7 +419,6 @@ extern jl_value_t *jl_true;
 extern jl_value_t *jl_false;
 DLLEXPORT extern jl_value_t *jl_nothing;
 
-extern jl_function_t *jl_unprotect_stack_func;
 extern jl_function_t *jl_bottom_func;
 
 extern uv_lib_t *jl_dl_handle;
@@ -441,7 +450,8 @@ extern jl_sym_t *null_sym;    extern jl_sym_t *body_sym;
 extern jl_sym_t *macro_sym;   extern jl_sym_t *method_sym;
 extern jl_sym_t *enter_sym;   extern jl_sym_t *leave_sym;
 extern jl_sym_t *exc_sym;     extern jl_sym_t *new_sym;
-extern jl_sym_t *static_typeof_sym;
+extern jl_sym_t *static_typeof_sym; extern jl_sym_t *fastmath_sym;
+extern jl_sym_t *inbounds_sym;
 extern jl_sym_t *const_sym;   extern jl_sym_t *thunk_sym;
 extern jl_sym_t *anonymous_sym;  extern jl_sym_t *underscore_sym;
 extern jl_sym_t *abstracttype_sym; extern jl_sym_t *bitstype_sym;
@@ -608,6 +618,14 @@ static inline int jl_is_cpointer_type(void *t)
             ((jl_datatype_t*)(t))->name == jl_pointer_type->name);
 }
 
+// bits types declared as subtypes of Vec{N,T}, represented as SIMD vectors
+static inline int jl_is_vec_type(void *t)
+{
+    return (jl_vec_typename != NULL && jl_is_bitstype(t) &&
+            ((jl_datatype_t*)(t))->super != NULL &&
+            ((jl_datatype_t*)(t))->super->name == jl_vec_typename);
+}
+
 static inline int jl_is_vararg_type(jl_value_t *v)
 {
     return (jl_is_datatype(v) &&
@@ -871,6 +889,12 @@ void jl_init_serializer(void);
 
 void jl_save_system_image(char *fname);
 void jl_restore_system_image(char *fname);
+DLLEXPORT jl_value_t *jl_save_module(jl_module_t *m);
+DLLEXPORT jl_value_t *jl_restore_module(jl_array_t *data);
+DLLEXPORT size_t jl_serialize_wire(jl_array_t *buf, size_t pos, jl_value_t *v,
+                                   jl_array_t *ht, jl_value_t *direct);
+DLLEXPORT jl_value_t *jl_deserialize_wire(jl_array_t *buf, size_t *ppos, size_t end,
+                                          jl_array_t *tags);
 
 // front end interface
 DLLEXPORT jl_value_t *jl_parse_input_line(const char *str);
@@ -940,8 +964,26 @@ DLLEXPORT void jl_runEventLoop();
 DLLEXPORT void jl_processEvents();
 
 // compiler
+typedef struct {
+    int8_t opt_level;       // 0-3, see JL_OPT_LEVEL_*; -1 means not set
+    char *cpu_target;       // LLVM cpu name, or "native" for the host
+} jl_compileropts_t;
+
+#define JL_OPT_LEVEL_UNSET   -1
+#define JL_OPT_LEVEL_DEFAULT  2
+#define JL_OPT_LEVEL_MAX      3
+
+extern DLLEXPORT jl_compileropts_t jl_compileropts;
+DLLEXPORT int jl_opt_level(void);
+
 void jl_compile(jl_function_t *f);
 void jl_generate_fptr(jl_function_t *f);
+DLLEXPORT void *jl_function_ptr(jl_function_t *f, jl_value_t *rt, jl_value_t *argt);
+void jl_forget_cfunctions(jl_function_t *f);
+extern size_t jl_cfunction_age;
+extern jl_array_t *jl_cfunction_roots;
+extern jl_array_t *jl_write_roots;
+extern jl_array_t *jl_wire_plain_types;
 DLLEXPORT jl_value_t *jl_toplevel_eval(jl_value_t *v);
 jl_value_t *jl_eval_global_var(jl_module_t *m, jl_sym_t *e);
 DLLEXPORT void jl_load(const char *fname);
@@ -978,6 +1020,7 @@ jl_value_t *jl_prepare_ast(jl_lambda_info_t *li, jl_tuple_t *sparams);
 
 jl_value_t *jl_compress_ast(jl_lambda_info_t *li, jl_value_t *ast);
 jl_value_t *jl_uncompress_ast(jl_lambda_info_t *li, jl_value_t *data);
+extern jl_array_t *jl_ast_cache;
 
 static inline int jl_vinfo_capt(jl_array_t *vi)
 {
@@ -1031,7 +1074,7 @@ typedef struct _jl_gcframe_t {
 // jl_value_t *x=NULL, *y=NULL; JL_GC_PUSH(&x, &y);
 // x = f(); y = g(); foo(x, y)
 
-extern DLLEXPORT jl_gcframe_t *jl_pgcstack;
+extern DLLEXPORT JL_THREAD jl_gcframe_t *jl_pgcstack;
 
 #define JL_GC_PUSH(...)                                                   \
   void *__gc_stkf[] = {(void*)((VA_NARG(__VA_ARGS__)<<1)|1), jl_pgcstack, \
@@ -1054,6 +1097,7 @@ DLLEXPORT int jl_gc_is_enabled(void);
 void jl_gc_ephemeral_on(void);
 void jl_gc_ephemeral_off(void);
 DLLEXPORT void jl_gc_collect(void);
+void jl_gc_safepoint(void);
 void jl_gc_preserve(jl_value_t *v);
 void jl_gc_unpreserve(void);
 int jl_gc_n_preserved_values(void);
@@ -1123,10 +1167,14 @@ typedef struct _jl_task_t {
         void *stackbase;
         void *stack;
     };
+    // only used with COPY_STACKS, but always here: code built without the
+    // flag (ui/) must agree on where the fields below are
     jl_jmp_buf base_ctx;
     size_t bufsz;
     void *stkbuf;
     size_t ssize;
+    // saved stack pointer of a task switched away from by jl_swap_ctx
+    void *sp;
     jl_function_t *start;
     // current exception handler
     jl_handler_t *eh;
@@ -1142,11 +1190,16 @@ typedef union jl_any_stream {
 DLLEXPORT void jl_uv_associate_julia_struct(uv_handle_t *handle, jl_value_t *data);
 DLLEXPORT int jl_uv_fs_result(uv_fs_t *f);
 
-extern DLLEXPORT jl_task_t * volatile jl_current_task;
-extern DLLEXPORT jl_task_t *jl_root_task;
-extern DLLEXPORT jl_value_t *jl_exception_in_transit;
+extern DLLEXPORT JL_THREAD jl_task_t * volatile jl_current_task;
+extern DLLEXPORT JL_THREAD jl_task_t *jl_root_task;
+extern DLLEXPORT JL_THREAD jl_value_t *jl_exception_in_transit;
 
 jl_task_t *jl_new_task(jl_function_t *start, size_t ssize);
+jl_task_t *jl_new_root_task(void *stack, size_t ssize);
+#ifndef COPY_STACKS
+void jl_free_task_stack(jl_task_t *t);
+void jl_gc_add_task_stack(jl_task_t *t);
+#endif
 jl_value_t *jl_switchto(jl_task_t *t, jl_value_t *arg);
 DLLEXPORT void NORETURN jl_throw(jl_value_t *e);
 DLLEXPORT void NORETURN jl_throw_with_superfluous_argument(jl_value_t *e, int);
@@ -1161,6 +1214,13 @@ DLLEXPORT void jl_free2(void *p, void *hint);
 
 DLLEXPORT int jl_cpu_cores(void);
 
+// x86 instruction set extensions relevant to code generation
+enum JL_CPU_FEATURE {
+    JL_CPU_SSE3=1U, JL_CPU_SSSE3=2U, JL_CPU_SSE41=4U, JL_CPU_SSE42=8U,
+    JL_CPU_POPCNT=16U, JL_CPU_AVX=32U, JL_CPU_AVX2=64U, JL_CPU_FMA=128U
+};
+DLLEXPORT uint32_t jl_cpu_features(void);
+
 DLLEXPORT size_t jl_write(uv_stream_t *stream, const char *str, size_t n);
 DLLEXPORT int jl_printf(uv_stream_t *s, const char *format, ...);
 DLLEXPORT int jl_vprintf(uv_stream_t *s, const char *format, va_list args);
@@ -1223,6 +1283,46 @@ __declspec(noreturn) __attribute__ ((__nothrow__)) void jl_longjmp(jmp_buf _Buf,
 
 #define JL_EH_POP() jl_eh_restore_state(&__eh)
 
+// threads
+DLLEXPORT int jl_nthreads(void);
+DLLEXPORT int16_t jl_threadid(void);
+DLLEXPORT void jl_threading_run(jl_function_t *f);
+void jl_init_threading(void);
+
+// run queues
+extern jl_array_t *jl_sched_roots;
+DLLEXPORT void jl_enq_work(jl_value_t *w, int front);
+DLLEXPORT void jl_enq_io_work(jl_value_t *w);
+DLLEXPORT jl_value_t *jl_deq_work(void);
+DLLEXPORT size_t jl_work_length(void);
+DLLEXPORT void jl_threading_spawn(jl_function_t *f);
+DLLEXPORT int jl_threading_help(void);
+size_t jl_threading_pending(void);
+void jl_init_sched(void);
+
+#ifdef JULIA_THREADS
+extern DLLEXPORT volatile int jl_threads_running;
+extern pthread_mutex_t jl_codegen_lock;
+extern jl_array_t *jl_thread_roots;
+int jl_start_thread(pthread_t *t, void *(*fun)(void*), void *arg);
+void jl_gc_safe_enter(void);
+void jl_gc_safe_leave(void);
+void jl_mutex_lock(pthread_mutex_t *m);
+void jl_gc_region_begin(int n);
+void jl_gc_region_end(void);
+DLLEXPORT jl_gcframe_t **jl_pgcstack_addr(void);
+DLLEXPORT jl_value_t **jl_exception_in_transit_addr(void);
+
+// run stmt holding the (recursive) lock m, releasing it if stmt throws
+#define JL_LOCKED(m, stmt)                                      \
+    do {                                                        \
+        jl_mutex_lock(&(m));                                    \
+        JL_TRY { stmt; }                                        \
+        JL_CATCH { pthread_mutex_unlock(&(m)); jl_rethrow(); }  \
+        pthread_mutex_unlock(&(m));                             \
+    } while (0)
+#endif
+
 #ifdef __WIN32__
 #define JL_CATCH                                                \
     else                                                        \
@@ -0,0 +1,205 @@
+/*
+  sched.c
+  run queues
+
+  . a deque is a growable ring buffer of values. its owner pushes and pops
+    at the front; other threads steal from the back.
+  . the task scheduler (perform_work in multi.jl) takes work from the run
+    queue, and from a separate FIFO of tasks woken by I/O (tasknotify).
+    woken tasks go ahead of queued compute work, but at most JL_IO_BURST in
+    a row, so that neither side can starve the other.
+  . inside a threaded region, jl_threading_spawn queues a closure on the
+    calling thread's deque. jl_threading_help runs one: the newest on this
+    thread's deque if any, otherwise the oldest on another thread's.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "julia.h"
+
+typedef struct {
+    int root;           // index of the buffer in jl_sched_roots
+    size_t head;        // index of the front item
+    // read without the lock to skip empty deques, so it must be reloaded
+    volatile size_t len;
+#ifdef JULIA_THREADS
+    pthread_mutex_t lock;
+#endif
+} jl_deque_t;
+
+// buffers of all deques, so that queued values are marked
+jl_array_t *jl_sched_roots = NULL;
+
+#ifdef JULIA_THREADS
+#define DEQUE_LOCK(q)   pthread_mutex_lock(&(q)->lock)
+#define DEQUE_UNLOCK(q) pthread_mutex_unlock(&(q)->lock)
+#else
+#define DEQUE_LOCK(q)
+#define DEQUE_UNLOCK(q)
+#endif
+
+#define DEQUE_INIT_SIZE 32
+#define deque_buf(q) ((jl_array_t*)jl_cellref(jl_sched_roots, (q)->root))
+
+static jl_deque_t *new_deque(int root)
+{
+    jl_deque_t *q = (jl_deque_t*)malloc(sizeof(jl_deque_t));
+    q->root = root;
+    q->head = 0;
+    q->len = 0;
+#ifdef JULIA_THREADS
+    pthread_mutex_init(&q->lock, NULL);
+#endif
+    jl_cellset(jl_sched_roots, root, jl_alloc_cell_1d(DEQUE_INIT_SIZE));
+    return q;
+}
+
+static void deque_push(jl_deque_t *q, jl_value_t *v, int front)
+{
+    jl_array_t *nb = NULL;
+    JL_GC_PUSH(&v, &nb);
+    DEQUE_LOCK(q);
+    jl_array_t *buf = deque_buf(q);
+    size_t n = jl_array_len(buf);
+    while (q->len == n) {
+        // allocate without the lock: allocating can stop this thread for a
+        // collection, which would wait for a thread blocked on the lock.
+        // the deque may change meanwhile, so check again after.
+        DEQUE_UNLOCK(q);
+        nb = jl_alloc_cell_1d(2*n);
+        DEQUE_LOCK(q);
+        buf = deque_buf(q);
+        if (q->len == n && jl_array_len(buf) == n) {
+            for(size_t i=0; i < n; i++)
+                jl_cellset(nb, i, jl_cellref(buf, (q->head+i)&(n-1)));
+            jl_cellset(jl_sched_roots, q->root, nb);
+            buf = nb;
+            q->head = 0;
+        }
+        n = jl_array_len(buf);
+    }
+    size_t i;
+    if (front) {
+        q->head = (q->head+n-1)&(n-1);
+        i = q->head;
+    }
+    else {
+        i = (q->head+q->len)&(n-1);
+    }
+    jl_cellset(buf, i, v);
+    q->len++;
+    DEQUE_UNLOCK(q);
+    JL_GC_POP();
+}
+
+// returns NULL if q is empty
+static jl_value_t *deque_pop(jl_deque_t *q, int front)
+{
+    if (q->len == 0)
+        return NULL;
+    DEQUE_LOCK(q);
+    if (q->len == 0) {
+        DEQUE_UNLOCK(q);
+        return NULL;
+    }
+    jl_array_t *buf = deque_buf(q);
+    size_t n = jl_array_len(buf);
+    size_t i;
+    if (front) {
+        i = q->head;
+        q->head = (q->head+1)&(n-1);
+    }
+    else {
+        i = (q->head+q->len-1)&(n-1);
+    }
+    jl_value_t *v = jl_cellref(buf, i);
+    jl_cellset(buf, i, NULL);
+    q->len--;
+    DEQUE_UNLOCK(q);
+    return v;
+}
+
+// task scheduler
+
+#define JL_IO_BURST 4
+
+static jl_deque_t *runq;
+static jl_deque_t *ioq;
+static int io_run = 0;  // woken tasks taken in a row
+
+// front: run w next (work first), otherwise after everything queued
+DLLEXPORT void jl_enq_work(jl_value_t *w, int front)
+{
+    deque_push(runq, w, front);
+}
+
+DLLEXPORT void jl_enq_io_work(jl_value_t *w)
+{
+    deque_push(ioq, w, 0);
+}
+
+// the next WorkItem (or Task) to run, or nothing
+DLLEXPORT jl_value_t *jl_deq_work(void)
+{
+    jl_value_t *w;
+    if (io_run < JL_IO_BURST || runq->len == 0) {
+        w = deque_pop(ioq, 1);
+        if (w != NULL) {
+            io_run++;
+            return w;
+        }
+    }
+    io_run = 0;
+    w = deque_pop(runq, 1);
+    return w == NULL ? (jl_value_t*)jl_nothing : w;
+}
+
+DLLEXPORT size_t jl_work_length(void)
+{
+    return runq->len + ioq->len;
+}
+
+// fork-join work
+
+static jl_deque_t **spawnq;
+
+DLLEXPORT void jl_threading_spawn(jl_function_t *f)
+{
+    deque_push(spawnq[jl_threadid()], (jl_value_t*)f, 1);
+}
+
+// run one spawned closure. returns 0 if there was nothing to run.
+DLLEXPORT int jl_threading_help(void)
+{
+    // threads waiting for work call this in a loop that doesn't allocate
+    jl_gc_safepoint();
+    int n = jl_nthreads();
+    int tid = jl_threadid();
+    jl_value_t *f = deque_pop(spawnq[tid], 1);
+    for(int i=1; f == NULL && i < n; i++)
+        f = deque_pop(spawnq[(tid+i)%n], 0);
+    if (f == NULL)
+        return 0;
+    JL_GC_PUSH(&f);
+    jl_apply((jl_function_t*)f, NULL, 0);
+    JL_GC_POP();
+    return 1;
+}
+
+size_t jl_threading_pending(void)
+{
+    size_t n = 0;
+    for(int i=0; i < jl_nthreads(); i++)
+        n += spawnq[i]->len;
+    return n;
+}
+
+void jl_init_sched(void)
+{
+    int n = jl_nthreads();
+    jl_sched_roots = jl_alloc_cell_1d(n+2);
+    runq = new_deque(0);
+    ioq = new_deque(1);
+    spawnq = (jl_deque_t**)malloc(n*sizeof(jl_deque_t*));
+    for(int i=0; i < n; i++)
+        spawnq[i] = new_deque(i+2);
+}
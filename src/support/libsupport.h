@@ -28,6 +28,7 @@
 #include "utf8.h"
 #include "ios.h"
 #include "timefuncs.h"
+#include "lz.h"
 #include "hashing.h"
 #include "ptrhash.h"
 #include "bitvector.h"
@@ -0,0 +1,157 @@
+/*
+  lz: a fast block compressor, in the format of LZ4 blocks
+
+  . the data is a series of sequences: a token byte, whose high 4 bits
+    are the number of literals and low 4 bits the match length minus 4,
+    then more length bytes if a field is 15 (each adding up to 255), the
+    literals, and a 2-byte little-endian offset back to the match, and
+    more length bytes for the match. the last sequence has literals only.
+  . matches are found greedily through a hash table of the last position
+    where each 4 bytes were seen. runs without matches are skipped over
+    faster the longer they get, so data that doesn't compress costs little.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "dtypes.h"
+#include "lz.h"
+
+#define LZ_HASH_LOG      12
+#define LZ_MIN_MATCH     4
+#define LZ_MAX_OFFSET    65535
+#define LZ_LAST_LITERALS 5   // the data ends with at least this many literals
+#define LZ_MF_LIMIT      12  // and no match starts in the last this many bytes
+
+static uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761U) >> (32-LZ_HASH_LOG);
+}
+
+size_t lz_bound(size_t n)
+{
+    return n + n/255 + 16;
+}
+
+static uint8_t *write_length(uint8_t *op, size_t n)
+{
+    while (n >= 255) {
+        *op++ = 255;
+        n -= 255;
+    }
+    *op++ = (uint8_t)n;
+    return op;
+}
+
+static uint8_t *write_literals(uint8_t *op, uint8_t *token, const uint8_t *p, size_t n)
+{
+    *token = (n >= 15 ? 15 : n) << 4;
+    if (n >= 15)
+        op = write_length(op, n-15);
+    memcpy(op, p, n);
+    return op + n;
+}
+
+size_t lz_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap)
+{
+    if (cap < lz_bound(n))
+        return 0;
+    uint32_t table[1<<LZ_HASH_LOG];
+    memset(table, 0, sizeof(table));
+    const uint8_t *ip = src, *anchor = src, *end = src+n;
+    uint8_t *op = dst;
+    if (n > LZ_MF_LIMIT) {
+        const uint8_t *mflimit = end - LZ_MF_LIMIT;
+        const uint8_t *matchlimit = end - LZ_LAST_LITERALS;
+        while (ip < mflimit) {
+            uint32_t seq = read32(ip);
+            uint32_t h = lz_hash(seq);
+            const uint8_t *ref = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+            if (ref >= ip || ip - ref > LZ_MAX_OFFSET || read32(ref) != seq) {
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--; ref--;
+            }
+            const uint8_t *mp = ip + LZ_MIN_MATCH, *rp = ref + LZ_MIN_MATCH;
+            while (mp < matchlimit && *mp == *rp) {
+                mp++; rp++;
+            }
+            uint8_t *token = op++;
+            op = write_literals(op, token, anchor, ip - anchor);
+            size_t offs = ip - ref;
+            *op++ = offs & 0xff;
+            *op++ = offs >> 8;
+            size_t mlen = mp - ip - LZ_MIN_MATCH;
+            *token |= mlen >= 15 ? 15 : mlen;
+            if (mlen >= 15)
+                op = write_length(op, mlen-15);
+            ip = anchor = mp;
+            table[lz_hash(read32(ip-2))] = (uint32_t)(ip - 2 - src);
+        }
+    }
+    uint8_t *token = op++;
+    op = write_literals(op, token, anchor, end - anchor);
+    size_t clen = op - dst;
+    return clen < n ? clen : 0;
+}
+
+int lz_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t rawlen)
+{
+    const uint8_t *ip = src, *iend = src+n;
+    uint8_t *op = dst, *oend = dst+rawlen;
+    while (ip < iend) {
+        unsigned token = *ip++;
+        size_t len = token >> 4;
+        if (len == 15) {
+            unsigned b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                len += b;
+            } while (b == 255);
+        }
+        if ((size_t)(iend - ip) < len || (size_t)(oend - op) < len)
+            return -1;
+        memcpy(op, ip, len);
+        ip += len;
+        op += len;
+        if (ip == iend)
+            break;
+        if (iend - ip < 2)
+            return -1;
+        size_t offs = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offs == 0 || offs > (size_t)(op - dst))
+            return -1;
+        len = token & 15;
+        if (len == 15) {
+            unsigned b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                len += b;
+            } while (b == 255);
+        }
+        len += LZ_MIN_MATCH;
+        if ((size_t)(oend - op) < len)
+            return -1;
+        const uint8_t *ref = op - offs;
+        if (offs >= len) {
+            memcpy(op, ref, len);
+            op += len;
+        }
+        else {
+            while (len-- > 0)
+                *op++ = *ref++;
+        }
+    }
+    return op == oend ? 0 : -1;
+}
@@ -0,0 +1,14 @@
+#ifndef LZ_H
+#define LZ_H
+
+// the most lz_compress can write for n bytes of input
+DLLEXPORT size_t lz_bound(size_t n);
+// compress n bytes of src into dst, which has room for cap bytes. returns
+// the compressed length, or 0 if the data doesn't get smaller or cap is
+// less than lz_bound(n).
+DLLEXPORT size_t lz_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap);
+// decompress n bytes of src, which must give exactly rawlen bytes, into dst.
+// returns 0, or -1 if the data is corrupt.
+DLLEXPORT int lz_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t rawlen);
+
+#endif
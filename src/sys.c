@@ -409,7 +409,7 @@ JL_STREAM *jl_stdin_stream(void)  { return (JL_STREAM*) JL_STDIN; }
 JL_STREAM *jl_stdout_stream(void) { return (JL_STREAM*) JL_STDOUT; }
 JL_STREAM *jl_stderr_stream(void) { return (JL_STREAM*) JL_STDERR; }
 
-// -- set/clear the FZ/DAZ flags on x86 & x86-64 --
+// -- cpu feature detection and FZ/DAZ flags on x86 & x86-64 --
 
 #ifdef __SSE__
 
@@ -438,6 +438,68 @@ void cpuid(int32_t CPUInfo[4], int32_t InfoType)
 
 #endif
 
+static void cpuid_ex(int32_t CPUInfo[4], int32_t InfoType, int32_t SubLeaf)
+{
+#ifdef _WIN32
+    __cpuidex(CPUInfo, InfoType, SubLeaf);
+#else
+    __asm__ __volatile__ (
+        #if defined(__i386__) && defined(__PIC__)
+        "xchg %%ebx, %%esi;"
+        "cpuid;"
+        "xchg %%esi, %%ebx;":
+        "=S" (CPUInfo[1]) ,
+        #else
+        "cpuid":
+        "=b" (CPUInfo[1]),
+        #endif
+        "=a" (CPUInfo[0]),
+        "=c" (CPUInfo[2]),
+        "=d" (CPUInfo[3]) :
+        "a" (InfoType),
+        "c" (SubLeaf)
+    );
+#endif
+}
+
+// whether the OS saves the xmm and ymm registers on context switch,
+// without which the AVX instructions are unusable even if present
+static int os_saves_ymm(void)
+{
+    uint32_t eax, edx;
+    // xgetbv with ecx=0 reads XCR0; encoded by hand for old assemblers
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" :
+                          "=a" (eax), "=d" (edx) : "c" (0));
+    return (eax & 6) == 6;
+}
+
+DLLEXPORT uint32_t jl_cpu_features(void)
+{
+    uint32_t features = 0;
+    int32_t info[4];
+
+    cpuid(info, 0);
+    int32_t maxleaf = info[0];
+    if (maxleaf < 1)
+        return 0;
+    cpuid(info, 0x00000001);
+    if (info[2] & (1 << 0))  features |= JL_CPU_SSE3;
+    if (info[2] & (1 << 9))  features |= JL_CPU_SSSE3;
+    if (info[2] & (1 << 19)) features |= JL_CPU_SSE41;
+    if (info[2] & (1 << 20)) features |= JL_CPU_SSE42;
+    if (info[2] & (1 << 23)) features |= JL_CPU_POPCNT;
+    // AVX and FMA need OSXSAVE (bit 27) and OS support for the ymm state
+    if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && os_saves_ymm()) {
+        features |= JL_CPU_AVX;
+        if (info[2] & (1 << 12)) features |= JL_CPU_FMA;
+        if (maxleaf >= 7) {
+            cpuid_ex(info, 0x00000007, 0);
+            if (info[1] & (1 << 5)) features |= JL_CPU_AVX2;
+        }
+    }
+    return features;
+}
+
 DLLEXPORT uint8_t jl_zero_denormals(uint8_t isZero)
 {
     uint32_t flags = 0x00000000;
@@ -470,6 +532,11 @@ DLLEXPORT uint8_t jl_zero_denormals(uint8_t isZero)
 
 #else
 
+DLLEXPORT uint32_t jl_cpu_features(void)
+{
+    return 0;
+}
+
 DLLEXPORT uint8_t jl_zero_denormals(uint8_t isZero)
 {
     return 0;
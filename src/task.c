@@ -5,7 +5,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
-//#include <sys/mman.h>
 #include <signal.h>
 #include <libgen.h>
 #include <unistd.h>
@@ -21,6 +20,9 @@
 #include <libunwind.h>
 #include <dlfcn.h>   // for dladdr
 #endif
+#ifndef COPY_STACKS
+#include <sys/mman.h>
+#endif
 
 /* This probing code is derived from Douglas Jones' user thread library */
 
@@ -129,19 +131,19 @@ static void _probe_arch(void)
 
 extern size_t jl_page_size;
 jl_datatype_t *jl_task_type;
-DLLEXPORT jl_task_t * volatile jl_current_task;
-jl_task_t *jl_root_task;
-jl_value_t * volatile jl_task_arg_in_transit;
-static volatile int n_args_in_transit;
-jl_value_t *jl_exception_in_transit;
+DLLEXPORT JL_THREAD jl_task_t * volatile jl_current_task;
+JL_THREAD jl_task_t *jl_root_task;
+JL_THREAD jl_value_t * volatile jl_task_arg_in_transit;
+static JL_THREAD volatile int n_args_in_transit;
+JL_THREAD jl_value_t *jl_exception_in_transit;
 #ifdef JL_GC_MARKSWEEP
-jl_gcframe_t *jl_pgcstack = NULL;
+JL_THREAD jl_gcframe_t *jl_pgcstack = NULL;
 #endif
 
 static void start_task(jl_task_t *t);
 
 #ifdef COPY_STACKS
-jl_jmp_buf * volatile jl_jmp_target;
+JL_THREAD jl_jmp_buf * volatile jl_jmp_target;
 
 static void save_stack(jl_task_t *t)
 {
@@ -198,6 +200,143 @@ void jl_switch_stack(jl_task_t *t, jl_jmp_buf *where)
 }
 #endif
 
+#ifndef COPY_STACKS
+
+#if defined(__x86_64__) && !defined(__WIN32__)
+#define ASM_CTX
+/*
+  jl_swap_ctx(&from->sp, to->sp) saves the callee-saved registers and the
+  floating point control words on the current stack, stores the stack
+  pointer in from->sp, and restores the same from to->sp. everything else
+  is saved by the caller anyway, so this is all a switch between two
+  suspended calls needs.
+*/
+void jl_swap_ctx(void **from_sp, void *to_sp);
+#ifdef __APPLE__
+#define ASM_SYM(s) "_" #s
+#else
+#define ASM_SYM(s) #s
+#endif
+__asm__(".text\n"
+        ".globl " ASM_SYM(jl_swap_ctx) "\n"
+        ASM_SYM(jl_swap_ctx) ":\n"
+        "    pushq %rbp\n"
+        "    pushq %rbx\n"
+        "    pushq %r12\n"
+        "    pushq %r13\n"
+        "    pushq %r14\n"
+        "    pushq %r15\n"
+        "    subq $8, %rsp\n"
+        "    stmxcsr (%rsp)\n"
+        "    fnstcw 4(%rsp)\n"
+        "    movq %rsp, (%rdi)\n"
+        "    movq %rsi, %rsp\n"
+        "    ldmxcsr (%rsp)\n"
+        "    fldcw 4(%rsp)\n"
+        "    addq $8, %rsp\n"
+        "    popq %r15\n"
+        "    popq %r14\n"
+        "    popq %r13\n"
+        "    popq %r12\n"
+        "    popq %rbx\n"
+        "    popq %rbp\n"
+        "    ret\n");
+#endif
+
+/*
+  a task gets its stack the first time it is switched to, so a task that
+  has not started is just its object. stacks are mmap'd with a guard page
+  below them, and only the pages a task touches are committed. they are
+  kept for reuse in power-of-two size classes from MIN_POOL_STACK up.
+  a stack goes back to the pool when its task finishes, or when the gc
+  finds the task unreachable (see sweep_task_stacks in gc.c).
+*/
+#define MIN_POOL_STACK   (64*1024)
+#define N_STACK_CLASSES  8
+#define STACK_POOL_SIZE  16
+
+static JL_THREAD void *stack_pool[N_STACK_CLASSES][STACK_POOL_SIZE];
+static JL_THREAD int stack_pool_n[N_STACK_CLASSES];
+
+static int stack_class(size_t ssize)
+{
+    int c = 0;
+    while (c < N_STACK_CLASSES && (MIN_POOL_STACK<<c) < ssize)
+        c++;
+    return c;
+}
+
+// returns the lowest usable address; *ssize is rounded up to the size class
+static void *alloc_stack(size_t *ssize)
+{
+    size_t pagesz = jl_page_size;
+    int c = stack_class(*ssize);
+    if (c < N_STACK_CLASSES) {
+        *ssize = MIN_POOL_STACK<<c;
+        if (stack_pool_n[c] > 0)
+            return stack_pool[c][--stack_pool_n[c]];
+    }
+    else {
+        *ssize = LLT_ALIGN(*ssize, pagesz);
+    }
+    char *stk = (char*)mmap(NULL, *ssize+pagesz, PROT_READ|PROT_WRITE,
+                            MAP_PRIVATE|MAP_ANON|MAP_NORESERVE, -1, 0);
+    if (stk == MAP_FAILED)
+        jl_throw(jl_memory_exception);
+    // add a guard page to detect stack overflow
+    if (mprotect(stk, pagesz, PROT_NONE) == -1)
+        jl_errorf("mprotect: %s", strerror(errno));
+    return stk+pagesz;
+}
+
+static void free_stack(void *stk, size_t ssize)
+{
+    int c = stack_class(ssize);
+    if (c < N_STACK_CLASSES && stack_pool_n[c] < STACK_POOL_SIZE) {
+        stack_pool[c][stack_pool_n[c]++] = stk;
+        return;
+    }
+    munmap((char*)stk-jl_page_size, ssize+jl_page_size);
+}
+
+void jl_free_task_stack(jl_task_t *t)
+{
+    free_stack(t->stack, t->ssize);
+    t->stkbuf = NULL;
+}
+
+// a finished task no longer needs its stack
+static void release_stack(jl_task_t *t)
+{
+    if (t->done && t->stkbuf != NULL)
+        jl_free_task_stack(t);
+}
+
+static void init_task(jl_task_t *t);
+
+static void start_stack(jl_task_t *t)
+{
+    t->stack = alloc_stack(&t->ssize);
+    t->stkbuf = (char*)t->stack - jl_page_size;
+    jl_gc_add_task_stack(t);
+    init_task(t);
+}
+
+#endif /* !COPY_STACKS */
+
+static void set_current_task(jl_task_t *t)
+{
+#ifdef JL_GC_MARKSWEEP
+    jl_current_task->gcstack = jl_pgcstack;
+    jl_pgcstack = t->gcstack;
+#endif
+    t->last = jl_current_task;
+    // by default, exit to first task to switch to this one
+    if (t->on_exit == NULL)
+        t->on_exit = jl_current_task;
+    jl_current_task = t;
+}
+
 static void ctx_switch(jl_task_t *t, jl_jmp_buf *where)
 {
     if (t == jl_current_task)
@@ -215,6 +354,16 @@ static void ctx_switch(jl_task_t *t, jl_jmp_buf *where)
       *IF AND ONLY IF* throwing the exception involved a task switch.
     */
     //JL_SIGATOMIC_BEGIN();
+#ifdef ASM_CTX
+    if (where == &t->ctx) {
+        jl_task_t *lastt = jl_current_task;
+        set_current_task(t);
+        jl_swap_ctx(&lastt->sp, t->sp);
+        // resumed by whoever switched back to lastt
+        release_stack(jl_current_task->last);
+        return;
+    }
+#endif
     if (!jl_setjmp(jl_current_task->ctx, 0)) {
 #ifdef COPY_STACKS
         jl_task_t *lastt = jl_current_task;
@@ -222,15 +371,7 @@ static void ctx_switch(jl_task_t *t, jl_jmp_buf *where)
 #endif
 
         // set up global state for new task
-#ifdef JL_GC_MARKSWEEP
-        jl_current_task->gcstack = jl_pgcstack;
-        jl_pgcstack = t->gcstack;
-#endif
-        t->last = jl_current_task;
-        // by default, exit to first task to switch to this one
-        if (t->on_exit == NULL)
-            t->on_exit = jl_current_task;
-        jl_current_task = t;
+        set_current_task(t);
 
 #ifdef COPY_STACKS
         jl_jmp_target = where;
@@ -244,17 +385,26 @@ static void ctx_switch(jl_task_t *t, jl_jmp_buf *where)
 
 static jl_value_t *switchto(jl_task_t *t)
 {
+#ifdef JULIA_THREADS
+    // the other threads run on stacks this task does not own
+    if (jl_threads_running)
+        jl_error("task switch not allowed inside a threaded region");
+#endif
     if (t->done) {
         jl_task_arg_in_transit = (jl_value_t*)jl_null;
         return t->result;
     }
+#ifndef COPY_STACKS
+    if (t->stkbuf == NULL && t->start != NULL)
+        start_stack(t);
+#endif
     ctx_switch(t, &t->ctx);
     jl_value_t *val = jl_task_arg_in_transit;
     jl_task_arg_in_transit = (jl_value_t*)jl_null;
     return val;
 }
 
-#ifndef COPY_STACKS
+#if !defined(COPY_STACKS) && !defined(ASM_CTX)
 
 #ifdef __linux__
 #if defined(__i386__)
@@ -333,7 +483,7 @@ static void rebase_state(jl_jmp_buf *ctx, intptr_t local_sp, intptr_t new_sp)
 #endif
 }
 
-#endif /* !COPY_STACKS */
+#endif /* !COPY_STACKS && !ASM_CTX */
 
 jl_value_t *jl_switchto(jl_task_t *t, jl_value_t *arg)
 {
@@ -359,6 +509,9 @@ static void start_task(jl_task_t *t)
     jl_value_t *arg = jl_task_arg_in_transit;
     jl_value_t *res;
     JL_GC_PUSH(&arg);
+#ifndef COPY_STACKS
+    release_stack(t->last);
+#endif
 
 #ifdef COPY_STACKS
     ptrint_t local_sp = (ptrint_t)jl_pgcstack;
@@ -393,7 +546,26 @@ static void start_task(jl_task_t *t)
     assert(0);
 }
 
-#ifndef COPY_STACKS
+#ifdef ASM_CTX
+static void task_entry(void)
+{
+    start_task(jl_current_task);
+}
+
+static void init_task(jl_task_t *t)
+{
+    // a frame for jl_swap_ctx to pop, returning into task_entry
+    void **sp = (void**)((char*)t->stack + t->ssize);
+    *--sp = NULL;  // return address of task_entry, ends backtraces
+    *--sp = (void*)&task_entry;
+    for(int i=0; i < 6; i++)
+        *--sp = NULL;
+    sp--;
+    ((uint32_t*)sp)[0] = 0x1f80;  // default mxcsr
+    ((uint32_t*)sp)[1] = 0x037f;  // default x87 control word
+    t->sp = sp;
+}
+#elif !defined(COPY_STACKS)
 static void init_task(jl_task_t *t)
 {
     if (jl_setjmp(t->ctx, 0)) {
@@ -414,8 +586,8 @@ static void init_task(jl_task_t *t)
 
 #define MAX_BT_SIZE 80000
 
-static ptrint_t bt_data[MAX_BT_SIZE+1];
-static size_t bt_size = 0;
+static JL_THREAD ptrint_t bt_data[MAX_BT_SIZE+1];
+static JL_THREAD size_t bt_size = 0;
 
 void getFunctionInfo(const char **name, int *line, const char **filename, size_t pointer);
 
@@ -656,36 +828,14 @@ jl_task_t *jl_new_task(jl_function_t *start, size_t ssize)
 #ifdef COPY_STACKS
     t->bufsz = 0;
 #else
-    JL_GC_PUSH(&t);
-
-    char *stk = allocb(ssize+pagesz+(pagesz-1));
-    t->stkbuf = stk;
-    stk = (char*)LLT_ALIGN((uptrint_t)stk, pagesz);
-    // add a guard page to detect stack overflow
-    // the GC might read this area, which is ok, just prevent writes
-    if (mprotect(stk, pagesz-1, PROT_READ) == -1)
-        jl_errorf("mprotect: %s", strerror(errno));
-    t->stack = stk+pagesz;
-
-    init_task(t);
-    JL_GC_POP();
-    jl_gc_add_finalizer((jl_value_t*)t, jl_unprotect_stack_func);
+    // allocated when first switched to
+    t->stack = NULL;
+    t->sp = NULL;
 #endif
 
     return t;
 }
 
-JL_CALLABLE(jl_unprotect_stack)
-{
-#ifndef COPY_STACKS
-    jl_task_t *t = (jl_task_t*)args[0];
-    char *stk = t->stack-jl_page_size;
-    // unprotect stack so it can be reallocated for something else
-    mprotect(stk, jl_page_size-1, PROT_READ|PROT_WRITE|PROT_EXEC);
-#endif
-    return (jl_value_t*)jl_null;
-}
-
 #define JL_MIN_STACK     (4096*sizeof(void*))
 #define JL_DEFAULT_STACK (2*12288*sizeof(void*))
 
@@ -729,7 +879,34 @@ DLLEXPORT jl_value_t *jl_get_current_task(void)
     return (jl_value_t*)jl_current_task;
 }
 
-jl_function_t *jl_unprotect_stack_func;
+// the task a thread starts out running, on the given stack
+jl_task_t *jl_new_root_task(void *stack, size_t ssize)
+{
+    jl_task_t *t = (jl_task_t*)allocobj(sizeof(jl_task_t));
+    t->type = (jl_value_t*)jl_task_type;
+#ifdef COPY_STACKS
+    t->stackbase = stack+ssize;
+    t->ssize = 0;  // size of saved piece
+    t->bufsz = 0;
+#else
+    t->stack = stack;
+    t->ssize = ssize;
+#endif
+    t->stkbuf = NULL;
+    t->on_exit = t;
+    t->last = t;
+    t->tls = NULL;
+    t->consumers = NULL;
+    t->done = 0;
+    t->runnable = 1;
+    t->start = NULL;
+    t->result = NULL;
+    t->eh = NULL;
+#ifdef JL_GC_MARKSWEEP
+    t->gcstack = NULL;
+#endif
+    return t;
+}
 
 void jl_init_tasks(void *stack, size_t ssize)
 {
@@ -754,33 +931,9 @@ void jl_init_tasks(void *stack, size_t ssize)
     jl_tupleset(jl_task_type->types, 0, (jl_value_t*)jl_task_type);
     jl_task_type->fptr = jl_f_task;
 
-    jl_current_task = (jl_task_t*)allocobj(sizeof(jl_task_t));
-    jl_current_task->type = (jl_value_t*)jl_task_type;
-#ifdef COPY_STACKS
-    jl_current_task->stackbase = stack+ssize;
-    jl_current_task->ssize = 0;  // size of saved piece
-    jl_current_task->bufsz = 0;
-#else
-    jl_current_task->stack = stack;
-    jl_current_task->ssize = ssize;
-#endif
-    jl_current_task->stkbuf = NULL;
-    jl_current_task->on_exit = jl_current_task;
-    jl_current_task->last = jl_current_task;
-    jl_current_task->tls = NULL;
-    jl_current_task->consumers = NULL;
-    jl_current_task->done = 0;
-    jl_current_task->runnable = 1;
-    jl_current_task->start = NULL;
-    jl_current_task->result = NULL;
-    jl_current_task->eh = NULL;
-#ifdef JL_GC_MARKSWEEP
-    jl_current_task->gcstack = NULL;
-#endif
-
+    jl_current_task = jl_new_root_task(stack, ssize);
     jl_root_task = jl_current_task;
 
     jl_exception_in_transit = (jl_value_t*)jl_null;
     jl_task_arg_in_transit = (jl_value_t*)jl_null;
-    jl_unprotect_stack_func = jl_new_closure(jl_unprotect_stack, (jl_value_t*)jl_null, NULL);
 }
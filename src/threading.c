@@ -0,0 +1,236 @@
+/*
+  threading.c
+  shared-memory threads running Julia code
+
+  . jl_nthreads() OS threads, the first of which is the one julia started
+    on. the others are created on first use and then sleep until given work.
+  . every thread has its own root task, gc frame stack and exception in
+    transit (see JL_THREAD in julia.h).
+  . jl_threading_run(f) calls f(tid) on every thread and waits for all of
+    them. while it runs, allocation is serialized by the gc lock, and method
+    lookup, compilation and the type cache by jl_codegen_lock. a collection
+    stops every thread at its next allocation (see gc.c); finalizers run at
+    the end of the region.
+  . tasks can't be switched inside a threaded region. finer-grained
+    parallelism comes from jl_threading_spawn (see sched.c): a thread that
+    has finished its own call steals spawned work until all threads are done.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "julia.h"
+
+extern JL_THREAD jl_value_t * volatile jl_task_arg_in_transit;
+
+static int n_threads = 1;
+static JL_THREAD int16_t thread_id = 0;
+
+DLLEXPORT int jl_nthreads(void) { return n_threads; }
+DLLEXPORT int16_t jl_threadid(void) { return thread_id; }
+
+#ifdef JULIA_THREADS
+
+DLLEXPORT volatile int jl_threads_running = 0;
+pthread_mutex_t jl_codegen_lock;
+// root task of each thread in [0,n), exception it threw in [n,2n)
+jl_array_t *jl_thread_roots = NULL;
+
+DLLEXPORT jl_gcframe_t **jl_pgcstack_addr(void)
+{
+    return &jl_pgcstack;
+}
+
+DLLEXPORT jl_value_t **jl_exception_in_transit_addr(void)
+{
+    return &jl_exception_in_transit;
+}
+
+#define JL_THREAD_STACK (8*1024*1024)
+
+static pthread_t *threads = NULL;
+static pthread_mutex_t work_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static jl_function_t *work_fun = NULL;
+static unsigned long work_gen = 0;  // number of regions started
+static int n_working = 0;
+static volatile int n_busy = 0;  // threads still in their call to work_fun
+
+static void record_exception(int16_t tid)
+{
+    if (jl_cellref(jl_thread_roots, n_threads+tid) == (jl_value_t*)jl_null)
+        jl_cellset(jl_thread_roots, n_threads+tid, jl_exception_in_transit);
+    jl_exception_in_transit = (jl_value_t*)jl_null;
+}
+
+// help the threads still running by taking the work they spawned
+static void steal_work(int16_t tid)
+{
+    JL_TRY {
+        while (n_busy > 0 || jl_threading_pending() > 0) {
+            if (!jl_threading_help())
+                sched_yield();
+        }
+    }
+    JL_CATCH {
+        record_exception(tid);
+    }
+}
+
+static void run_work(int16_t tid)
+{
+    jl_value_t *arg = NULL;
+    JL_GC_PUSH(&arg);
+    JL_TRY {
+        arg = jl_box_long(tid+1);
+        jl_apply(work_fun, &arg, 1);
+    }
+    JL_CATCH {
+        record_exception(tid);
+    }
+    JL_GC_POP();
+    __sync_fetch_and_sub(&n_busy, 1);
+    steal_work(tid);
+}
+
+static void *thread_main(void *arg)
+{
+    int16_t tid = (int16_t)(intptr_t)arg;
+    thread_id = tid;
+    jl_current_task = (jl_task_t*)jl_cellref(jl_thread_roots, tid);
+    jl_root_task = jl_current_task;
+    jl_exception_in_transit = (jl_value_t*)jl_null;
+    jl_task_arg_in_transit = (jl_value_t*)jl_null;
+
+    unsigned long seen = 0;
+    pthread_mutex_lock(&work_lock);
+    while (1) {
+        while (work_gen == seen)
+            pthread_cond_wait(&work_cond, &work_lock);
+        seen = work_gen;
+        pthread_mutex_unlock(&work_lock);
+
+        run_work(tid);
+        // parked until the next region
+        jl_gc_safe_enter();
+
+        pthread_mutex_lock(&work_lock);
+        if (--n_working == 0)
+            pthread_cond_signal(&done_cond);
+    }
+    return NULL;
+}
+
+// deserializing and compiling recurse deeply, so threads running Julia
+// code get the stack size of the main thread, not the system's default
+int jl_start_thread(pthread_t *t, void *(*fun)(void*), void *arg)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, JL_THREAD_STACK);
+    int err = pthread_create(t, &attr, fun, arg);
+    pthread_attr_destroy(&attr);
+    return err;
+}
+
+static void start_threads(void)
+{
+    jl_thread_roots = jl_alloc_cell_1d(2*n_threads);
+    jl_cellset(jl_thread_roots, 0, jl_root_task);
+    for(int i=1; i < n_threads; i++)
+        jl_cellset(jl_thread_roots, i, jl_new_root_task(NULL, 0));
+    for(int i=0; i < n_threads; i++)
+        jl_cellset(jl_thread_roots, n_threads+i, jl_null);
+
+    threads = (pthread_t*)malloc(n_threads*sizeof(pthread_t));
+    threads[0] = pthread_self();
+    for(int i=1; i < n_threads; i++) {
+        int err = jl_start_thread(&threads[i], thread_main, (void*)(intptr_t)i);
+        if (err != 0)
+            jl_errorf("could not start thread %d: %s", i, strerror(err));
+        pthread_detach(threads[i]);
+    }
+}
+
+DLLEXPORT void jl_threading_run(jl_function_t *f)
+{
+    jl_value_t *arg = NULL;
+    JL_GC_PUSH(&f, &arg);
+    if (jl_threads_running || n_threads == 1) {
+        // nested regions run serially on the calling thread
+        for(int i=0; i < n_threads; i++) {
+            arg = jl_box_long(i+1);
+            jl_apply(f, &arg, 1);
+        }
+        JL_GC_POP();
+        return;
+    }
+    if (threads == NULL)
+        start_threads();
+
+    pthread_mutex_lock(&work_lock);
+    work_fun = f;
+    n_working = n_threads-1;
+    n_busy = n_threads;
+    jl_gc_region_begin(n_threads);
+    jl_threads_running = 1;
+    work_gen++;
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&work_lock);
+
+    run_work(0);
+    jl_gc_safe_enter();
+
+    pthread_mutex_lock(&work_lock);
+    while (n_working > 0)
+        pthread_cond_wait(&done_cond, &work_lock);
+    jl_threads_running = 0;
+    work_fun = NULL;
+    pthread_mutex_unlock(&work_lock);
+
+    // every other thread is parked again
+    jl_gc_region_end();
+
+    jl_value_t *exc = NULL;
+    for(int i=0; i < n_threads; i++) {
+        jl_value_t *e = jl_cellref(jl_thread_roots, n_threads+i);
+        if (e != (jl_value_t*)jl_null && exc == NULL)
+            exc = e;
+        jl_cellset(jl_thread_roots, n_threads+i, jl_null);
+    }
+    JL_GC_POP();
+    if (exc != NULL)
+        jl_throw(exc);
+}
+
+void jl_init_threading(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&jl_codegen_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    char *cp = getenv("JULIA_NUM_THREADS");
+    n_threads = cp ? atoi(cp) : jl_cpu_cores();
+    if (n_threads < 1)
+        n_threads = 1;
+    if (n_threads > 32767)
+        n_threads = 32767;
+}
+
+#else
+
+DLLEXPORT void jl_threading_run(jl_function_t *f)
+{
+    jl_value_t *arg = jl_box_long(1);
+    JL_GC_PUSH(&arg);
+    jl_apply(f, &arg, 1);
+    JL_GC_POP();
+}
+
+void jl_init_threading(void)
+{
+}
+
+#endif
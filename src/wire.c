@@ -0,0 +1,650 @@
+/*
+  wire.c
+  the serialization format of base/serialize.jl, in C
+
+  . jl_serialize_wire writes the same bytes as serialize, and
+    jl_deserialize_wire reads them back, for the values that make up most
+    remote call messages: tagged values, symbols, tuples, Exprs, modules,
+    types, bits values, strings, and arrays of these. the data of a bits
+    array is copied in one piece, or left for the caller to send from the
+    array itself.
+  . for anything else (functions, types with serialize or deserialize
+    methods of their own, ...) they give up without consuming anything, and
+    the caller falls back to serialize/deserialize in Julia.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "julia.h"
+#include "builtin_proto.h"
+
+// tags of base/serialize.jl. these can't change without bumping ser_version.
+#define TAG_SYMBOL      2
+#define TAG_DATATYPE    17
+#define TAG_TUPLE       20
+#define TAG_ARRAY       21
+#define TAG_EXPR        22
+#define TAG_LONGSYMBOL  23
+#define TAG_LONGTUPLE   24
+#define TAG_LONGEXPR    25
+#define TAG_MODULE      35
+#define TAG_UNDEFREF    36
+#define VALUE_TAGS      47  // tags >= this stand for themselves
+
+#define MAX_MODULE_DEPTH 32
+
+// size of the smallest array data worth writing separately
+#define JL_WIRE_DIRECT 65536
+
+jl_array_t *jl_eqtable_put(jl_array_t *h, void *key, void *val);
+jl_value_t *jl_eqtable_get(jl_array_t *h, void *key, jl_value_t *deflt);
+
+// bits types that write(s, x) and read(s, T) store as their raw bytes
+static int wire_raw_type(jl_value_t *t)
+{
+    return (t == (jl_value_t*)jl_int8_type  || t == (jl_value_t*)jl_uint8_type  ||
+            t == (jl_value_t*)jl_int16_type || t == (jl_value_t*)jl_uint16_type ||
+            t == (jl_value_t*)jl_int32_type || t == (jl_value_t*)jl_uint32_type ||
+            t == (jl_value_t*)jl_int64_type || t == (jl_value_t*)jl_uint64_type ||
+            t == (jl_value_t*)jl_float32_type || t == (jl_value_t*)jl_float64_type);
+}
+
+// type => jl_true if only the default serialize and deserialize methods
+// apply to its instances, jl_false if it has methods of its own. emptied
+// whenever methods are added to either function.
+jl_array_t *jl_wire_plain_types = NULL;
+static size_t wire_nmethods = 0;
+static jl_function_t *serialize_func = NULL;
+static jl_function_t *deserialize_func = NULL;
+
+static size_t count_methods(jl_function_t *f)
+{
+    size_t n = 0;
+    jl_methlist_t *ml;
+    for(ml = jl_gf_mtable(f)->defs; ml != JL_NULL; ml = ml->next)
+        n++;
+    return n;
+}
+
+// whether a method of f other than the one whose second argument is
+// declared dflt can take a second argument of type t
+static int has_own_method(jl_function_t *f, jl_value_t *t, jl_value_t *dflt)
+{
+    jl_methlist_t *ml;
+    for(ml = jl_gf_mtable(f)->defs; ml != JL_NULL; ml = ml->next) {
+        if (jl_tuple_len(ml->sig) < 2)
+            continue;
+        jl_value_t *a = jl_tupleref(ml->sig, 1);
+        if (a == dflt)
+            continue;
+        if (jl_is_vararg_type(a))
+            a = jl_tparam0(a);
+        if (jl_subtype(t, a, 0))
+            return 1;
+    }
+    return 0;
+}
+
+static jl_function_t *base_gf(char *name)
+{
+    jl_value_t *f = jl_get_global(jl_base_module, jl_symbol(name));
+    return (f != NULL && jl_is_function(f) && jl_is_gf(f)) ? (jl_function_t*)f : NULL;
+}
+
+static int default_methods(jl_value_t *t)
+{
+    if (serialize_func == NULL || deserialize_func == NULL) {
+        serialize_func = base_gf("serialize");
+        deserialize_func = base_gf("deserialize");
+        if (serialize_func == NULL || deserialize_func == NULL)
+            return 0;
+    }
+    size_t n = count_methods(serialize_func) + count_methods(deserialize_func);
+    if (jl_wire_plain_types == NULL || n != wire_nmethods) {
+        jl_wire_plain_types = jl_alloc_cell_1d(32);
+        wire_nmethods = n;
+    }
+    jl_value_t *v = jl_eqtable_get(jl_wire_plain_types, t, NULL);
+    if (v == NULL) {
+        jl_value_t *tt = (jl_value_t*)jl_tuple1(t);
+        JL_GC_PUSH(&tt);
+        tt = jl_apply_type((jl_value_t*)jl_type_type, (jl_tuple_t*)tt);
+        // serialize(s, x) and deserialize(s, t::DataType)
+        int own = has_own_method(serialize_func, t, (jl_value_t*)jl_any_type) ||
+            has_own_method(deserialize_func, tt, (jl_value_t*)jl_datatype_type);
+        v = own ? jl_false : jl_true;
+        jl_wire_plain_types = jl_eqtable_put(jl_wire_plain_types, t, v);
+        JL_GC_POP();
+    }
+    return v == jl_true;
+}
+
+// types whose instances go through the default serialize and deserialize
+// methods, and that we can write and build ourselves
+static int wire_plain_type(jl_value_t *t)
+{
+    if (t != (jl_value_t*)jl_ascii_string_type && t != (jl_value_t*)jl_utf8_string_type) {
+        if (!jl_isbits(t) || !jl_is_leaf_type(t) || jl_is_cpointer_type(t))
+            return 0;
+        if (jl_tuple_len(((jl_datatype_t*)t)->names) == 0 && jl_datatype_size(t) > 0 &&
+            !wire_raw_type(t))
+            return 0;
+    }
+    return default_methods(t);
+}
+
+// writing
+
+typedef struct {
+    jl_array_t *buf;
+    size_t pos;
+    jl_array_t *ht;      // the table of ser_tag
+    jl_value_t *direct;  // see jl_serialize_wire
+} wire_out_t;
+
+// room for n more bytes at s->pos
+static uint8_t *wire_reserve(wire_out_t *s, size_t n)
+{
+    if (s->pos + n > jl_array_len(s->buf))
+        jl_array_grow_end(s->buf, s->pos + n - jl_array_len(s->buf));
+    uint8_t *p = (uint8_t*)jl_array_data(s->buf) + s->pos;
+    s->pos += n;
+    return p;
+}
+
+static void write_bytes(wire_out_t *s, const void *data, size_t n)
+{
+    memcpy(wire_reserve(s, n), data, n);
+}
+
+static void write_uint8(wire_out_t *s, uint8_t x)
+{
+    *wire_reserve(s, 1) = x;
+}
+
+static void write_int32(wire_out_t *s, int32_t x)
+{
+    write_bytes(s, &x, sizeof(x));
+}
+
+static int wire_tag(jl_array_t *ht, jl_value_t *v)
+{
+    jl_value_t *t = jl_eqtable_get(ht, v, NULL);
+    return t == NULL ? 0 : jl_unbox_int32(t);
+}
+
+// a length, as 1 byte after short or 4 bytes after long
+static void write_len(wire_out_t *s, size_t n, int short_tag, int long_tag)
+{
+    if (n <= 255) {
+        write_uint8(s, short_tag);
+        write_uint8(s, n);
+    }
+    else {
+        write_uint8(s, long_tag);
+        write_int32(s, n);
+    }
+}
+
+static int wire_write(wire_out_t *s, jl_value_t *v);
+
+static int write_module(wire_out_t *s, jl_module_t *m)
+{
+    jl_sym_t *path[MAX_MODULE_DEPTH];
+    int n = 0;
+    for(; m != jl_main_module; m = m->parent) {
+        if (n == MAX_MODULE_DEPTH || m->parent == m)
+            return 0;
+        path[n++] = m->name;
+    }
+    write_uint8(s, TAG_MODULE);
+    if (n == 0)
+        return wire_write(s, (jl_value_t*)jl_null);
+    write_len(s, n, TAG_TUPLE, TAG_LONGTUPLE);
+    while (n > 0) {
+        if (!wire_write(s, (jl_value_t*)path[--n]))
+            return 0;
+    }
+    return 1;
+}
+
+// name, module and parameters; as serialize_type_data
+static int write_type_data(wire_out_t *s, jl_datatype_t *t)
+{
+    jl_sym_t *name = t->name->name;
+    jl_module_t *mod = t->name->module;
+    if (!wire_write(s, (jl_value_t*)name) || !write_module(s, mod))
+        return 0;
+    if (jl_get_global(mod, name) == (jl_value_t*)t)
+        return wire_write(s, (jl_value_t*)jl_null);
+    return wire_write(s, (jl_value_t*)t->parameters);
+}
+
+static int write_array(wire_out_t *s, jl_array_t *a)
+{
+    jl_value_t *elty = jl_tparam0(jl_typeof(a));
+    size_t i, n = jl_array_len(a);
+    write_uint8(s, TAG_ARRAY);
+    if (!wire_write(s, elty))
+        return 0;
+    int ndims = jl_array_ndims(a);
+    write_len(s, ndims, TAG_TUPLE, TAG_LONGTUPLE);
+    for(i=0; i < ndims; i++) {
+        jl_value_t *d = jl_box_long(jl_array_dim(a,i));
+        JL_GC_PUSH(&d);
+        int ok = wire_write(s, d);
+        JL_GC_POP();
+        if (!ok) return 0;
+    }
+    if (jl_isbits(elty)) {
+        uint8_t *data = (uint8_t*)jl_array_data(a);
+        if (elty == (jl_value_t*)jl_bool_type && n > 0) {
+            // runs of up to 127 equal values, with the value in the top bit
+            uint8_t last = data[0], count = 1;
+            for(i=1; i < n; i++) {
+                if (data[i] != last || count == 127) {
+                    write_uint8(s, (last<<7) | count);
+                    last = data[i];
+                    count = 1;
+                }
+                else {
+                    count++;
+                }
+            }
+            write_uint8(s, (last<<7) | count);
+        }
+        else if (s->direct != jl_nothing && n * a->elsize >= JL_WIRE_DIRECT) {
+            // left out, to be written from a itself
+            jl_value_t *offs = jl_box_long(s->pos);
+            JL_GC_PUSH(&offs);
+            jl_cell_1d_push((jl_array_t*)s->direct, offs);
+            jl_cell_1d_push((jl_array_t*)s->direct, (jl_value_t*)a);
+            JL_GC_POP();
+        }
+        else {
+            write_bytes(s, jl_array_data(a), n * a->elsize);
+        }
+        return 1;
+    }
+    for(i=0; i < n; i++) {
+        jl_value_t *x = jl_cellref(a, i);
+        if (x == NULL)
+            write_uint8(s, TAG_UNDEFREF);
+        else if (!wire_write(s, x))
+            return 0;
+    }
+    return 1;
+}
+
+// an instance of a plain type; as the last serialize method
+static int write_fields(wire_out_t *s, jl_value_t *v)
+{
+    jl_datatype_t *t = (jl_datatype_t*)jl_typeof(v);
+    int tag = wire_tag(s->ht, (jl_value_t*)t);
+    if (tag != 0) {
+        write_uint8(s, tag);
+    }
+    else {
+        write_uint8(s, TAG_DATATYPE);
+        write_uint8(s, 1);
+        if (!write_type_data(s, t))
+            return 0;
+    }
+    size_t i, nf = jl_tuple_len(t->names);
+    if (nf == 0 && t->size > 0) {
+        write_bytes(s, jl_data_ptr(v), t->size);
+        return 1;
+    }
+    jl_value_t *x = jl_box_long(nf);
+    JL_GC_PUSH(&x);
+    int ok = wire_write(s, x);
+    for(i=0; ok && i < nf; i++) {
+        x = jl_get_nth_field(v, i);
+        if (x == NULL)
+            write_uint8(s, TAG_UNDEFREF);
+        else
+            ok = wire_write(s, x);
+    }
+    JL_GC_POP();
+    return ok;
+}
+
+static int wire_write(wire_out_t *s, jl_value_t *v)
+{
+    size_t i;
+    int tag = wire_tag(s->ht, v);
+    if (tag != 0) {
+        if (tag < VALUE_TAGS)
+            write_uint8(s, 0);
+        write_uint8(s, tag);
+        return 1;
+    }
+    if (jl_is_symbol(v)) {
+        char *name = ((jl_sym_t*)v)->name;
+        size_t n = strlen(name);
+        write_len(s, n, TAG_SYMBOL, TAG_LONGSYMBOL);
+        write_bytes(s, name, n);
+        return 1;
+    }
+    if (jl_is_tuple(v)) {
+        size_t n = jl_tuple_len(v);
+        write_len(s, n, TAG_TUPLE, TAG_LONGTUPLE);
+        for(i=0; i < n; i++) {
+            if (!wire_write(s, jl_tupleref(v,i)))
+                return 0;
+        }
+        return 1;
+    }
+    if (jl_is_array(v))
+        return write_array(s, (jl_array_t*)v);
+    if (jl_is_expr(v)) {
+        jl_expr_t *e = (jl_expr_t*)v;
+        size_t n = jl_array_len(e->args);
+        write_len(s, n, TAG_EXPR, TAG_LONGEXPR);
+        if (!wire_write(s, (jl_value_t*)e->head) ||
+            !wire_write(s, e->etype))
+            return 0;
+        for(i=0; i < n; i++) {
+            if (!wire_write(s, jl_cellref(e->args,i)))
+                return 0;
+        }
+        return 1;
+    }
+    if (jl_is_module(v))
+        return write_module(s, (jl_module_t*)v);
+    if (jl_is_datatype(v)) {
+        write_uint8(s, TAG_DATATYPE);
+        write_uint8(s, 0);
+        return write_type_data(s, (jl_datatype_t*)v);
+    }
+    if (wire_plain_type(jl_typeof(v)))
+        return write_fields(s, v);
+    return 0;
+}
+
+// serialize v into buf starting at byte offset pos, growing buf as needed.
+// ht is the table of ser_tag. returns the offset after the last byte
+// written, or 0 if v has to be written by serialize.
+// unless direct is nothing, the data of bits arrays of JL_WIRE_DIRECT
+// bytes or more is left out, and the offset where it belongs and the
+// array are pushed onto direct instead.
+DLLEXPORT size_t jl_serialize_wire(jl_array_t *buf, size_t pos, jl_value_t *v,
+                                   jl_array_t *ht, jl_value_t *direct)
+{
+    wire_out_t s;
+    s.buf = buf;
+    s.pos = pos;
+    s.ht = ht;
+    s.direct = direct;
+    return wire_write(&s, v) ? s.pos : 0;
+}
+
+// reading
+
+typedef struct {
+    uint8_t *data;
+    size_t pos;
+    size_t end;
+    jl_array_t *tags;
+} wire_in_t;
+
+static int read_uint8(wire_in_t *s, int *x)
+{
+    if (s->pos >= s->end) return 0;
+    *x = s->data[s->pos++];
+    return 1;
+}
+
+static int read_int32(wire_in_t *s, int32_t *x)
+{
+    if (s->end - s->pos < sizeof(int32_t)) return 0;
+    memcpy(x, s->data + s->pos, sizeof(int32_t));
+    s->pos += sizeof(int32_t);
+    return 1;
+}
+
+// length of a short or long tuple, symbol or Expr. at least that many
+// bytes must follow, which bounds what we allocate for it.
+static int read_len(wire_in_t *s, int islong, size_t *n)
+{
+    if (islong) {
+        int32_t l;
+        if (!read_int32(s, &l) || l < 0) return 0;
+        *n = l;
+    }
+    else {
+        int l;
+        if (!read_uint8(s, &l)) return 0;
+        *n = l;
+    }
+    return *n <= s->end - s->pos;
+}
+
+static jl_value_t *tag_value(wire_in_t *s, int tag)
+{
+    if (tag <= 0 || tag > jl_array_len(s->tags)) return NULL;
+    return jl_cellref(s->tags, tag-1);
+}
+
+static jl_value_t *wire_read(wire_in_t *s);
+
+static jl_value_t *read_tuple(wire_in_t *s, int islong)
+{
+    size_t i, n;
+    if (!read_len(s, islong, &n)) return NULL;
+    jl_tuple_t *t = jl_alloc_tuple(n);
+    JL_GC_PUSH(&t);
+    for(i=0; i < n; i++) {
+        jl_value_t *x = wire_read(s);
+        if (x == NULL) { t = NULL; break; }
+        jl_tupleset(t, i, x);
+    }
+    JL_GC_POP();
+    return (jl_value_t*)t;
+}
+
+static jl_value_t *read_module(wire_in_t *s)
+{
+    jl_value_t *path = wire_read(s);
+    if (path == NULL || !jl_is_tuple(path)) return NULL;
+    jl_module_t *m = jl_main_module;
+    for(size_t i=0; i < jl_tuple_len(path); i++) {
+        jl_value_t *name = jl_tupleref(path, i);
+        if (!jl_is_symbol(name)) return NULL;
+        jl_value_t *sub = jl_get_global(m, (jl_sym_t*)name);
+        if (sub == NULL || !jl_is_module(sub)) return NULL;
+        m = (jl_module_t*)sub;
+    }
+    return (jl_value_t*)m;
+}
+
+// an instance of t; as the default DataType deserialize method
+static jl_value_t *read_fields(wire_in_t *s, jl_datatype_t *t)
+{
+    if (!wire_plain_type((jl_value_t*)t)) return NULL;
+    size_t i, nf = jl_tuple_len(t->names);
+    if (nf == 0 && t->size > 0) {
+        if (s->end - s->pos < t->size) return NULL;
+        jl_value_t *v = jl_new_bits(t, s->data + s->pos);
+        s->pos += t->size;
+        return v;
+    }
+    if (wire_read(s) == NULL)  // field count
+        return NULL;
+    if (nf == 0)
+        return jl_new_struct_uninit(t);
+    jl_value_t *v = jl_new_struct_uninit(t);
+    jl_value_t *x = NULL;
+    JL_GC_PUSH(&v, &x);
+    for(i=0; i < nf; i++) {
+        if ((t->mutabl || nf > 2) && s->pos < s->end &&
+            s->data[s->pos] == TAG_UNDEFREF) {
+            s->pos++;
+            continue;
+        }
+        x = wire_read(s);
+        if (x == NULL || !jl_subtype(x, jl_tupleref(t->types,i), 1)) {
+            v = NULL;
+            break;
+        }
+        jl_set_nth_field(v, i, x);
+    }
+    JL_GC_POP();
+    return v;
+}
+
+static jl_value_t *read_datatype(wire_in_t *s)
+{
+    int form;
+    if (!read_uint8(s, &form)) return NULL;
+    jl_value_t *name = wire_read(s);
+    if (name == NULL || !jl_is_symbol(name)) return NULL;
+    jl_value_t *mod = wire_read(s);
+    if (mod == NULL || !jl_is_module(mod)) return NULL;
+    jl_value_t *params = wire_read(s);
+    if (params == NULL || !jl_is_tuple(params)) return NULL;
+    jl_value_t *t = jl_get_global((jl_module_t*)mod, (jl_sym_t*)name);
+    if (t == NULL) return NULL;
+    if (params != (jl_value_t*)jl_null) {
+        JL_GC_PUSH(&params);
+        t = jl_apply_type(t, (jl_tuple_t*)params);
+        JL_GC_POP();
+    }
+    if (!jl_is_datatype(t)) return NULL;
+    if (form == 0) return t;
+    return read_fields(s, (jl_datatype_t*)t);
+}
+
+static jl_value_t *read_array(wire_in_t *s)
+{
+    jl_value_t *elty = wire_read(s);
+    if (elty == NULL || !jl_is_type(elty)) return NULL;
+    jl_value_t *dims = NULL, *atype = NULL;
+    jl_array_t *a = NULL;
+    JL_GC_PUSH(&elty, &dims, &atype, &a);
+    dims = wire_read(s);
+    size_t i, n = 1;
+    if (dims == NULL || !jl_is_tuple(dims)) goto fail;
+    for(i=0; i < jl_tuple_len(dims); i++) {
+        jl_value_t *d = jl_tupleref(dims, i);
+        if (!jl_is_long(d) || jl_unbox_long(d) < 0) goto fail;
+        n *= jl_unbox_long(d);
+        // every element takes at least one byte; this also keeps n from overflowing
+        if (n > s->end - s->pos) goto fail;
+    }
+    atype = jl_box_long(jl_tuple_len(dims));
+    atype = jl_apply_type((jl_value_t*)jl_array_type, jl_tuple2(elty, atype));
+    a = jl_new_array(atype, (jl_tuple_t*)dims);
+    if (jl_isbits(elty)) {
+        uint8_t *data = (uint8_t*)jl_array_data(a);
+        if (elty == (jl_value_t*)jl_bool_type) {
+            for(i=0; i < n; ) {
+                int b;
+                if (!read_uint8(s, &b)) goto fail;
+                size_t count = b & 0x7f;
+                if (count == 0 || count > n-i) goto fail;
+                memset(data+i, b>>7, count);
+                i += count;
+            }
+        }
+        else {
+            size_t nb = n * a->elsize;
+            if (nb > s->end - s->pos) goto fail;
+            memcpy(data, s->data + s->pos, nb);
+            s->pos += nb;
+        }
+    }
+    else {
+        for(i=0; i < n; i++) {
+            if (s->pos < s->end && s->data[s->pos] == TAG_UNDEFREF) {
+                s->pos++;
+                continue;
+            }
+            jl_value_t *x = wire_read(s);
+            if (x == NULL || !jl_subtype(x, elty, 1)) goto fail;
+            jl_cellset(a, i, x);
+        }
+    }
+    JL_GC_POP();
+    return (jl_value_t*)a;
+ fail:
+    JL_GC_POP();
+    return NULL;
+}
+
+static jl_value_t *read_expr(wire_in_t *s, int islong)
+{
+    size_t i, n;
+    if (!read_len(s, islong, &n)) return NULL;
+    jl_value_t *head = wire_read(s);
+    if (head == NULL || !jl_is_symbol(head)) return NULL;
+    jl_value_t *typ = wire_read(s);
+    if (typ == NULL) return NULL;
+    jl_expr_t *e = NULL;
+    JL_GC_PUSH(&typ, &e);
+    e = jl_exprn((jl_sym_t*)head, n);
+    e->etype = typ;
+    for(i=0; i < n; i++) {
+        jl_value_t *x = wire_read(s);
+        if (x == NULL) { e = NULL; break; }
+        jl_cellset(e->args, i, x);
+    }
+    JL_GC_POP();
+    return (jl_value_t*)e;
+}
+
+static jl_value_t *read_symbol(wire_in_t *s, int islong)
+{
+    size_t n;
+    if (!read_len(s, islong, &n)) return NULL;
+    jl_value_t *sym = (jl_value_t*)jl_symbol_n((char*)s->data + s->pos, n);
+    s->pos += n;
+    return sym;
+}
+
+// NULL if the value isn't complete in s or isn't one we handle
+static jl_value_t *wire_read(wire_in_t *s)
+{
+    int b;
+    if (!read_uint8(s, &b)) return NULL;
+    if (b == 0) {
+        if (!read_uint8(s, &b)) return NULL;
+        return tag_value(s, b);
+    }
+    jl_value_t *tag = tag_value(s, b);
+    if (tag == NULL) return NULL;
+    if (b >= VALUE_TAGS) return tag;
+    switch (b) {
+    case TAG_SYMBOL:     return read_symbol(s, 0);
+    case TAG_LONGSYMBOL: return read_symbol(s, 1);
+    case TAG_TUPLE:      return read_tuple(s, 0);
+    case TAG_LONGTUPLE:  return read_tuple(s, 1);
+    case TAG_EXPR:       return read_expr(s, 0);
+    case TAG_LONGEXPR:   return read_expr(s, 1);
+    case TAG_ARRAY:      return read_array(s);
+    case TAG_MODULE:     return read_module(s);
+    case TAG_DATATYPE:   return read_datatype(s);
+    }
+    if (jl_is_datatype(tag))
+        return read_fields(s, (jl_datatype_t*)tag);
+    return NULL;
+}
+
+// deserialize a value from bytes [*ppos, end) of buf. tags[i] is the value
+// with tag i. on success, advances *ppos past it; otherwise returns tags
+// and leaves *ppos alone, and the value has to be read by deserialize.
+DLLEXPORT jl_value_t *jl_deserialize_wire(jl_array_t *buf, size_t *ppos, size_t end,
+                                          jl_array_t *tags)
+{
+    if (end > jl_array_len(buf) || *ppos > end)
+        return (jl_value_t*)tags;
+    wire_in_t s;
+    s.data = (uint8_t*)jl_array_data(buf);
+    s.pos = *ppos;
+    s.end = end;
+    s.tags = tags;
+    jl_value_t *v = wire_read(&s);
+    if (v == NULL)
+        return (jl_value_t*)tags;
+    *ppos = s.pos;
+    return v;
+}
@@ -350,3 +350,48 @@ end
 @test isequal(symdiff(Int64[], [1,2,3]), [1,2,3])
 @test isequal(symdiff(Int64[]), Int64[])
 
+
+# bounds checks in loops
+function sum_range1(A)
+    s = 0.0
+    for i = 1:length(A)
+        s += A[i]
+    end
+    s
+end
+function sum_inbounds(A)
+    s = 0.0
+    @inbounds for i = 1:length(A)
+        s += A[i]
+    end
+    s
+end
+function sum_past_end(A)
+    s = 0.0
+    for i = 1:length(A)+1
+        s += A[i]
+    end
+    s
+end
+function sum_shrinking(A)
+    s = 0.0
+    n = length(A)
+    for i = 1:n
+        s += A[i]
+        pop!(A)
+    end
+    s
+end
+function scale_range1!(A, c)
+    for i = 1:length(A)
+        A[i] *= c
+    end
+    A
+end
+A = [1.0:100.0]
+@test sum_range1(A) == 5050.0
+@test sum_inbounds(A) == 5050.0
+@test sum_range1(Float64[]) == 0.0
+@test_fails sum_past_end(A)
+@test_fails sum_shrinking(copy(A))
+@test scale_range1!(copy(A), 2.0) == 2A
@@ -259,3 +259,38 @@ if run_assign
         end
     end
 end
+
+println("\n")
+println("Elementwise loops:")
+function loop_checked(A, B)
+    s = 0.0
+    for i = 1:length(A)
+        j = i
+        s += A[j]*B[j]
+    end
+    s
+end
+function loop_range1(A)
+    s = 0.0
+    for i = 1:length(A)
+        s += A[i]*A[i]
+    end
+    s
+end
+function loop_inbounds(A, B)
+    s = 0.0
+    @inbounds for i = 1:length(A)
+        s += A[i]*B[i]
+    end
+    s
+end
+A = randn(1000000)
+B = randn(1000000)
+n_r = iceil(n_evals/length(A))
+loop_checked(A, B); loop_range1(A); loop_inbounds(A, B)
+print("checked (", n_r, " repeats): ")
+@time for i = 1:n_r; loop_checked(A, B); end
+print("1:length(A) (", n_r, " repeats): ")
+@time for i = 1:n_r; loop_range1(A); end
+print("@inbounds (", n_r, " repeats): ")
+@time for i = 1:n_r; loop_inbounds(A, B); end
@@ -1,3 +1,70 @@
 ccall_test_func(x) = ccall((:testUcharX, "./libccalltest"), Int32, (Uint8,), x)
 @assert ccall_test_func(3) == 1
 @assert ccall_test_func(259) == 1
+
+@assert ccall((:testAddInt, "./libccalltest"), Int32, (Int32, Int32), 2, 3) == 5
+@assert ccall((:testMulAddDouble, "./libccalltest"), Float64,
+              (Float64, Float64, Float64), 2, 3, 1) == 7.0
+
+# arrays of strings passed as char** are converted in the temporary argument
+# area, including ones that don't fit in its first chunk
+let strs = [string(i) for i=1:2000], p = Array(Ptr{Uint8}, 2000)
+    for k = 1:3
+        ccall(:memcpy, Ptr{Void}, (Ptr{Ptr{Uint8}}, Ptr{Ptr{Uint8}}, Uint),
+              p, strs, sizeof(p))
+        @assert p[1] == pointer(strs[1].data)
+        @assert p[2000] == pointer(strs[2000].data)
+    end
+end
+
+# C callbacks. the entry point for a signature is compiled once.
+ccall_test_cmp(a::Ptr{Int}, b::Ptr{Int}) = int32(cmp(unsafe_ref(a), unsafe_ref(b)))
+let fp = cfunction(ccall_test_cmp, Int32, (Ptr{Int}, Ptr{Int})), a = [5, 2, 9, 1, 7]
+    @assert cfunction(ccall_test_cmp, Int32, (Ptr{Int}, Ptr{Int})) == fp
+    ccall(:qsort, Void, (Ptr{Int}, Uint, Uint, Ptr{Void}), a, length(a), sizeof(Int), fp)
+    @assert a == [1, 2, 5, 7, 9]
+end
+
+# structs passed and returned by value
+immutable CComplex
+    re::Float64
+    im::Float64
+end
+immutable CMixed
+    x::Int64
+    y::Float64
+end
+immutable CFloat3
+    x::Float32
+    y::Float32
+    z::Float32
+end
+immutable CBig
+    a::Int64
+    b::Int64
+    c::Int64
+end
+
+let c = ccall((:testComplexMul, "./libccalltest"), CComplex, (CComplex, CComplex),
+              CComplex(1.0, 2.0), CComplex(3.0, 4.0))
+    @assert c.re == -5.0 && c.im == 10.0
+end
+let m = ccall((:testMixed, "./libccalltest"), CMixed, (CMixed, Int32), CMixed(5, 1.5), 2)
+    @assert m.x == 7 && m.y == 3.0
+end
+let f = ccall((:testFloat3, "./libccalltest"), CFloat3, (CFloat3, Float32),
+              CFloat3(1, 2, 3), 2)
+    @assert f.x == 2 && f.y == 4 && f.z == 6
+end
+let b = ccall((:testBig, "./libccalltest"), CBig, (CBig,), CBig(1, 2, 3))
+    @assert b.a == 3 && b.b == 2 && b.c == 1
+end
+@assert ccall((:testManyComplex, "./libccalltest"), Float64,
+              (CComplex, CComplex, CComplex, CComplex, CComplex),
+              CComplex(1,0), CComplex(0,2), CComplex(4,0), CComplex(0,8), CComplex(16,0)) == 31.0
+# redefining the function gives the new code
+ccall_test_cmp(a::Ptr{Int}, b::Ptr{Int}) = int32(cmp(unsafe_ref(b), unsafe_ref(a)))
+let fp = cfunction(ccall_test_cmp, Int32, (Ptr{Int}, Ptr{Int})), a = [5, 2, 9, 1, 7]
+    ccall(:qsort, Void, (Ptr{Int}, Uint, Uint, Ptr{Void}), a, length(a), sizeof(Int), fp)
+    @assert a == [9, 7, 5, 2, 1]
+end
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <time.h>
 
 int xs[300] = {0,0,0,1,0};
 
@@ -6,6 +7,74 @@ int __attribute((noinline)) testUcharX(unsigned char x) {
 	return xs[x];
 }
 
+int __attribute((noinline)) testAddInt(int a, int b) {
+    return a + b;
+}
+
+double __attribute((noinline)) testMulAddDouble(double a, double b, double c) {
+    return a*b + c;
+}
+
+// structs passed and returned by value
+
+typedef struct { double re, im; } complex_t;
+typedef struct { long long x; double y; } mixed_t;
+typedef struct { float x, y, z; } float3_t;
+typedef struct { long long a, b, c; } big_t;
+
+complex_t __attribute((noinline)) testComplexMul(complex_t a, complex_t b) {
+    complex_t c;
+    c.re = a.re*b.re - a.im*b.im;
+    c.im = a.re*b.im + a.im*b.re;
+    return c;
+}
+
+mixed_t __attribute((noinline)) testMixed(mixed_t a, int k) {
+    a.x += k;
+    a.y *= k;
+    return a;
+}
+
+float3_t __attribute((noinline)) testFloat3(float3_t a, float s) {
+    a.x *= s;
+    a.y *= s;
+    a.z *= s;
+    return a;
+}
+
+big_t __attribute((noinline)) testBig(big_t a) {
+    big_t b;
+    b.a = a.c;
+    b.b = a.b;
+    b.c = a.a;
+    return b;
+}
+
+// more struct arguments than there are registers for; the last ones go on the stack
+double __attribute((noinline)) testManyComplex(complex_t a, complex_t b, complex_t c,
+                                               complex_t d, complex_t e) {
+    return a.re + b.im + c.re + d.im + e.re;
+}
+
+// the cost of calling the functions above from C, to compare with ccall
+// (see test/perf2/ccall.jl)
+#define NCALLS 100000000
+static void bench_calls(void) {
+    int i;
+    clock_t t0 = clock();
+    int s = 0;
+    for (i = 0; i < NCALLS; i++)
+        s = testAddInt(s, i&0xff);
+    double t = (double)(clock()-t0)/CLOCKS_PER_SEC;
+    printf("c_call_add_int\t%f\t%f ns/call (%d)\n", t*1000, t*1e9/NCALLS, s);
+    t0 = clock();
+    double d = 0;
+    for (i = 0; i < NCALLS; i++)
+        d = testMulAddDouble(d, 0.5, 1.0);
+    t = (double)(clock()-t0)/CLOCKS_PER_SEC;
+    printf("c_call_muladd_double\t%f\t%f ns/call (%f)\n", t*1000, t*1e9/NCALLS, d);
+}
+
 #define xstr(s) str(s)
 #define str(s) #s
 volatile int (*fptr)(unsigned char x);
@@ -20,5 +89,6 @@ int main() {
     if ((((long)fptr)&((long)1)<<32) == 1) fptr = NULL;
 	printf("compiled with: '%s'\nxs[3] = %d\nxs[259] = %d\ntestUcharX(3) = %d\ntestUcharX(%d) = %d\nfptr(3) = %d\nfptr(259) = %d\n",
 		   xstr(CC), xs[a], xs[b], testUcharX(a), b, testUcharX(b), fptr(a), fptr(b));
+    bench_calls();
 }
 
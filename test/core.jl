@@ -699,3 +699,72 @@ end
 i2619()
 @test !bad2619
 @test isa(e2619,ErrorException) && e2619.msg == "in i2619: f not defined"
+
+# per-method compile statistics
+compilestats_f(x) = x+1
+compilestats_f(1)
+let s = filter(s->s[1]===:compilestats_f, compile_stats())
+    @test !isempty(s)
+    s = s[1]
+    @test s[4] >= 0 && s[5] >= 0 && s[6] >= 0
+    @test s[7] > 0 && s[8] > 0
+    @test s[9] > 0
+end
+
+# task switching, and reuse of the stacks of finished tasks
+let me = current_task(), n = 0
+    t = Task(()->(for i=1:100; n += 1; yieldto(me); end))
+    for i=1:100
+        yieldto(t)
+    end
+    @test n == 100
+    @test sum([yieldto(Task(()->i)) for i=1:1000]) == 500500
+end
+
+# stacks of unreachable suspended tasks are reclaimed
+let me = current_task()
+    for i = 1:100
+        yieldto(Task(()->yieldto(me)))
+    end
+    gc()
+    @test yieldto(Task(()->1)) == 1
+end
+
+# immutable structs of bits fields are stored inline in other structs
+immutable FooBarPair
+    a::FooBar
+    b::FooBar
+end
+type FooBarBox
+    x::FooBar
+    n::Int
+end
+let X = [FooBarPair(FooBar(1,2), FooBar(3,4)), FooBarPair(FooBar(5,6), FooBar(7,8))]
+    @test isbits(FooBarPair)
+    @test unsafe_ref(convert(Ptr{Int}, X), 7) == 7
+    @test X[2].b == FooBar(7,8)
+    @test FooBarPair(FooBar(1,2), FooBar(3,4)) === X[1]
+    @test hash(FooBarPair(FooBar(1,2), FooBar(3,4))) == hash(X[1])
+    @test X[1] != X[2]
+    b = FooBarBox(FooBar(1,2), 3)
+    b.x = FooBar(b.x.bar, b.x.foo)
+    @test b.x == FooBar(2,1) && b.n == 3
+end
+# a struct too big for a field descriptor is stored boxed instead, and a
+# type whose fields end too far out is an error
+eval(Expr(:type, false, :Inline128, Expr(:block, [:($(symbol("f$i"))::Int64) for i=1:16]...)))
+eval(Expr(:type, false, :Inline2K, Expr(:block, [:($(symbol("f$i"))::Inline128) for i=1:16]...)))
+eval(Expr(:type, false, :Inline32K, Expr(:block, [:($(symbol("f$i"))::Inline2K) for i=1:16]...)))
+type Inline32KBox
+    x::Inline32K
+    n::Int
+end
+let a = Inline128([1:16]...), b = Inline2K([a for i=1:16]...),
+    c = Inline32K([b for i=1:16]...)
+    @test sizeof(Inline32K) == 32768
+    x = Inline32KBox(c, 3)
+    @test x.x === c && x.n == 3
+    @test x.x.f16.f16.f16 == 16
+end
+@test_fails eval(Expr(:type, false, :Inline64K,
+                      Expr(:block, [:($(symbol("f$i"))::Inline2K) for i=1:33]...)))
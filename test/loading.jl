@@ -0,0 +1,34 @@
+# a module saved by jl_save_module, restored in a process started from the
+# same system image
+module CachedMod
+    type Point{T}
+        x::T
+        y::T
+    end
+    typealias IntPoint Point{Int}
+    const origin = Point(0, 0)
+    norm1(p::Point) = abs(p.x) + abs(p.y)
+    Base.length(p::Point) = 2
+    Base.getindex(p::Point, i::Integer) = i == 1 ? p.x : p.y
+end
+
+let dir = mktempdir(), file = joinpath(dir, "CachedMod.ji")
+    data = ccall(:jl_save_module, Any, (Any,), CachedMod)::Array{Uint8,1}
+    open(io->write(io, data), file, "w")
+    check = """
+        data = open(io->read(io, Uint8, filesize("$file")), "$file")
+        m = ccall(:jl_restore_module, Any, (Any,), data)
+        @assert is(m, CachedMod)
+        p = CachedMod.Point(1, -2)
+        @assert is(typeof(p), CachedMod.Point{Int})
+        @assert is(CachedMod.IntPoint, CachedMod.Point{Int})
+        @assert is(typeof(CachedMod.origin), CachedMod.IntPoint)
+        @assert CachedMod.origin.x == 0 && CachedMod.origin.y == 0
+        @assert CachedMod.norm1(p) == 3
+        @assert length(p) == 2 && p[2] == -2
+        @assert length(CachedMod.origin) == 2
+    """
+    @test success(`$JULIA_HOME/julia -e $check`)
+    rm(file)
+    rmdir(dir)
+end
@@ -108,3 +108,39 @@ end
 @test_approx_eq zeta(0) -0.5
 @test_approx_eq zeta(2) pi^2/6
 @test_approx_eq zeta(4) pi^4/90
+
+# fma, muladd
+for T in (Float32, Float64)
+    e = eps(one(T))
+    x = one(T) + e
+    # x*x = 1 + 2e + e^2; only a fused operation keeps the e^2 term
+    @test fma(x, x, -(one(T)+2e)) == e*e
+    @test muladd(x, x, -one(T)) >= 2e
+    @test fma(convert(T,2), convert(T,3), convert(T,4)) === convert(T,10)
+    @test muladd(convert(T,2), convert(T,3), convert(T,4)) === convert(T,10)
+end
+@test fma(2, 3, 4) === 10.0
+@test fma(float32(2), 3.0, 4) === 10.0
+@test muladd(2, 3, 4) == 10
+@test isnan(fma(Inf, 0.0, 1.0))
+
+# @fastmath
+function fastmath_sum(a)
+    s = 0.0
+    @fastmath for i = 1:length(a)
+        s += a[i]
+    end
+    s
+end
+function fastmath_dot(a, b)
+    s = 0.0
+    @fastmath for i = 1:length(a)
+        s = muladd(a[i], b[i], s)
+    end
+    s
+end
+a = rand(10001); b = rand(10001)
+@test_approx_eq fastmath_sum(a) sum(a)
+@test_approx_eq fastmath_dot(a, b) dot(a, b)
+@test fastmath_sum([1.0:100.0]) == 5050.0
+@test (@fastmath 1.5*2.0+1.0) == 4.0
@@ -7,6 +7,22 @@ id_other = id_me==1 ? 2 : 1
 
 @test fetch(@spawnat id_other myid()) == id_other
 
+# workers compile at our optimization level
+@test fetch(@spawnat id_other ccall(:jl_opt_level, Int32, ())) ==
+      ccall(:jl_opt_level, Int32, ())
+
+# a remote_call is written when it is made, not at the caller's next yield:
+# the worker runs it while this task only sleeps in C
+let f = tempname()
+    remote_call(id_other, run, `touch $f`)
+    t = time()
+    while !isfile(f) && time()-t < 10
+        ccall(:usleep, Int32, (Uint32,), 10000)
+    end
+    @test isfile(f)
+    rm(f)
+end
+
 d = drand((200,200), [id_me, id_other])
 s = convert(Array, d[1:150, 1:150])
 a = convert(Array, d)
@@ -14,3 +30,55 @@ a = convert(Array, d)
 
 @test fetch(@spawnat id_me localpart(d)[1,1]) == d[1,1]
 @test fetch(@spawnat id_other localpart(d)[1,1]) == d[1,101]
+
+# shared-memory threads
+let a = zeros(Int, 1000), ids = zeros(Int, 1000)
+    @threads for i = 1:1000
+        a[i] = i
+        ids[i] = threadid()
+    end
+    @test a == [1:1000]
+    @test issorted(ids)
+    @test 1 <= minimum(ids) && maximum(ids) <= nthreads()
+    @test_fails @threads for i = 1:10
+        error("in thread")
+    end
+end
+
+# threads that allocate far more than a collection interval are stopped
+# for collections inside the region, and keep what they still use
+let sums = zeros(Int, 100)
+    @threads for i = 1:100
+        v = {}
+        for j = 1:1000
+            push!(v, [1:100])
+        end
+        sums[i] = sum([sum(x) for x in v])
+    end
+    @test all(sums .== 1000*5050)
+end
+
+# fork-join and work stealing
+function spawnthread_fib(n)
+    if n < 2
+        return n
+    end
+    t = @spawnthread spawnthread_fib(n-1)
+    spawnthread_fib(n-2) + fetch(t)
+end
+@test spawnthread_fib(15) == 610
+let r = zeros(Int, 1)
+    @threads for i = 1:1
+        r[1] = spawnthread_fib(15)
+    end
+    @test r[1] == 610
+end
+@test_fails fetch(@spawnthread error("in spawned task"))
+
+# many local tasks
+let a = zeros(Int, 1000)
+    @sync for i = 1:1000
+        @async a[i] = i
+    end
+    @test a == [1:1000]
+end
@@ -0,0 +1,34 @@
+# compressed method bodies of Base. uncompressing a small set repeatedly
+# finds most of them in the AST cache.
+
+function compressed_lambdas()
+    lis = {}
+    for name in names(Base)
+        isdefined(Base, name) || continue
+        f = eval(Base, name)
+        isgeneric(f) || continue
+        d = f.env.defs
+        while !is(d, ())
+            li = d.func.code
+            isa(li.ast, Array) && push!(lis, li)
+            d = d.next
+        end
+    end
+    lis
+end
+
+function ast_uncompress(lis)
+    for li in lis
+        ccall(:jl_uncompress_ast, Any, (Any,Any), li, li.ast)
+    end
+    length(lis)
+end
+
+function ast_compress(lis)
+    nb = 0
+    for li in lis
+        ast = ccall(:jl_uncompress_ast, Any, (Any,Any), li, li.ast)
+        nb += length(ccall(:jl_compress_ast, Any, (Any,Any), li, ast))
+    end
+    nb
+end
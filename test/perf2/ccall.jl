@@ -0,0 +1,89 @@
+# ccall argument conversion. passing an array of strings as Ptr{Ptr{Uint8}}
+# builds a temporary array of pointers for every call.
+function ccall_strarray(n, iters)
+    strs = [string(i) for i=1:n]
+    p = Array(Ptr{Uint8}, n)
+    for k = 1:iters
+        ccall(:memcpy, Ptr{Void}, (Ptr{Ptr{Uint8}}, Ptr{Ptr{Uint8}}, Uint),
+              p, strs, sizeof(p))
+    end
+    p
+end
+
+# PCRE through the Regex API
+function regex_match(n)
+    r = r"(\d+)-(\d+)"
+    c = 0
+    for i = 1:n
+        m = match(r, string("id ", i, "-", i+1))
+        c += length(m.captures)
+    end
+    c
+end
+
+function regex_ismatch(strs)
+    r = r"^[a-z]+\d*$"
+    c = 0
+    for s in strs
+        c += ismatch(r, s)
+    end
+    c
+end
+
+# calls to tiny C functions; compare with `make -C test ccalltest; test/ccalltest`
+const libccalltest = "$JULIA_HOME/../../test/libccalltest"
+
+function ccall_add_int(n)
+    s = int32(0)
+    for i = 1:n
+        s = ccall((:testAddInt, libccalltest), Int32, (Int32, Int32), s, i&0xff)
+    end
+    s
+end
+
+function ccall_muladd_double(n)
+    d = 0.0
+    for i = 1:n
+        d = ccall((:testMulAddDouble, libccalltest), Float64,
+                  (Float64, Float64, Float64), d, 0.5, 1.0)
+    end
+    d
+end
+
+# a struct passed and returned by value, in registers
+immutable CComplex
+    re::Float64
+    im::Float64
+end
+
+function ccall_complex_mul(n)
+    z = CComplex(1.0, 0.0)
+    w = CComplex(0.6, 0.8)
+    for i = 1:n
+        z = ccall((:testComplexMul, libccalltest), CComplex, (CComplex, CComplex), z, w)
+    end
+    z
+end
+
+# passing a bits value by address
+function ccall_addressof(n)
+    x = 0
+    for i = 1:n
+        ccall(:memcpy, Ptr{Void}, (Ptr{Int}, Ptr{Int}, Uint), &x, &i, sizeof(Int))
+    end
+    x
+end
+
+# C calling back into julia: qsort with a julia comparator, looked up with
+# cfunction on every call
+ccall_cmp(a::Ptr{Float64}, b::Ptr{Float64}) = int32(cmp(unsafe_ref(a), unsafe_ref(b)))
+
+function ccall_qsort(n, iters)
+    a = Array(Float64, n)
+    for k = 1:iters
+        rand!(a)
+        ccall(:qsort, Void, (Ptr{Float64}, Uint, Uint, Ptr{Void}), a, n, sizeof(Float64),
+              cfunction(ccall_cmp, Int32, (Ptr{Float64}, Ptr{Float64})))
+    end
+    a
+end
@@ -0,0 +1,108 @@
+## Simple array kernels dominated by floating-point throughput.
+## Their speed depends mostly on the instruction set the JIT targets;
+## compare a default run against one with --cpu-target=generic.
+
+function axpy_loop!(a, x, y)
+    for i = 1:length(x)
+        y[i] = a*x[i] + y[i]
+    end
+    y
+end
+
+function dot_loop(x, y)
+    s = 0.0
+    for i = 1:length(x)
+        s += x[i]*y[i]
+    end
+    s
+end
+
+function matvec_loop!(r, A, x)
+    m, n = size(A)
+    for i = 1:m
+        r[i] = 0.0
+    end
+    for j = 1:n
+        xj = x[j]
+        for i = 1:m
+            r[i] += A[i,j]*xj
+        end
+    end
+    r
+end
+
+function kernels_axpy()
+    x = rand(1_000_000)
+    y = rand(1_000_000)
+    for n = 1:20
+        axpy_loop!(1.5, x, y)
+    end
+    y
+end
+
+function kernels_dot()
+    x = rand(1_000_000)
+    y = rand(1_000_000)
+    s = 0.0
+    for n = 1:20
+        s += dot_loop(x, y)
+    end
+    s
+end
+
+function kernels_matvec()
+    A = rand(500, 500)
+    x = rand(500)
+    r = zeros(500)
+    for n = 1:100
+        matvec_loop!(r, A, x)
+    end
+    r
+end
+
+# the same dot product written with explicit Float64x4 vectors
+function dot_vec(x, y)
+    acc = zero(Float64x4)
+    n = length(x)
+    i = 1
+    while i+3 <= n
+        acc += vload(Float64x4, x, i) * vload(Float64x4, y, i)
+        i += 4
+    end
+    s = sum(acc)
+    while i <= n
+        s += x[i]*y[i]
+        i += 1
+    end
+    s
+end
+
+function kernels_dot_vec()
+    x = rand(1_000_000)
+    y = rand(1_000_000)
+    s = 0.0
+    for n = 1:20
+        s += dot_vec(x, y)
+    end
+    s
+end
+
+# the dot product with the reduction allowed to reassociate, which lets
+# LLVM vectorize it and use fused multiply-adds
+function dot_fast(x, y)
+    s = 0.0
+    @fastmath for i = 1:length(x)
+        s = muladd(x[i], y[i], s)
+    end
+    s
+end
+
+function kernels_dot_fast()
+    x = rand(1_000_000)
+    y = rand(1_000_000)
+    s = 0.0
+    for n = 1:20
+        s += dot_fast(x, y)
+    end
+    s
+end
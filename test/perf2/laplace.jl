@@ -20,6 +20,62 @@ function laplace_devec()
     u = laplace_iter_devec(u, dx2, dy2, Niter, N)
 end
 
+# the same update with the inner loop running down columns. the array
+# header loads (data pointer, dimensions) are loop invariant here and can be
+# hoisted, since the loop body makes no calls.
+function laplace_iter_devec_cols(u, dx2, dy2, Niter, N)
+    uout = copy(u)
+    c = 1./(2*(dx2+dy2))
+    for iter = 1:Niter
+        for j = 2:N-1
+            for i = 2:N-1
+                uout[i,j] = ( (u[i-1,j]+u[i+1,j])*dy2 + (u[i,j-1]+u[i,j+1])*dx2 ) * c
+            end
+        end
+        u, uout = uout, u
+    end
+    return u
+end
+
+function laplace_devec_cols()
+    N = 150
+    u = zeros(N, N)
+    u[1,:] = 1
+    Niter = 2^10
+    dx2 = dy2 = 0.1*0.1
+    u = laplace_iter_devec_cols(u, dx2, dy2, Niter, N)
+end
+
+# the column version with the columns split across threads. each column is
+# updated by a call to a separately compiled function, so the threads don't
+# contend for the compiler after the first iteration.
+function laplace_col!(uout, u, dx2, dy2, c, j, N)
+    for i = 2:N-1
+        uout[i,j] = ( (u[i-1,j]+u[i+1,j])*dy2 + (u[i,j-1]+u[i,j+1])*dx2 ) * c
+    end
+end
+
+function laplace_iter_devec_threads(u, dx2, dy2, Niter, N)
+    uout = copy(u)
+    c = 1./(2*(dx2+dy2))
+    for iter = 1:Niter
+        @threads for j = 2:N-1
+            laplace_col!(uout, u, dx2, dy2, c, j, N)
+        end
+        u, uout = uout, u
+    end
+    return u
+end
+
+function laplace_devec_threads()
+    N = 150
+    u = zeros(N, N)
+    u[1,:] = 1
+    Niter = 2^10
+    dx2 = dy2 = 0.1*0.1
+    u = laplace_iter_devec_threads(u, dx2, dy2, Niter, N)
+end
+
 function laplace_iter_vec(u, dx2, dy2, Niter, N)
     for i = 1:Niter
         u[2:N-1, 2:N-1] = ((u[1:N-2, 2:N-1] + u[3:N, 2:N-1])*dy2 + (u[2:N-1,1:N-2] + u[2:N-1, 3:N])*dx2) * (1./ (2*(dx2+dy2)))
@@ -14,10 +14,37 @@ macro timeit1(ex,name)
     end
 end
 
+# like timeit, for an ex that returns how many messages (unit "msgs") or
+# bytes (unit "MB") it handled. also prints how many of those per second.
+macro timerate(ex,name,unit)
+    quote
+        t = Inf
+        n = 0
+        for i=1:5
+            t0 = time()
+            n = $ex
+            t = min(t, time()-t0)
+        end
+        r = $unit == "MB" ? n/t/1e6 : n/t
+        println($name, "\t", t*1000, "\t", r, " ", $unit, "/sec")
+    end
+end
+
 srand(1776)  # get more consistent times
 
 require("$JULIA_HOME/../../examples/list.jl")
 
+# loading the system image dominates startup
+@timeit run(`$JULIA_HOME/julia -e 0`) "startup"
+# first calls uncompress, infer and compile their methods
+@timeit run(`$JULIA_HOME/julia -e "sort!(rand(10)); string(1.5)"`) "first_call"
+
+include("ast.jl")
+lis = compressed_lambdas()
+@timeit1 ast_uncompress(lis) "ast_uncompress"
+@timeit ast_uncompress(lis[1:64]) "ast_uncompress_64"
+@timeit ast_compress(lis) "ast_compress"
+
 function listn1n2(n1::Int,n2::Int)
     l1 = Nil{Int}()
     for i=n2:-1:n1
@@ -66,6 +93,50 @@ include("actor_centrality.jl")
 include("laplace.jl")
 @timeit1 laplace_vec() "laplace_vec"
 @timeit laplace_devec() "laplace_devec"
+@timeit laplace_devec_cols() "laplace_devec_cols"
+@timeit laplace_devec_threads() "laplace_devec_threads"
+
+include("sched.jl")
+@pertask fib_async(18) ntasks_fib(18) "fib_async"
+@pertask fib_spawnthread(22) ntasks_fib(22) "fib_spawnthread"
+@pertask fib_threads(22) ntasks_fib(22) "fib_threads"
+@timeit qsort_threads(10^6, 100) "qsort_threads"
+pingpong_bench((1, 10, 100, 1000))
+task_memory_bench()
+
+include("ccall.jl")
+@timeit ccall_strarray(16, 10^5) "ccall_strarray_16"
+@timeit ccall_strarray(4096, 10^3) "ccall_strarray_4096"
+@timeit regex_match(10^5) "regex_match"
+let strs = [string(randstring(5), i) for i=1:10^5]
+    @timeit regex_ismatch(strs) "regex_ismatch"
+end
+if dlopen_e(libccalltest) != C_NULL
+    @timeit ccall_add_int(10^8) "ccall_add_int"
+    @timeit ccall_muladd_double(10^8) "ccall_muladd_double"
+    @timeit ccall_complex_mul(10^7) "ccall_complex_mul"
+end
+@timeit ccall_addressof(10^7) "ccall_addressof"
+@timeit ccall_qsort(10, 10^5) "ccall_qsort_10"
+@timeit ccall_qsort(10^5, 10) "ccall_qsort_100000"
+
+include("serialize.jl")
+@timerate ser_small_msgs(10^5, serialize, deserialize) "ser_msgs" "msgs"
+@timerate ser_small_msgs(10^5, Base.serialize_msg, Base.deserialize_msg) "ser_msgs_c" "msgs"
+@timerate ser_float_arrays(100, 10^5, serialize, deserialize) "ser_float64_80MB" "MB"
+@timerate ser_float_arrays(100, 10^5, Base.serialize_msg, Base.deserialize_msg) "ser_float64_80MB_c" "MB"
+@timerate ser_mixed(10^3, serialize, deserialize) "ser_mixed" "msgs"
+@timerate ser_mixed(10^3, Base.serialize_msg, Base.deserialize_msg) "ser_mixed_c" "msgs"
+@timerate ser_loopback(10, 10^7, false) "tcp_float64_800MB" "MB"
+@timerate ser_loopback(10, 10^7, true) "tcp_float64_800MB_direct" "MB"
+@timerate ser_stream(10^6) "tcp_stream_1M_values" "MB"
+@timerate lz_roundtrip(2^28, :float64) "lz_float64_256MB" "MB"
+@timerate lz_roundtrip(2^28, :int64) "lz_int64_256MB" "MB"
+@timerate lz_roundtrip(2^28, :strings) "lz_strings_256MB" "MB"
+remote_worker()
+@timerate remote_do_many(10^6) "remote_do_1M" "msgs"
+@timerate remote_call_many(10^6) "remote_call_1M" "msgs"
+@timerate remote_call_fetch_many(10^4) "remote_call_fetch_10K" "msgs"
 
 # issue #1169
 include("go_benchmark.jl")
@@ -96,6 +167,18 @@ d = randn(len)
 
 @timeit (for n in 1:10; a = arith_vectorized(b,c,d); end) "vectoriz"
 
+include("kernels.jl")
+@timeit kernels_axpy() "axpy    "
+@timeit kernels_dot() "dot     "
+@timeit kernels_dot_vec() "dotvec  "
+@timeit kernels_dot_fast() "dotfast "
+@timeit kernels_matvec() "matvec  "
+
+include("structs.jl")
+@timeit structs_complex_axpy() "complex_axpy"
+@timeit structs_complex_sum() "complex_sum"
+@timeit structs_segments() "segments"
+
 open("random.csv","w") do io
     writecsv(io, rand(100000,4))
 end
@@ -0,0 +1,123 @@
+# fine-grained tasks. every call spawns one task and does almost no work,
+# so the time per task is the scheduling overhead.
+
+function fib_async(n)
+    if n < 2
+        return n
+    end
+    t = @async fib_async(n-1)
+    fib_async(n-2) + fetch(t)
+end
+
+function fib_spawnthread(n)
+    if n < 2
+        return n
+    end
+    t = @spawnthread fib_spawnthread(n-1)
+    fib_spawnthread(n-2) + fetch(t)
+end
+
+# number of tasks fib_async(n) and fib_spawnthread(n) spawn
+ntasks_fib(n) = n < 2 ? 0 : 1 + ntasks_fib(n-1) + ntasks_fib(n-2)
+
+function fib_threads(n)
+    r = zeros(Int, 1)
+    @threads for i = 1:1
+        r[1] = fib_spawnthread(n)
+    end
+    r[1]
+end
+
+# quicksort that sorts the two halves in parallel down to `cutoff` elements
+function qsort_threads!(a, lo, hi, cutoff)
+    if hi-lo < cutoff
+        sort!(a, lo, hi, InsertionSort(), Sort.Forward())
+        return a
+    end
+    pivot = a[(lo+hi)>>>1]
+    i, j = lo, hi
+    while i <= j
+        while a[i] < pivot; i += 1; end
+        while a[j] > pivot; j -= 1; end
+        if i <= j
+            a[i], a[j] = a[j], a[i]
+            i += 1
+            j -= 1
+        end
+    end
+    t = @spawnthread qsort_threads!(a, lo, j, cutoff)
+    qsort_threads!(a, i, hi, cutoff)
+    fetch(t)
+    a
+end
+
+function qsort_threads(n, cutoff)
+    a = rand(n)
+    @threads for i = 1:1
+        qsort_threads!(a, 1, n, cutoff)
+    end
+    assert(issorted(a))
+end
+
+macro pertask(ex, ntasks, name)
+    quote
+        t = Inf
+        for i=1:5
+            t = min(t, @elapsed $ex)
+        end
+        println($name, "\t", t*1000, "\t", t*1e9/$ntasks, " ns/task")
+    end
+end
+
+# two tasks switching back and forth, each `depth` calls deep. copying
+# stacks makes a switch cost more the deeper the tasks are.
+descend(depth, f) = depth == 0 ? f() : (descend(depth-1, f); nothing)
+
+function pingpong(n, depth)
+    me = current_task()
+    t = Task(()->descend(depth, ()->(for i=1:n; yieldto(me); end)), 4*1024*1024)
+    descend(depth, ()->(for i=1:n; yieldto(t); end))
+end
+
+function pingpong_bench(depths)
+    n = 10^5
+    for depth in depths
+        t = Inf
+        for i=1:5
+            t = min(t, @elapsed pingpong(n, depth))
+        end
+        println("pingpong_", depth, "\t", t*1000, "\t", 2n/t, " switches/s")
+    end
+end
+
+# creating many tasks. a task that has not run yet needs no stack; one
+# that is suspended only holds the stack pages it has touched.
+function spawn_idle(n)
+    ts = Array(Task, n)
+    for i = 1:n
+        ts[i] = Task(()->nothing)
+    end
+    ts
+end
+
+function spawn_suspended(n)
+    me = current_task()
+    ts = Array(Task, n)
+    for i = 1:n
+        ts[i] = Task(()->yieldto(me))
+        yieldto(ts[i])
+    end
+    ts
+end
+
+function task_memory_bench()
+    for (name, f, n) in (("idle_tasks", spawn_idle, 10^6),
+                         ("suspended_tasks", spawn_suspended, 10^4))
+        gc()
+        rss0 = Base.resident_memory()
+        t = @elapsed ts = f(n)
+        rss = int(Base.resident_memory()) - int(rss0)
+        println(name, "\t", t*1000, "\t", n/t, " tasks/s\t", rss/n, " bytes/task")
+        ts = nothing
+    end
+end
@@ -0,0 +1,151 @@
+# round trips of remote call messages through an IOBuffer. ser is
+# serialize/deserialize or serialize_msg/deserialize_msg; messages/sec is
+# n over the time, MB/sec is the bytes written over the time.
+
+function ser_small_msgs(n, ser, deser)
+    buf = IOBuffer()
+    args = (1, 2.5, "key", :sym)
+    for i = 1:n
+        ser(buf, :call)
+        ser(buf, (i,1))
+        ser(buf, args)
+        seek(buf, 0)
+        deser(buf); deser(buf); deser(buf)
+        takebuf_array(buf)
+    end
+    n
+end
+
+function ser_float_arrays(n, len, ser, deser)
+    buf = IOBuffer()
+    a = rand(len)
+    for i = 1:n
+        ser(buf, (i, a))
+        seek(buf, 0)
+        deser(buf)
+        takebuf_array(buf)
+    end
+    n*sizeof(a)
+end
+
+function ser_mixed(n, ser, deser)
+    buf = IOBuffer()
+    v = {[string(i) for i=1:100], [1:100], :(x+1), Int32[1:1000]}
+    for i = 1:n
+        ser(buf, v)
+        seek(buf, 0)
+        deser(buf)
+        takebuf_array(buf)
+    end
+    n
+end
+
+# Float64 arrays sent to ourselves over a local TCP connection, the way
+# send_msg_ sends them. with direct, they are written from the array and
+# read straight into a new one; MB/sec is n*8*len bytes over the time.
+function ser_loopback(n, len, direct::Bool)
+    (port, server) = open_any_tcp_port(9300)
+    r = @async Base.wait_accept(server)
+    client = connect("localhost", port)
+    conn = fetch(r)
+    a = rand(len)
+    w = @async begin
+        buf = IOBuffer()
+        d = {}
+        for i = 1:n
+            Base.serialize_msg(buf, a, direct ? d : nothing)
+            Base.enq_send_req(client, buf, d, false)
+        end
+    end
+    for i = 1:n
+        Base.deserialize_msg(conn)
+    end
+    fetch(w)
+    close(client)
+    close(conn)
+    close(server)
+    n*sizeof(a)
+end
+
+# a list of n small arrays and a Dict of n strings, sent as one message
+# over a local TCP connection the way send_msg_ does, flushing every
+# SEND_CHUNK bytes; MB/sec is the bytes sent over the time.
+function ser_stream(n)
+    (port, server) = open_any_tcp_port(9350)
+    r = @async Base.wait_accept(server)
+    client = connect("localhost", port)
+    conn = fetch(r)
+    v = ([rand(8) for i=1:n], [string(i)=>i for i=1:n])
+    w = @async begin
+        s = Base.SendStream(client, IOBuffer(), {})
+        Base.serialize_msg(s, v, s.direct)
+        Base.finish_msg(s)
+    end
+    Base.deserialize_msg(conn)
+    fetch(w)
+    close(client)
+    close(conn)
+    close(server)
+    b = IOBuffer()
+    serialize(b, v)
+    position(b)
+end
+
+# compressing n bytes of typical message data in 1MB frames and back, the
+# way compressed connections send it; MB/sec is n over the time
+function lz_data(kind)
+    if kind == :float64
+        return reinterpret(Uint8, round(rand(2^17)*100)/100)
+    elseif kind == :int64
+        return reinterpret(Uint8, rand(1:10^5, 2^17))
+    end
+    b = IOBuffer()
+    Base.serialize_msg(b, [string("item_", i) for i = 1:10^5])
+    takebuf_array(b)[1:2^20]
+end
+
+function lz_roundtrip(n, kind)
+    a = lz_data(kind)
+    for i = 1:div(n, length(a))
+        Base.read_lz_frame(IOBuffer(Base.lz_frame(a)))
+    end
+    n
+end
+
+# n tiny remote calls to a worker, which are coalesced into a few writes
+# per event loop turn. remote_do sends one message per call; remote_call
+# also gets a reference back, and remote_call_fetch waits for every reply
+# before sending the next call, so it measures the round trip latency.
+function remote_worker()
+    if nprocs() < 2
+        addprocs(1)
+    end
+    nprocs()
+end
+
+function remote_do_many(n)
+    p = remote_worker()
+    for i = 1:n
+        remote_do(p, identity, i)
+    end
+    remote_call_fetch(p, identity, 0)
+    n
+end
+
+function remote_call_many(n)
+    p = remote_worker()
+    r = nothing
+    for i = 1:n
+        r = remote_call(p, identity, i)
+    end
+    fetch(r)
+    n
+end
+
+function remote_call_fetch_many(n)
+    p = remote_worker()
+    for i = 1:n
+        remote_call_fetch(p, identity, i)
+    end
+    n
+end
@@ -0,0 +1,59 @@
+## Loops over arrays of small immutable records. The elements are stored
+## inline, so these measure loads and stores of unboxed structs rather than
+## allocation and pointer chasing.
+
+function complex_axpy!(a::Complex128, x::Vector{Complex128}, y::Vector{Complex128})
+    for i = 1:length(x)
+        y[i] = a*x[i] + y[i]
+    end
+    y
+end
+
+function complex_abs2sum(x::Vector{Complex128})
+    s = 0.0
+    for i = 1:length(x)
+        s += abs2(x[i])
+    end
+    s
+end
+
+function structs_complex_axpy()
+    x = complex(rand(1_000_000), rand(1_000_000))
+    y = complex(rand(1_000_000), rand(1_000_000))
+    for n = 1:20
+        complex_axpy!(0.5+0.5im, x, y)
+    end
+    y
+end
+
+function structs_complex_sum()
+    x = complex(rand(1_000_000), rand(1_000_000))
+    s = 0.0
+    for n = 1:20
+        s += complex_abs2sum(x)
+    end
+    s
+end
+
+# a record with struct fields, which are themselves stored inline
+immutable Segment
+    a::Complex128
+    b::Complex128
+end
+
+function segment_length(s::Vector{Segment})
+    l = 0.0
+    for i = 1:length(s)
+        l += abs(s[i].b - s[i].a)
+    end
+    l
+end
+
+function structs_segments()
+    s = [Segment(complex(rand(),rand()), complex(rand(),rand())) for i=1:1_000_000]
+    l = 0.0
+    for n = 1:20
+        l += segment_length(s)
+    end
+    l
+end
@@ -15,3 +15,112 @@ let
     seek(f, 0)
     @test deserialize(f) == a
 end
+
+# the C serializer writes what serialize writes, and reads it back
+@test Base.ser_tag[LongExpr] == 25
+@test Base.ser_tag[Base.UndefRefTag] == 36
+let vals = {:call, :a_long_symbol_name, (1,2,1000), 1.5, int8(-3), uint16(7),
+            [1.0 2.0; 3.0 4.0], [true,true,false,true], Int32[], "abc",
+            "αβγ", :αβγ, {1,"x",{:y}}, :(f(x)+1), Base, Float64, Array{Int,2},
+            Complex128(1,2), [Complex64(1,2), Complex64(3,4)], nothing}
+    for v in vals
+        a = IOBuffer()
+        serialize(a, v)
+        b = IOBuffer()
+        Base.serialize_msg(b, v)
+        @test takebuf_array(a) == takebuf_array(b)
+        Base.serialize_msg(b, v)
+        seek(b, 0)
+        @test isequal(Base.deserialize_msg(b), v)
+        @test eof(b)
+    end
+    # partial values and functions are left to deserialize
+    b = IOBuffer()
+    Base.serialize_msg(b, (1, sin))
+    Base.serialize_msg(b, [1.0, 2.0, 3.0])
+    seek(b, 0)
+    @test Base.deserialize_msg(b) == (1, sin)
+    @test Base.deserialize_msg(b) == [1.0, 2.0, 3.0]
+    b = IOBuffer()
+    serialize(b, [1.0, 2.0, 3.0])
+    data = takebuf_array(b)
+    @test is(Base.deserialize_buffered(IOBuffer(data[1:end-1])), Base.wire_tags)
+end
+
+# types with serialize methods of their own are written by them
+immutable WireOwnSerialize
+    x::Int
+end
+Base.serialize(s, v::WireOwnSerialize) = Base.serialize(s, v.x)
+let b = IOBuffer()
+    Base.serialize_msg(b, (1, WireOwnSerialize(5)))
+    seek(b, 0)
+    @test Base.deserialize_msg(b) == (1, 5)
+end
+
+# large arrays can be left out, to be sent from their own memory
+let a = rand(10^5), b = IOBuffer(), d = {}
+    Base.serialize_msg(b, (1, a, :x), d)
+    @test length(d) == 2 && is(d[2], a)
+    data = takebuf_array(b)
+    c = IOBuffer()
+    serialize(c, (1, a, :x))
+    @test takebuf_array(c) == [data[1:d[1]], reinterpret(Uint8, a), data[d[1]+1:end]]
+end
+
+# messages go out as they are serialized, and are read back as they arrive.
+# the sender waits for its writes rather than queue much more than
+# SEND_QUEUED bytes of a message that is far larger.
+let (port, server) = open_any_tcp_port(9400)
+    r = @async Base.wait_accept(server)
+    client = connect("localhost", port)
+    conn = fetch(r)
+    v = {[string(i) for i=1:10^5], rand(10^6), [rand(100) for i=1:10^5], (1,sin)}
+    t = @async begin
+        s = Base.SendStream(client, IOBuffer(), {})
+        Base.serialize_msg(s, v, s.direct)
+        queued = Base.outstanding(s)
+        Base.finish_msg(s)
+        @assert Base.outstanding(s) == 0 && isempty(s.pending)
+        queued
+    end
+    @test isequal(Base.deserialize_msg(conn), v)
+    @test fetch(t) <= Base.SEND_QUEUED
+    close(client)
+    close(conn)
+    close(server)
+end
+
+# compressed frames, and messages read through them
+let
+    for a in {Uint8[], rand(Uint8, 10^4), zeros(Uint8, 10^5),
+              reinterpret(Uint8, [1.0:10^4]), "abc"^1000}
+        a = isa(a, String) ? a.data : a
+        f = Base.lz_frame(a)
+        @test length(f) <= length(a)+8
+        @test Base.read_lz_frame(IOBuffer(f)) == a
+    end
+    f = Base.lz_frame(zeros(Uint8, 1000))
+    f[1:4] = reinterpret(Uint8, Int32[1001])
+    @test_fails Base.read_lz_frame(IOBuffer(f))
+end
+
+let (port, server) = open_any_tcp_port(9410)
+    r = @async Base.wait_accept(server)
+    client = connect("localhost", port)
+    conn = fetch(r)
+    v = {[string(i) for i=1:10^5], [1.0:10^6], (1,sin)}
+    t = @async begin
+        s = Base.SendStream(client, IOBuffer(), nothing, true)
+        Base.serialize_msg(s, v, nothing)
+        Base.serialize_msg(s, :done, nothing)
+        Base.finish_msg(s)
+    end
+    c = Base.InflateStream(conn)
+    @test isequal(Base.deserialize_msg(c), v)
+    @test is(Base.deserialize_msg(c), :done)
+    fetch(t)
+    close(client)
+    close(conn)
+    close(server)
+end
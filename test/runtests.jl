@@ -1,8 +1,9 @@
 testnames = ["core", "numbers", "strings", "unicode", "corelib", "hashing",
              "remote", "iostring", "arrayops", "linalg", "blas", "fft",
              "dct", "sparse", "bitarray", "random", "math", "functional",
-             "bigint", "sorting", "statistics", "spawn", "parallel",
+             "bigint", "simd", "sorting", "statistics", "spawn", "parallel",
              "suitesparse", "arpack", "bigfloat", "file", "zlib", "image",
+             "loading",
              "perf"]
 
 if ARGS == ["all"]
@@ -0,0 +1,107 @@
+# construction and element access
+v = vbroadcast(Float64x4, 2)
+@test length(v) == 4
+@test eltype(v) == Float64
+@test v[1] == 2.0 && v[4] == 2.0
+@test_fails v[0]
+@test_fails v[5]
+v = setelt(v, 5.0, 3)
+@test v[3] == 5.0 && v[2] == 2.0
+
+a = [1.0:8.0]
+x = vload(Float64x4, a, 5)
+@test [x[i] for i=1:4] == [5.0,6.0,7.0,8.0]
+@test_fails vload(Float64x4, a, 6)
+@test_fails vload(Float32x4, a, 1)
+b = zeros(8)
+vstore(x, b, 1)
+@test b == [5.0,6.0,7.0,8.0,0.0,0.0,0.0,0.0]
+@test_fails vstore(x, b, 6)
+
+# arithmetic
+y = vload(Float64x4, a, 1)
+@test sum(x+y) == sum(a)
+@test sum(x-y) == 16.0
+@test sum(x*y) == dot(a[1:4], a[5:8])
+@test (x/y)[2] == 3.0
+@test (-y)[4] == -4.0
+
+i = vload(Int32x4, int32([1,2,3,4]), 1)
+@test sum(i << 2) == 40
+@test sum(-i >> 1) == -6
+@test sum((-i) >>> 1) > 0
+@test (i & vbroadcast(Int32x4, 1))[3] == 1
+@test (i | vbroadcast(Int32x4, 8))[2] == 10
+@test (i $ i)[1] == 0
+@test (~i)[1] == -2
+
+# comparisons give masks
+m = x .< vbroadcast(Float64x4, 7)
+@test isa(m, Int64x4)
+@test m[1] == -1 && m[3] == 0
+@test bitmask(m) == 0x3
+@test any(m) && !all(m)
+@test all(i .== i)
+@test bitmask(vload(Uint8x16, uint8([0:15]), 1) .> vbroadcast(Uint8x16, 0x7)) == 0xff00
+
+# shuffles and reinterpretation
+s = @vshuffle Float64x4 x y (4,3,5,1)
+@test [s[k] for k=1:4] == [8.0,7.0,1.0,5.0]
+@test reinterpret(Int64x4, vbroadcast(Float64x4, 1.0))[1] == reinterpret(Int64, 1.0)
+@test_fails reinterpret(Int32x4, x)
+
+# dot product
+function simd_dot(a::Vector{Float64}, b::Vector{Float64})
+    n = length(a)
+    acc = zero(Float64x4)
+    i = 1
+    while i+3 <= n
+        acc += vload(Float64x4, a, i) * vload(Float64x4, b, i)
+        i += 4
+    end
+    s = sum(acc)
+    while i <= n
+        s += a[i]*b[i]
+        i += 1
+    end
+    s
+end
+p = rand(1003); q = rand(1003)
+@test_approx_eq simd_dot(p, q) dot(p, q)
+
+# byte scanning
+function simd_count(buf::Vector{Uint8}, c::Uint8)
+    n = length(buf)
+    cv = vbroadcast(Uint8x16, c)
+    cnt = 0
+    i = 1
+    while i+15 <= n
+        cnt += count_ones(bitmask(vload(Uint8x16, buf, i) .== cv))
+        i += 16
+    end
+    while i <= n
+        cnt += buf[i] == c
+        i += 1
+    end
+    cnt
+end
+buf = uint8(rand(0:3, 1000))
+@test simd_count(buf, 0x2) == sum(buf .== 0x2)
+
+# checksum
+function simd_checksum(buf::Vector{Uint32})
+    acc = zero(Uint32x4)
+    for i = 1:4:length(buf)-3
+        acc = (acc << 1) $ vload(Uint32x4, buf, i)
+    end
+    acc
+end
+w = uint32(rand(0:typemax(Uint32)-1, 64))
+c = simd_checksum(w)
+for k = 1:4
+    r = uint32(0)
+    for i = k:4:64
+        r = (r << 1) $ w[i]
+    end
+    @test c[k] == r
+end
@@ -10,6 +10,7 @@
 
 static int lisp_prompt = 0;
 static char *program = NULL;
+static char *compile_report = NULL;
 char *image_file = "sys.ji";
 int tab_width = 2;
 
@@ -24,7 +25,10 @@ static const char *opts =
     " -E --print=<expr>        Evaluate and show <expr>\n"
     " -P --post-boot=<expr>    Evaluate <expr> right after boot\n"
     " -L --load=file           Load <file> right after boot\n"
-    " -J --sysimage=file       Start up with the given system image file\n\n"
+    " -J --sysimage=file       Start up with the given system image file\n"
+    " -O --optimize=<n>        Set JIT optimization level 0-3 (default 2)\n"
+    " --cpu-target=<cpu>       Generate code for <cpu> instead of the host\n"
+    " --compile-report=<file>  Write per-method JIT time and code size to <file> at exit\n\n"
 
     " -p n                     Run n local processes\n"
     " --machinefile file       Run processes on hosts listed in file\n\n"
@@ -36,7 +40,7 @@ static const char *opts =
     " -h --help                Print this message\n";
 
 void parse_opts(int *argcp, char ***argvp) {
-    static char* shortopts = "+H:T:bhJ:";
+    static char* shortopts = "+H:T:bhJ:O:";
     static struct option longopts[] = {
         { "home",        required_argument, 0, 'H' },
         { "tab",         required_argument, 0, 'T' },
@@ -44,6 +48,9 @@ void parse_opts(int *argcp, char ***argvp) {
         { "lisp",        no_argument,       &lisp_prompt, 1 },
         { "help",        no_argument,       0, 'h' },
         { "sysimage",    required_argument, 0, 'J' },
+        { "optimize",    required_argument, 0, 'O' },
+        { "cpu-target",  required_argument, 0, 'C' },
+        { "compile-report", required_argument, 0, 'R' },
         { 0, 0, 0, 0 }
     };
     int c;
@@ -78,6 +85,26 @@ void parse_opts(int *argcp, char ***argvp) {
 #endif
             ind+=2;
             break;
+        case 'O':
+            if (optarg[0] < '0' || optarg[0] > '0'+JL_OPT_LEVEL_MAX ||
+                optarg[1] != '\0') {
+                ios_printf(ios_stderr, "julia: invalid optimization level %s\n",
+                           optarg);
+                exit(1);
+            }
+            jl_compileropts.opt_level = optarg[0] - '0';
+            // -O2 is one argument, -O 2 is two
+            ind += (optarg == (*argvp)[optind-1]) ? 2 : 1;
+            break;
+        case 'C':
+            jl_compileropts.cpu_target = strdup(optarg);
+            ind += (optarg == (*argvp)[optind-1]) ? 2 : 1;
+            break;
+        case 'R':
+            // written by Julia at exit; passed on below
+            compile_report = optarg;
+            ind += (optarg == (*argvp)[optind-1]) ? 2 : 1;
+            break;
         case 'h':
             printf("%s%s", usage, opts);
             exit(0);
@@ -106,6 +133,14 @@ void parse_opts(int *argcp, char ***argvp) {
             program = (*argvp)[0];
         }
     }
+    if (compile_report) {
+        // hand the option to Julia in the slots of the options consumed
+        // here, which include argv[0] and the option itself
+        *argvp -= 2;
+        *argcp += 2;
+        (*argvp)[0] = "--compile-report";
+        (*argvp)[1] = compile_report;
+    }
     if (image_file) {
         int build_time_path = 0;
 #ifdef JL_SYSTEM_IMAGE_PATH